@@ -6,6 +6,14 @@
 #include <QGraphicsView>
 #include <QLayout>
 #include <QDebug>
+#include <QWheelEvent>
+#include <QFile>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "qgraphics_chunk_item.hpp"
+#include "scene_file.hpp"
 
 CanvasWidget::CanvasWidget(QWidget * parent): QWidget(parent)
 {
@@ -13,7 +21,13 @@ CanvasWidget::CanvasWidget(QWidget * parent): QWidget(parent)
 	scene = new QGraphicsScene(this);
 
 	// Initialize the QGraphicsView with the scene
-	QGraphicsView* view = new QGraphicsView(scene, this);
+	view = new QGraphicsView(scene, this);
+
+	// Pan by dragging and zoom with the wheel around the cursor. Drawn
+	// batches paint only what is exposed, at the detail the zoom can show.
+	view->setDragMode(QGraphicsView::ScrollHandDrag);
+	view->setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
+	view->viewport()->installEventFilter(this);
 
 	// Set up the layout to include the QGraphicsView
 	QVBoxLayout* layout = new QVBoxLayout;
@@ -27,11 +41,122 @@ void CanvasWidget::addGraphic(QGraphicsItem * item)
 	scene->addItem(item);
 }
 
+// Adds a batch of items with the view's updates suspended, so the batch
+// costs one repaint rather than one per item. The scene's BSP index takes
+// in items added together in a single deferred pass.
+void CanvasWidget::addGraphics(QList<QGraphicsItem *> items)
+{
+	view->setUpdatesEnabled(false);
+	for (QGraphicsItem * item : items)
+	{
+		scene->addItem(item);
+	}
+	view->setUpdatesEnabled(true);
+	if (drawingLayer)
+	{
+		layer.append(items);
+	}
+}
+
+void CanvasWidget::beginLayer(QString name)
+{
+	layerName = name;
+	layer.clear();
+	drawingLayer = true;
+}
+
+// The finished layer takes the place of the previous one of its name,
+// unless its form failed, in which case neither is kept
+void CanvasWidget::endLayer(bool succeeded)
+{
+	if (!drawingLayer)
+	{
+		return;
+	}
+	drawingLayer = false;
+	if (succeeded)
+	{
+		// the new layer replaces the previous one of the same name
+		removeItems(layers.take(layerName));
+		if (!layer.isEmpty())
+		{
+			layers.insert(layerName, layer);
+		}
+	}
+	else
+	{
+		// a failed form leaves the previous layer in place
+		removeItems(layer);
+	}
+	layer.clear();
+}
+
+// The scene file is a layer of its own, so opening it again replaces it
+bool CanvasWidget::loadScene(QString filename)
+{
+	std::shared_ptr<QFile> file = std::make_shared<QFile>(filename);
+	if (!file->open(QIODevice::ReadOnly) || file->size() == 0)
+	{
+		return false;
+	}
+	uchar * data = file->map(0, file->size());
+	if (data == nullptr)
+	{
+		return false;
+	}
+	// unmapped once the last chunk item is gone
+	std::shared_ptr<const void> mapping(data, [file](const void * mapped)
+	{
+		file->unmap(static_cast<uchar *>(const_cast<void *>(mapped)));
+	});
+
+	std::vector<SceneChunk> chunks;
+	Box bounds;
+	if (!readScene(data, static_cast<std::size_t>(file->size()), chunks, bounds))
+	{
+		return false;
+	}
+	QList<QGraphicsItem *> items;
+	for (const SceneChunk & chunk : chunks)
+	{
+		items.append(new QGraphicsChunkItem(mapping, chunk));
+	}
+	beginLayer(filename);
+	addGraphics(items);
+	endLayer(true);
+	return true;
+}
+
+void CanvasWidget::removeItems(const QList<QGraphicsItem *> & items)
+{
+	view->setUpdatesEnabled(false);
+	for (QGraphicsItem * item : items)
+	{
+		// the item leaves the scene as it is destroyed
+		delete item;
+	}
+	view->setUpdatesEnabled(true);
+}
+
+bool CanvasWidget::eventFilter(QObject * watched, QEvent * event)
+{
+	if (watched == view->viewport() && event->type() == QEvent::Wheel)
+	{
+		// a notch of 120 zooms by 25%
+		qreal factor = std::pow(1.25, static_cast<QWheelEvent *>(event)->angleDelta().y() / 120.0);
+		view->scale(factor, factor);
+		return true;
+	}
+	return QWidget::eventFilter(watched, event);
+}
+
 void CanvasWidget::clearCanvas()
 {
 	if (scene != nullptr)
 	{
 		scene->clear();
 	}
+	layers.clear();
+	layer.clear();
 }
 
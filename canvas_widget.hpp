@@ -2,9 +2,13 @@
 #define CANVAS_WIDGET_HPP
 
 #include <QWidget>
+#include <QHash>
+#include <QList>
+#include <QString>
 
 class QGraphicsItem;
 class QGraphicsScene;
+class QGraphicsView;
 
 class CanvasWidget: public QWidget{
   Q_OBJECT
@@ -14,14 +18,40 @@ public:
   CanvasWidget(QWidget * parent = nullptr);
 
 
+protected:
+
+  // zooms the view on wheel events over it
+  bool eventFilter(QObject * watched, QEvent * event) override;
+
 public slots:
 
   void addGraphic(QGraphicsItem * item);
+  void addGraphics(QList<QGraphicsItem *> items);
   void clearCanvas();
 
+  // Shows the drawing of a scene file saved by sldraw --export, mapping the
+  // file and adding an item per chunk that reads it in place when painted.
+  // Returns false if the file cannot be mapped or is not a scene file.
+  bool loadScene(QString filename);
+
+  // Items added between beginLayer and endLayer form the layer of that name
+  void beginLayer(QString name);
+  void endLayer(bool succeeded);
+
 private:
 
+  void removeItems(const QList<QGraphicsItem *> & items);
+
   QGraphicsScene * scene;
+  QGraphicsView * view;
+
+  // The items of each REPL entry or script form, by the form's source, so
+  // a form evaluated again replaces only its own items, and a failing one
+  // removes only its own
+  QHash<QString, QList<QGraphicsItem *>> layers;
+  QString layerName;
+  QList<QGraphicsItem *> layer; // items of the layer being drawn
+  bool drawingLayer = false;
 };
 
 #endif
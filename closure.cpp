@@ -0,0 +1,444 @@
+#include "closure.hpp"
+
+// system includes
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+
+// module includes
+#include "interpreter_semantic_error.hpp"
+
+// Special forms that cannot be bound as variables
+static const char * const specialForms[] = {"define", "if", "begin", "lambda", "let",
+                                             "while", "dotimes", "for", "repeat", "set!", "map", "iterate"};
+
+static bool isSpecialForm(const Symbol & symbol)
+{
+  for (const char * name : specialForms)
+  {
+    if (symbol == name)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// (lambda (x y) body): the parameter list parses as a call of x with
+// argument y, while (x) and () parse as lists. A bare symbol is no list.
+static bool lambdaParameters(const Expression & expr, std::vector<Symbol> & names)
+{
+  if (expr.tail.size() != 2)
+  {
+    return false;
+  }
+  const Expression & params = expr.tail[0];
+  if (params.head.type == SymbolType && !params.tail.empty())
+  {
+    names.push_back(params.head.value.sym_value);
+  }
+  else if (params.head.type != ListType)
+  {
+    return false;
+  }
+  for (const auto & e : params.tail)
+  {
+    if (e.head.type != SymbolType || !e.tail.empty())
+    {
+      return false;
+    }
+    names.push_back(e.head.value.sym_value);
+  }
+  return true;
+}
+
+// (let ((x 1) (y 2)) body): the bindings parse as a list of calls
+static bool letBindings(const Expression & expr, std::vector<Symbol> & names)
+{
+  if (expr.tail.size() != 2 || expr.tail[0].head.type != ListType)
+  {
+    return false;
+  }
+  for (const auto & binding : expr.tail[0].tail)
+  {
+    if (binding.head.type != SymbolType || binding.tail.size() != 1)
+    {
+      return false;
+    }
+    names.push_back(binding.head.value.sym_value);
+  }
+  return true;
+}
+
+// (dotimes (i n) body), (for (i start end [step]) body) and
+// (repeat (acc init) n body) bind the variable heading their first operand
+static bool loopVariable(const Expression & expr, std::vector<Symbol> & names)
+{
+  const Symbol & form = expr.head.value.sym_value;
+  if (expr.tail.size() != (form == "repeat" ? 3u : 2u))
+  {
+    return false;
+  }
+  const Expression & variable = expr.tail[0];
+  std::size_t minBounds = form == "for" ? 2 : 1;
+  std::size_t maxBounds = form == "for" ? 3 : 1;
+  if (variable.head.type != SymbolType || variable.tail.size() < minBounds || variable.tail.size() > maxBounds)
+  {
+    return false;
+  }
+  names.push_back(variable.head.value.sym_value);
+  return true;
+}
+
+static bool isLoop(const Symbol & symbol)
+{
+  return symbol == "dotimes" || symbol == "for" || symbol == "repeat";
+}
+
+bool isBindingForm(const Expression & expr)
+{
+  if (expr.head.type != SymbolType || expr.tail.empty())
+  {
+    return false;
+  }
+  const Symbol & symbol = expr.head.value.sym_value;
+  return symbol == "lambda" || symbol == "let" || isLoop(symbol);
+}
+
+bool boundNames(const Expression & expr, std::vector<Symbol> & names)
+{
+  if (!isBindingForm(expr))
+  {
+    return false;
+  }
+  const Symbol & symbol = expr.head.value.sym_value;
+  if (symbol == "lambda")
+  {
+    return lambdaParameters(expr, names);
+  }
+  if (symbol == "let")
+  {
+    return letBindings(expr, names);
+  }
+  return loopVariable(expr, names);
+}
+
+class ScopeResolver
+{
+public:
+  std::size_t resolveTopLevel(Expression & ast);
+
+private:
+  // The variables visible in the body of a lambda, or at the top level
+  struct Function{
+    Function * parent;
+    std::vector<std::pair<Symbol, std::size_t>> locals; // innermost last
+    std::size_t frameSize;
+    std::vector<CaptureSource> captures;
+    std::vector<Symbol> captureNames;
+  };
+
+  enum Binding {Global, Local, Captured};
+
+  Binding find(Function & fn, const Symbol & name, std::size_t & index);
+  void bind(Expression & expr, Function & fn);
+  void resolve(Expression & expr, Function & fn);
+  void resolveLambda(Expression & expr, Function & fn);
+  void resolveLet(Expression & expr, Function & fn);
+  void resolveLoop(Expression & expr, Function & fn);
+  void checkNames(const std::vector<Symbol> & names, const std::string & form);
+  bool containsBinder(const Expression & expr);
+
+  std::map<const void *, bool> binders;
+};
+
+ScopeResolver::Binding ScopeResolver::find(Function & fn, const Symbol & name, std::size_t & index)
+{
+  for (auto it = fn.locals.rbegin(); it != fn.locals.rend(); ++it)
+  {
+    if (it->first == name)
+    {
+      index = it->second;
+      return Local;
+    }
+  }
+  for (std::size_t i = 0; i < fn.captureNames.size(); ++i)
+  {
+    if (fn.captureNames[i] == name)
+    {
+      index = i;
+      return Captured;
+    }
+  }
+  if (fn.parent == nullptr)
+  {
+    return Global;
+  }
+
+  // a variable of an enclosing function is captured, through every lambda in between
+  std::size_t outer = 0;
+  Binding binding = find(*fn.parent, name, outer);
+  if (binding == Global)
+  {
+    return Global;
+  }
+  fn.captures.push_back(CaptureSource{binding == Captured, outer});
+  fn.captureNames.push_back(name);
+  index = fn.captures.size() - 1;
+  return Captured;
+}
+
+// Annotates a variable reference, or a call site, with the binding of its symbol
+void ScopeResolver::bind(Expression & expr, Function & fn)
+{
+  std::size_t index = 0;
+  Binding binding = find(fn, expr.head.value.sym_value, index);
+  expr.frameSlot = binding == Local ? static_cast<int>(index) : -1;
+  expr.captureSlot = binding == Captured ? static_cast<int>(index) : -1;
+}
+
+// A subtree without binding forms needs no resolution at the top level,
+// and is left shared. The answer for the elements of a tail is remembered
+// per storage, which is never freed while the resolver runs.
+bool ScopeResolver::containsBinder(const Expression & expr)
+{
+  if (expr.tail.empty())
+  {
+    return false;
+  }
+  if (isBindingForm(expr))
+  {
+    return true;
+  }
+  auto it = binders.find(expr.tail.storage());
+  if (it != binders.end())
+  {
+    return it->second;
+  }
+  bool found = false;
+  for (const auto & e : expr.tail)
+  {
+    if (containsBinder(e))
+    {
+      found = true;
+      break;
+    }
+  }
+  binders[expr.tail.storage()] = found;
+  return found;
+}
+
+void ScopeResolver::checkNames(const std::vector<Symbol> & names, const std::string & form)
+{
+  for (std::size_t i = 0; i < names.size(); ++i)
+  {
+    if (isSpecialForm(names[i]))
+    {
+      throw InterpreterSemanticError("Error: Cannot bind special form in '" + form + "'.");
+    }
+    if (std::find(names.begin(), names.begin() + i, names[i]) != names.begin() + i)
+    {
+      throw InterpreterSemanticError("Error: Duplicate variable in '" + form + "'.");
+    }
+  }
+}
+
+void ScopeResolver::resolve(Expression & expr, Function & fn)
+{
+  bool topLevel = fn.parent == nullptr && fn.locals.empty();
+  const Tail & operands = expr.tail;
+  if (expr.tail.empty())
+  {
+    if (expr.head.type == SymbolType && !topLevel)
+    {
+      bind(expr, fn);
+    }
+    return;
+  }
+
+  if (expr.head.type == SymbolType)
+  {
+    const Symbol & symbol = expr.head.value.sym_value;
+    if (symbol == "lambda")
+    {
+      resolveLambda(expr, fn);
+      return;
+    }
+    if (symbol == "let")
+    {
+      resolveLet(expr, fn);
+      return;
+    }
+    if (isLoop(symbol))
+    {
+      resolveLoop(expr, fn);
+      return;
+    }
+    if (symbol == "set!")
+    {
+      // a captured variable is a copy, assigning it would go unseen
+      if (operands.size() == 2 && operands[0].head.type == SymbolType && operands[0].tail.empty())
+      {
+        if (!topLevel)
+        {
+          Expression & variable = expr.tail[0];
+          bind(variable, fn);
+          if (variable.captureSlot >= 0)
+          {
+            throw InterpreterSemanticError("Error: Cannot set! a variable captured by lambda.");
+          }
+        }
+        if (!topLevel || containsBinder(operands[1]))
+        {
+          resolve(expr.tail[1], fn);
+        }
+      }
+      return;
+    }
+    if (symbol == "define")
+    {
+      // define always binds a global, never a variable of lambda or let
+      if (operands.size() == 2 && operands[0].head.type == SymbolType)
+      {
+        std::size_t index = 0;
+        if (!topLevel && find(fn, operands[0].head.value.sym_value, index) != Global)
+        {
+          throw InterpreterSemanticError("Error: Cannot define a variable bound by lambda or let.");
+        }
+        if (!topLevel || containsBinder(operands[1]))
+        {
+          resolve(expr.tail[1], fn);
+        }
+      }
+      return;
+    }
+    if (!topLevel && symbol != "if" && symbol != "begin")
+    {
+      bind(expr, fn);
+    }
+  }
+
+  for (std::size_t i = 0; i < operands.size(); ++i)
+  {
+    if (!topLevel || containsBinder(operands[i]))
+    {
+      // non-const access unshares the tail before its elements are annotated
+      Expression & e = expr.tail[i];
+      e.cseSlot = -1;
+      resolve(e, fn);
+    }
+  }
+}
+
+void ScopeResolver::resolveLambda(Expression & expr, Function & fn)
+{
+  std::vector<Symbol> params;
+  if (!lambdaParameters(expr, params))
+  {
+    throw InterpreterSemanticError("Error: Incorrect use of 'lambda'.");
+  }
+  checkNames(params, "lambda");
+
+  Function inner{&fn, {}, params.size(), {}, {}};
+  for (std::size_t i = 0; i < params.size(); ++i)
+  {
+    inner.locals.emplace_back(params[i], i);
+  }
+
+  Expression & body = expr.tail[1];
+  body.cseSlot = -1;
+  resolve(body, inner);
+
+  std::shared_ptr<LambdaInfo> info = std::make_shared<LambdaInfo>();
+  info->params = params.size();
+  info->frameSize = inner.frameSize;
+  info->captures = inner.captures;
+  info->body = body;
+  expr.lambda = info;
+}
+
+void ScopeResolver::resolveLet(Expression & expr, Function & fn)
+{
+  std::vector<Symbol> names;
+  if (!letBindings(expr, names))
+  {
+    throw InterpreterSemanticError("Error: Incorrect use of 'let'.");
+  }
+  checkNames(names, "let");
+
+  // the values are computed in the enclosing scope, as in Scheme's let
+  Tail & bindings = expr.tail[0].tail;
+  for (std::size_t i = 0; i < bindings.size(); ++i)
+  {
+    Expression & value = bindings[i].tail[0];
+    value.cseSlot = -1;
+    resolve(value, fn);
+  }
+
+  std::size_t live = fn.locals.size();
+  for (std::size_t i = 0; i < names.size(); ++i)
+  {
+    std::size_t slot = fn.locals.size();
+    fn.locals.emplace_back(names[i], slot);
+    bindings[i].frameSlot = static_cast<int>(slot);
+  }
+  fn.frameSize = std::max(fn.frameSize, fn.locals.size());
+
+  Expression & body = expr.tail[1];
+  body.cseSlot = -1;
+  resolve(body, fn);
+
+  // sibling lets reuse the slots
+  fn.locals.resize(live);
+}
+
+void ScopeResolver::resolveLoop(Expression & expr, Function & fn)
+{
+  const Symbol form = expr.head.value.sym_value;
+  std::vector<Symbol> names;
+  if (!loopVariable(expr, names))
+  {
+    throw InterpreterSemanticError("Error: Incorrect use of '" + form + "'.");
+  }
+  checkNames(names, form);
+
+  // bounds, initial value and count are computed in the enclosing scope
+  Expression & variable = expr.tail[0];
+  for (std::size_t i = 0; i < variable.tail.size(); ++i)
+  {
+    Expression & bound = variable.tail[i];
+    bound.cseSlot = -1;
+    resolve(bound, fn);
+  }
+  if (form == "repeat")
+  {
+    Expression & count = expr.tail[1];
+    count.cseSlot = -1;
+    resolve(count, fn);
+  }
+
+  std::size_t slot = fn.locals.size();
+  fn.locals.emplace_back(names[0], slot);
+  expr.tail[0].frameSlot = static_cast<int>(slot);
+  fn.frameSize = std::max(fn.frameSize, fn.locals.size());
+
+  Expression & body = expr.tail[expr.tail.size() - 1];
+  body.cseSlot = -1;
+  resolve(body, fn);
+
+  fn.locals.pop_back();
+}
+
+std::size_t ScopeResolver::resolveTopLevel(Expression & ast)
+{
+  Function top{nullptr, {}, 0, {}, {}};
+  resolve(ast, top);
+  return top.frameSize;
+}
+
+std::size_t resolveScopes(Expression & ast)
+{
+  ScopeResolver resolver;
+  return resolver.resolveTopLevel(ast);
+}
@@ -0,0 +1,47 @@
+#ifndef CLOSURE_HPP
+#define CLOSURE_HPP
+
+// system includes
+#include <cstddef>
+#include <vector>
+
+// module includes
+#include "expression.hpp"
+
+// Where a captured variable is found when the closure is created:
+// a slot of the enclosing frame, or a captured value of the enclosing closure
+struct CaptureSource{
+  bool captured;
+  std::size_t index;
+};
+
+// A lambda after scope resolution. Its parameters take the first slots of
+// the frame, variables bound by let inside the body the following ones.
+struct LambdaInfo{
+  std::size_t params;
+  std::size_t frameSize;
+  std::vector<CaptureSource> captures;
+  Expression body;
+};
+
+// A Closure is a lambda with flat copies of the variables it captured
+struct Closure{
+  std::shared_ptr<const LambdaInfo> lambda;
+  std::vector<Expression> captured;
+};
+
+// Resolves every variable bound by lambda, let or a loop in ast to a frame
+// slot or a captured value, annotating the references and the lambda expressions.
+// Subtrees inside binding forms are unshared so their annotations are their own.
+// Returns the frame size needed by let and loops at the top level.
+// Throws InterpreterSemanticError on a malformed binding form.
+std::size_t resolveScopes(Expression & ast);
+
+// true for lambda, let, dotimes, for and repeat
+bool isBindingForm(const Expression & expr);
+
+// Appends the names bound by a binding form to names.
+// Returns false if the form is malformed.
+bool boundNames(const Expression & expr, std::vector<Symbol> & names);
+
+#endif
@@ -0,0 +1,233 @@
+#include "constant_folding.hpp"
+
+// system includes
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+// module includes
+#include "type_inference.hpp"
+#include "interpreter_semantic_error.hpp"
+#include "closure.hpp"
+
+// Builtin symbols that can never be rebound by define
+static const char * const immutableSymbols[] = {"pi"};
+
+static bool isImmutableSymbol(const Symbol& symbol)
+{
+  for (const char * name : immutableSymbols)
+  {
+    if (symbol == name)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool isLiteral(const Expression& expr)
+{
+  return expr.tail.empty() && expr.head.type != SymbolType && expr.head.type != NoneType;
+}
+
+// Collects every symbol the program binds with define, lambda or let, since
+// such a binding can replace a builtin procedure before the call is reached
+void collectDefinitions(const Expression& expr, std::set<Symbol>& defined)
+{
+  if (expr.head.type == SymbolType && expr.head.value.sym_value == "define" &&
+      !expr.tail.empty() && expr.tail[0].head.type == SymbolType)
+  {
+    defined.insert(expr.tail[0].head.value.sym_value);
+  }
+  std::vector<Symbol> bound;
+  boundNames(expr, bound);
+  defined.insert(bound.begin(), bound.end());
+  for (const auto& e : expr.tail)
+  {
+    collectDefinitions(e, defined);
+  }
+}
+
+void collectAssignments(const Expression& expr, std::set<Symbol>& assigned)
+{
+  if (expr.head.type == SymbolType && expr.head.value.sym_value == "set!" &&
+      !expr.tail.empty() && expr.tail[0].head.type == SymbolType)
+  {
+    assigned.insert(expr.tail[0].head.value.sym_value);
+  }
+  for (const auto& e : expr.tail)
+  {
+    collectAssignments(e, assigned);
+  }
+}
+
+// Folding reads the AST through const access and writes only the nodes it
+// changes, so subtrees shared by hash consing stay shared. The result for a
+// shared subtree is remembered and reused for its other occurrences.
+class ConstantFolder
+{
+public:
+  ConstantFolder(const Environment& environment, const std::set<Symbol>& definitions)
+    : env(environment), defined(definitions) {}
+
+  // Returns true if expr was rewritten
+  bool fold(Expression& expr);
+
+  std::size_t folded = 0;
+
+private:
+  bool foldOperands(Expression& expr, std::size_t first);
+  bool foldNode(Expression& expr);
+  bool foldCall(Expression& expr);
+
+  const Environment& env;
+  const std::set<Symbol>& defined;
+  std::map<std::pair<const void *, Symbol>, Expression> results;
+  std::set<std::pair<const void *, Symbol>> unchanged;
+  std::vector<Tail> originals;
+};
+
+bool ConstantFolder::fold(Expression& expr)
+{
+  if (expr.tail.empty())
+  {
+    if (expr.head.type == SymbolType && isImmutableSymbol(expr.head.value.sym_value) &&
+        defined.count(expr.head.value.sym_value) == 0)
+    {
+      const Expression * value = env.lookupExpression(expr.head.value.sym_value);
+      if (value != nullptr)
+      {
+        expr = *value;
+        ++folded;
+        return true;
+      }
+    }
+    return false;
+  }
+  if (expr.head.type == ListType)
+  {
+    // a list with no operator, such as the bindings of let or the call
+    // ((lambda (x) x) 1), only has its elements folded
+    return foldOperands(expr, 0);
+  }
+  if (expr.head.type != SymbolType)
+  {
+    return false;
+  }
+
+  std::pair<const void *, Symbol> key(expr.tail.storage(), expr.head.value.sym_value);
+  if (unchanged.count(key) != 0)
+  {
+    return false;
+  }
+  auto it = results.find(key);
+  if (it != results.end())
+  {
+    expr = it->second;
+    ++folded;
+    return true;
+  }
+
+  // holding the original tail keeps its storage, and so the key, from being
+  // modified in place or freed and reused while the pass runs
+  originals.push_back(expr.tail);
+  if (!foldNode(expr))
+  {
+    unchanged.insert(key);
+    return false;
+  }
+  results.emplace(key, expr);
+  return true;
+}
+
+// Folds the operands of expr from first on
+bool ConstantFolder::foldOperands(Expression& expr, std::size_t first)
+{
+  const Tail& operands = expr.tail;
+  bool changed = false;
+  for (std::size_t i = first; i < operands.size(); ++i)
+  {
+    Expression operand = operands[i];
+    if (fold(operand))
+    {
+      expr.tail[i] = operand;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+bool ConstantFolder::foldNode(Expression& expr)
+{
+  const Symbol symbol = expr.head.value.sym_value;
+  const Tail& operands = expr.tail;
+
+  // the first operand of define and set! names the variable and is never evaluated
+  bool changed = foldOperands(expr, symbol == "define" || symbol == "set!" ? 1 : 0);
+
+  if (symbol == "if")
+  {
+    if (operands.size() == 3 && isLiteral(operands[0]) && operands[0].head.type == BooleanType)
+    {
+      Expression branch = operands[0].head.value.bool_value ? operands[1] : operands[2];
+      expr = branch;
+      ++folded;
+      return true;
+    }
+    return changed;
+  }
+  if (symbol == "begin" || symbol == "define" || symbol == "set!")
+  {
+    return changed;
+  }
+  return foldCall(expr) || changed;
+}
+
+bool ConstantFolder::foldCall(Expression& expr)
+{
+  const Symbol& symbol = expr.head.value.sym_value;
+  if (defined.count(symbol) != 0)
+  {
+    return false;
+  }
+  Procedure procedure = env.lookupProcedure(symbol);
+  if (procedure == nullptr || findSignature(procedure) == nullptr)
+  {
+    return false;
+  }
+
+  std::vector<Atom> args;
+  args.reserve(expr.tail.size());
+  for (const auto& e : static_cast<const Tail&>(expr.tail))
+  {
+    if (!isLiteral(e))
+    {
+      return false;
+    }
+    args.push_back(e.head);
+  }
+
+  try
+  {
+    Expression value = procedure(args);
+    expr = value;
+    ++folded;
+    return true;
+  }
+  catch (const InterpreterSemanticError&)
+  {
+    // leave the call in place so it fails at run time
+    return false;
+  }
+}
+
+std::size_t foldConstants(Expression& ast, const Environment& env)
+{
+  std::set<Symbol> defined;
+  collectDefinitions(ast, defined);
+
+  ConstantFolder folder(env, defined);
+  folder.fold(ast);
+  return folder.folded;
+}
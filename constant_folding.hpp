@@ -0,0 +1,27 @@
+#ifndef CONSTANT_FOLDING_HPP
+#define CONSTANT_FOLDING_HPP
+
+// system includes
+#include <cstddef>
+#include <set>
+
+// module includes
+#include "expression.hpp"
+#include "environment.hpp"
+
+// Rewrites ast in place, replacing calls to pure builtins whose arguments are
+// all literals (or the immutable builtin pi) by their value, and replacing
+// (if c a b) by a or b when c folds to a Boolean. Lists with no operator,
+// such as let bindings and calls of a lambda expression, are folded within.
+// A call that would fail is left alone so the error is raised at run time,
+// exactly as without folding.
+// Returns the number of nodes folded or pruned.
+std::size_t foldConstants(Expression& ast, const Environment& env);
+
+// Collects the symbols bound by define, lambda or let anywhere in expr
+void collectDefinitions(const Expression& expr, std::set<Symbol>& defined);
+
+// Collects the symbols assigned by set! anywhere in expr
+void collectAssignments(const Expression& expr, std::set<Symbol>& assigned);
+
+#endif
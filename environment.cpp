@@ -1,13 +1,24 @@
 #include "environment.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <utility>
 
 #include "interpreter_semantic_error.hpp"
+#include "sequence.hpp"
+#include "number_vector.hpp"
+#include "fast_math.hpp"
+#include "point_buffer.hpp"
 
 //Functon that handles a logical negation procedure
 Expression notProcedure(const std::vector<Atom>& args)
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::Not, args);
+    }
     if (args.size() != 1 || args[0].type != BooleanType)
     {
         throw InterpreterSemanticError("Error: Invalid argument for not");
@@ -18,6 +29,10 @@ Expression notProcedure(const std::vector<Atom>& args)
 //Functon that handles a logical AND procedure
 Expression andProcedure(const std::vector<Atom>& args)
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::And, args);
+    }
     if (args.size() < 2)
     {
         throw InterpreterSemanticError("Error: Too few arguments for AND");
@@ -43,6 +58,10 @@ Expression andProcedure(const std::vector<Atom>& args)
 //Functon that handles a logical OR procedure
 Expression orProcedure(const std::vector<Atom>& args)
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::Or, args);
+    }
     if (args.size() < 2)
     {
         throw InterpreterSemanticError("Error: Too few arguments for OR");
@@ -66,24 +85,98 @@ Expression orProcedure(const std::vector<Atom>& args)
     return Expression(false);
 }
 
+// Arithmetic of numbers. Integers give integers, exactly, and fall back
+// to doubles when the result does not fit in an Integer.
+static Expression sumOf(const std::vector<Atom>& args)
+{
+    double sum = 0.0;
+    Integer integerSum = 0;
+    bool integer = true;
+    for (const auto& arg : args)
+    {
+        sum += arg.value.num_value;
+        integer = integer && arg.value.is_integer && addIntegers(integerSum, arg.value.int_value, integerSum);
+    }
+    return integer ? Expression(integerSum) : Expression(sum);
+}
+
+static Expression productOf(const std::vector<Atom>& args)
+{
+    double product = 1.0;
+    Integer integerProduct = 1;
+    bool integer = true;
+    for (const auto& arg : args)
+    {
+        product *= arg.value.num_value;
+        integer = integer && arg.value.is_integer && multiplyIntegers(integerProduct, arg.value.int_value, integerProduct);
+    }
+    return integer ? Expression(integerProduct) : Expression(product);
+}
+
+static Expression differenceOf(const Atom& a, const Atom& b)
+{
+    Integer difference;
+    if (a.value.is_integer && b.value.is_integer && subtractIntegers(a.value.int_value, b.value.int_value, difference))
+    {
+        return Expression(difference);
+    }
+    return Expression(a.value.num_value - b.value.num_value);
+}
+
+static Expression negationOf(const Atom& a)
+{
+    Integer negation;
+    if (a.value.is_integer && subtractIntegers(0, a.value.int_value, negation))
+    {
+        return Expression(negation);
+    }
+    return Expression(-a.value.num_value);
+}
+
+// Comparisons of two integers are exact, without converting to doubles
+static bool lessThan(const Atom& a, const Atom& b)
+{
+    return a.value.is_integer && b.value.is_integer ? a.value.int_value < b.value.int_value : a.value.num_value < b.value.num_value;
+}
+
+static bool lessThanOrEqual(const Atom& a, const Atom& b)
+{
+    return a.value.is_integer && b.value.is_integer ? a.value.int_value <= b.value.int_value : a.value.num_value <= b.value.num_value;
+}
+
+static bool equal(const Atom& a, const Atom& b)
+{
+    return a.value.is_integer && b.value.is_integer ? a.value.int_value == b.value.int_value : a.value.num_value == b.value.num_value;
+}
+
 //Functon that handles an arithmetic add procedure
 Expression ADDProcedure(const std::vector<Atom>& args)
 {
-    double sum = 0.0;
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::Add, args);
+    }
+    if (args.size() < 2)
+    {
+        throw InterpreterSemanticError("Error: Invalid argument for addition");
+    }
     for (const auto& arg : args)
     {
-        if (arg.type != NumberType || args.size() < 2)
+        if (arg.type != NumberType)
         {
             throw InterpreterSemanticError("Error: Invalid argument for addition");
         }
-        sum += arg.value.num_value;
     }
-    return Expression(sum);
+    return sumOf(args);
 }
 
 //Functon that handles an arithmetic subtract procedure
 Expression subtractProcedure(const std::vector<Atom>& args)
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::Subtract, args);
+    }
     //Unary minus sign
     if (args.size() == 1)
     {
@@ -91,7 +184,7 @@ Expression subtractProcedure(const std::vector<Atom>& args)
         {
             throw InterpreterSemanticError("Error: Invalid argument for unary subtraction");
         }
-        return Expression(-args[0].value.num_value);
+        return negationOf(args[0]);
     }
 
     //Binary Subtraction 
@@ -101,7 +194,7 @@ Expression subtractProcedure(const std::vector<Atom>& args)
         {
             throw InterpreterSemanticError("Error: Invalid arguments for binary subtraction");
         }
-        return Expression(args[0].value.num_value - args[1].value.num_value);
+        return differenceOf(args[0], args[1]);
     }
 
     throw InterpreterSemanticError("Error: Invalid number of arguments for subtraction");
@@ -110,26 +203,32 @@ Expression subtractProcedure(const std::vector<Atom>& args)
 //Functon that handles an arithmetic multiply procedure
 Expression multiplyProcedure(const std::vector<Atom>& args)
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::Multiply, args);
+    }
     if (args.size() < 2)
     {
         throw InterpreterSemanticError("Error: Invalid number of arguments for multiplication");
     }
 
-    double product = 1.0;
     for (const auto& arg : args)
     {
         if (arg.type != NumberType)
         {
             throw InterpreterSemanticError("Error: Invalid argument for multiplication");
         }
-        product *= arg.value.num_value;
     }
-    return Expression(product);
+    return productOf(args);
 }
 
 //Functon that handles an arithmetic divide procedure
 Expression divideProcedure(const std::vector<Atom>& args)
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::Divide, args);
+    }
     if (args.size() != 2 || args[0].type != NumberType || args[1].type != NumberType || args[1].value.num_value == 0)
     {
         throw InterpreterSemanticError("Error: Invalid arguments for division");
@@ -140,56 +239,80 @@ Expression divideProcedure(const std::vector<Atom>& args)
 //Functon that handles a less than comparison procedure
 Expression lessThanProcedure(const std::vector<Atom>& args)
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::Less, args);
+    }
     if (args.size() != 2 || args[0].type != NumberType || args[1].type != NumberType)
     {
         throw InterpreterSemanticError("Error: Invalid arguments for < operation");
     }
-    return Expression(args[0].value.num_value < args[1].value.num_value);
+    return Expression(lessThan(args[0], args[1]));
 }
 
 //Functon that handles a less than or equal procedure
 Expression lessThanOrEqualProcedure(const std::vector<Atom>& args)
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::LessEqual, args);
+    }
     if (args.size() != 2 || args[0].type != NumberType || args[1].type != NumberType)
     {
         throw InterpreterSemanticError("Error: Invalid arguments for <= operation");
     }
-    return Expression(args[0].value.num_value <= args[1].value.num_value);
+    return Expression(lessThanOrEqual(args[0], args[1]));
 }
 
 //Functon that handles a greater than comparison procedure
 Expression greaterThanProcedure(const std::vector<Atom>& args)
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::Greater, args);
+    }
     if (args.size() != 2 || args[0].type != NumberType || args[1].type != NumberType)
     {
         throw InterpreterSemanticError("Error: Invalid arguments for > operation");
     }
-    return Expression(args[0].value.num_value > args[1].value.num_value);
+    return Expression(lessThan(args[1], args[0]));
 }
 
 //Functon that handles a greater than or equal comparison procedure
 Expression greaterThanOrEqualProcedure(const std::vector<Atom>& args)
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::GreaterEqual, args);
+    }
     if (args.size() != 2 || args[0].type != NumberType || args[1].type != NumberType)
     {
         throw InterpreterSemanticError("Error: Invalid arguments for >= operation");
     }
-    return Expression(args[0].value.num_value >= args[1].value.num_value);
+    return Expression(lessThanOrEqual(args[1], args[0]));
 }
 
 //Functon that handles an equal comparison procedure
 Expression equalProcedure(const std::vector<Atom>& args)
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::Equal, args);
+    }
     if (args.size() != 2 || args[0].type != NumberType || args[1].type != NumberType)
     {
         throw InterpreterSemanticError("Error: Invalid arguments for = operation");
     }
-    return Expression(args[0].value.num_value == args[1].value.num_value);
+    return Expression(equal(args[0], args[1]));
 }
 
 //Functon that handles an arithmetic logarithmic procedure
 Expression log10Procedure(const std::vector<Atom>& args)
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::Log10, args);
+    }
     if (args.size() != 1 || args[0].type != NumberType)
     {
         throw InterpreterSemanticError("Error: Invalid arguments for log10 operation");
@@ -204,6 +327,10 @@ Expression log10Procedure(const std::vector<Atom>& args)
 //Functon that handles an arithmetic power procedure
 Expression powProcedure(const std::vector<Atom>& args)
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::Pow, args);
+    }
     if (args.size() != 2 || args[0].type != NumberType || args[1].type != NumberType)
     {
         throw InterpreterSemanticError("Error: Invalid arguments for pow operation");
@@ -255,81 +382,430 @@ Expression arcProcedure(const std::vector<Atom>& args)
     return Expression(std::make_tuple(centerPoint.x, centerPoint.y), std::make_tuple(startPoint.x, startPoint.y), angle);
 }
 
+// sin, cos and atan2 of the builtins, from libm unless fast math is enabled
+static Number sine(Number x)
+{
+    return fastMath() ? fastSin(x) : std::sin(x);
+}
 
+static Number cosine(Number x)
+{
+    return fastMath() ? fastCos(x) : std::cos(x);
+}
+
+static Number arctangent(Number y, Number x)
+{
+    return fastMath() ? fastAtan2(y, x) : std::atan2(y, x);
+}
 
 // Procedure for sin function
 Expression sinProcedure(const std::vector<Atom>& args) 
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::Sin, args);
+    }
     if (args.size() != 1 || args[0].type != NumberType) 
     {
         throw InterpreterSemanticError("Error: Invalid number of arguments for sin, expected 1.");
     }
-    return Expression(std::sin(args[0].value.num_value));
+    return Expression(sine(args[0].value.num_value));
 }
 
 // Procedure for cos function
 Expression cosProcedure(const std::vector<Atom>& args) 
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::Cos, args);
+    }
     if (args.size() != 1 || args[0].type != NumberType) 
     {
         throw InterpreterSemanticError("Error: Invalid number of arguments for cos, expected 1.");
     }
-    return Expression(std::cos(args[0].value.num_value));
+    return Expression(cosine(args[0].value.num_value));
 }
 
 // Procedure for arctan function
 Expression arctanProcedure(const std::vector<Atom>& args) 
 {
+    if (hasPackedArgument(args))
+    {
+        return broadcast(Elementwise::Arctan, args);
+    }
     if (args.size() != 2 || args[0].type != NumberType || args[1].type != NumberType) 
     {
         throw InterpreterSemanticError("Error: Invalid number of arguments for arctan, expected 2.");
     }
-    return Expression(std::atan2(args[0].value.num_value, args[1].value.num_value));
+    return Expression(arctangent(args[0].value.num_value, args[1].value.num_value));
 }
 
+// The expression draw returns for one graphic
+static Expression drawnExpression(const Atom& arg)
+{
+    if (arg.type == PointType)
+    {
+        return Expression(std::make_tuple(arg.value.point_value.x, arg.value.point_value.y));
+    }
+    else if (arg.type == LineType)
+    {
+        Point startPoint = arg.value.line_value.first;
+        Point endPoint = arg.value.line_value.second;
+        return Expression(std::make_tuple(startPoint.x, startPoint.y), std::make_tuple(endPoint.x, endPoint.y));
+    }
+    else if (arg.type == SequenceType)
+    {
+        // the elements are drawn as they are pulled from the sequence
+        if (!arg.value.sequence()->bounded())
+        {
+            throw InterpreterSemanticError("Error: Cannot draw an unbounded sequence.");
+        }
+        std::shared_ptr<Sequence> drawn = std::make_shared<Sequence>();
+        drawn->kind = Sequence::Draw;
+        drawn->source = arg.value.shared<Sequence>();
+        return sequenceExpression(drawn);
+    }
+    else if (isShape(arg.type))
+    {
+        // a shape is drawn whole, as one item
+        return Expression(arg);
+    }
+    else if (arg.type == ArcType)
+    {
+        Point centerPoint = arg.value.arc_value.center;
+        Point startPoint = arg.value.arc_value.start;
+        double angle = arg.value.arc_value.span;
+        return Expression(std::make_tuple(centerPoint.x, centerPoint.y), std::make_tuple(startPoint.x, startPoint.y), angle);
+    }
+    throw InterpreterSemanticError("Error: Invalid argument for draw procedure. Expected point, line, arc or shape.");
+}
+
+// Draws one graphic, returning it, or several, returning the list of them.
+// The interpreter passes the elements of list arguments in their place.
 Expression drawProcedure(const std::vector<Atom>& args)
 {
     if (args.empty())
     {
         throw InterpreterSemanticError("Error: Draw procedure expects at least one argument.");
     }
+    if (args.size() == 1)
+    {
+        return drawnExpression(args[0]);
+    }
 
-    // Check each argument to ensure it's a graphical object and "draw" them
-    for (size_t i = 0; i < args.size(); ++i)
+    // every argument is checked before any is drawn
+    std::vector<Expression> drawn;
+    drawn.reserve(args.size());
+    for (const auto& arg : args)
     {
-        const auto& arg = args[i];
-       
-        if (arg.type == PointType)
+        drawn.push_back(drawnExpression(arg));
+    }
+    Expression list;
+    list.head.type = ListType;
+    list.tail = Tail(drawn);
+    return list;
+}
+
+
+// Source of environment versions. A single global counter guarantees a
+// version is never reused, even after resetEnvironment() or copying.
+static std::atomic<unsigned long> nextVersion(0);
+
+static unsigned long freshVersion()
+{
+    return ++nextVersion;
+}
+// Unchecked variants of the builtins.
+// Called only at call sites where type inference has proven the argument
+// count and types, so they skip those checks. Checks on argument values
+// (division by zero, the domain of log10) are kept.
+
+Expression notUnchecked(const std::vector<Atom>& args)
+{
+    return Expression(!args[0].value.bool_value);
+}
+
+Expression andUnchecked(const std::vector<Atom>& args)
+{
+    for (const auto& arg : args)
+    {
+        if (!arg.value.bool_value)
         {
-            return Expression(std::make_tuple(arg.value.point_value.x, arg.value.point_value.y));
+            return Expression(false);
         }
-        else if (arg.type == LineType)
+    }
+    return Expression(true);
+}
+
+Expression orUnchecked(const std::vector<Atom>& args)
+{
+    for (const auto& arg : args)
+    {
+        if (arg.value.bool_value)
         {
-            Point startPoint = arg.value.line_value.first;
-            Point endPoint = arg.value.line_value.second;
-            return Expression(std::make_tuple(startPoint.x, startPoint.y), std::make_tuple(endPoint.x, endPoint.y));
+            return Expression(true);
         }
-        else if (arg.type == ArcType)
+    }
+    return Expression(false);
+}
+
+Expression ADDUnchecked(const std::vector<Atom>& args)
+{
+    return sumOf(args);
+}
+
+Expression subtractUnchecked(const std::vector<Atom>& args)
+{
+    if (args.size() == 1)
+    {
+        return negationOf(args[0]);
+    }
+    return differenceOf(args[0], args[1]);
+}
+
+Expression multiplyUnchecked(const std::vector<Atom>& args)
+{
+    return productOf(args);
+}
+
+Expression divideUnchecked(const std::vector<Atom>& args)
+{
+    if (args[1].value.num_value == 0)
+    {
+        throw InterpreterSemanticError("Error: Invalid arguments for division");
+    }
+    return Expression(args[0].value.num_value / args[1].value.num_value);
+}
+
+Expression lessThanUnchecked(const std::vector<Atom>& args)
+{
+    return Expression(lessThan(args[0], args[1]));
+}
+
+Expression lessThanOrEqualUnchecked(const std::vector<Atom>& args)
+{
+    return Expression(lessThanOrEqual(args[0], args[1]));
+}
+
+Expression greaterThanUnchecked(const std::vector<Atom>& args)
+{
+    return Expression(lessThan(args[1], args[0]));
+}
+
+Expression greaterThanOrEqualUnchecked(const std::vector<Atom>& args)
+{
+    return Expression(lessThanOrEqual(args[1], args[0]));
+}
+
+Expression equalUnchecked(const std::vector<Atom>& args)
+{
+    return Expression(equal(args[0], args[1]));
+}
+
+Expression log10Unchecked(const std::vector<Atom>& args)
+{
+    if (args[0].value.num_value <= 0)
+    {
+        throw InterpreterSemanticError("Error: Non-positive argument for log10");
+    }
+    return Expression(std::log10(args[0].value.num_value));
+}
+
+Expression powUnchecked(const std::vector<Atom>& args)
+{
+    return Expression(std::pow(args[0].value.num_value, args[1].value.num_value));
+}
+
+Expression pointUnchecked(const std::vector<Atom>& args)
+{
+    return Expression(std::make_tuple(args[0].value.num_value, args[1].value.num_value));
+}
+
+Expression lineUnchecked(const std::vector<Atom>& args)
+{
+    const Point& startPoint = args[0].value.point_value;
+    const Point& endPoint = args[1].value.point_value;
+    return Expression(std::make_tuple(startPoint.x, startPoint.y), std::make_tuple(endPoint.x, endPoint.y));
+}
+
+Expression arcUnchecked(const std::vector<Atom>& args)
+{
+    const Point& centerPoint = args[0].value.point_value;
+    const Point& startPoint = args[1].value.point_value;
+    return Expression(std::make_tuple(centerPoint.x, centerPoint.y), std::make_tuple(startPoint.x, startPoint.y), args[2].value.num_value);
+}
+
+Expression sinUnchecked(const std::vector<Atom>& args)
+{
+    return Expression(sine(args[0].value.num_value));
+}
+
+Expression cosUnchecked(const std::vector<Atom>& args)
+{
+    return Expression(cosine(args[0].value.num_value));
+}
+
+Expression arctanUnchecked(const std::vector<Atom>& args)
+{
+    return Expression(arctangent(args[0].value.num_value, args[1].value.num_value));
+}
+
+
+//Procedure to create a lazy sequence of numbers:
+//(range end), (range start end) or (range start end step)
+Expression rangeProcedure(const std::vector<Atom>& args)
+{
+    if (args.empty() || args.size() > 3)
+    {
+        throw InterpreterSemanticError("Error: Invalid number of arguments for range, expected 1 to 3.");
+    }
+    for (const auto& arg : args)
+    {
+        if (arg.type != NumberType)
         {
-            Point centerPoint = arg.value.arc_value.center;
-            Point startPoint = arg.value.arc_value.start;
-            double angle = arg.value.arc_value.span;
-            return Expression(std::make_tuple(centerPoint.x, centerPoint.y), std::make_tuple(startPoint.x, startPoint.y), angle);
+            throw InterpreterSemanticError("Error: Invalid arguments for range, expected numbers.");
         }
-        else
+    }
+    std::shared_ptr<Sequence> range = std::make_shared<Sequence>();
+    range->kind = Sequence::Range;
+    Number end = args[0].value.num_value;
+    if (args.size() > 1)
+    {
+        range->start = args[0].value.num_value;
+        end = args[1].value.num_value;
+    }
+    if (args.size() > 2)
+    {
+        range->step = args[2].value.num_value;
+    }
+    if (range->step == 0)
+    {
+        throw InterpreterSemanticError("Error: Step of range is zero.");
+    }
+    range->count = std::max(0.0, std::ceil((end - range->start) / range->step));
+
+    // the elements are integers if start and step are, and exact as doubles;
+    // the count is exact too if end is an integer
+    const Number exact = 9007199254740992.0; // 2^53
+    auto exactInteger = [&](const Atom& arg) { return arg.value.is_integer && std::fabs(arg.value.num_value) <= exact; };
+    range->integer = (args.size() == 1 || exactInteger(args[0])) && (args.size() < 3 || exactInteger(args[2]));
+    const Atom& last = args[args.size() == 1 ? 0 : 1];
+    if (range->integer && last.value.is_integer)
+    {
+        range->count = integerCount(static_cast<Integer>(range->start), last.value.int_value, static_cast<Integer>(range->step));
+    }
+    return sequenceExpression(range);
+}
+
+//Procedure to take the first n elements of a sequence
+Expression takeProcedure(const std::vector<Atom>& args)
+{
+    if (args.size() != 2 || args[0].type != NumberType || args[1].type != SequenceType || args[0].value.num_value < 0)
+    {
+        throw InterpreterSemanticError("Error: Invalid arguments for take, expected a count and a sequence.");
+    }
+    std::shared_ptr<Sequence> taken = std::make_shared<Sequence>();
+    taken->kind = Sequence::Take;
+    taken->count = args[0].value.num_value;
+    taken->source = args[1].value.shared<Sequence>();
+    return sequenceExpression(taken);
+}
+
+//Procedure to pack numbers into a vector
+Expression vectorProcedure(const std::vector<Atom>& args)
+{
+    std::vector<Number> values;
+    values.reserve(args.size());
+    for (const auto& arg : args)
+    {
+        if (arg.type != NumberType)
         {
-            throw InterpreterSemanticError("Error: Invalid argument for draw procedure. Expected point, line, or arc.");
+            throw InterpreterSemanticError("Error: Invalid arguments for vector, expected numbers.");
         }
+        values.push_back(arg.value.num_value);
+    }
+    return vectorExpression(std::move(values));
+}
+
+//Procedure to create a vector of n numbers evenly spaced from start to end
+// The largest count of linspace, 1 GiB of numbers. A larger, infinite or
+// NaN count is an error before anything is allocated.
+static const std::size_t maxLinspaceCount = std::size_t(1) << 27;
+
+Expression linspaceProcedure(const std::vector<Atom>& args)
+{
+    if (args.size() != 3 || args[0].type != NumberType || args[1].type != NumberType || args[2].type != NumberType ||
+        args[2].value.num_value < 0 || args[2].value.num_value != std::floor(args[2].value.num_value))
+    {
+        throw InterpreterSemanticError("Error: Invalid arguments for linspace, expected start, end and a count.");
+    }
+    if (!(args[2].value.num_value <= static_cast<Number>(maxLinspaceCount)))
+    {
+        throw InterpreterSemanticError("Error: Count of linspace is too large.");
+    }
+    Number start = args[0].value.num_value;
+    Number end = args[1].value.num_value;
+    std::size_t count = static_cast<std::size_t>(args[2].value.num_value);
+    std::vector<Number> values(count);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        values[i] = count == 1 ? start : start + (end - start) * i / (count - 1);
     }
+    return vectorExpression(std::move(values));
+}
+
+//Procedures to pack points into shapes, see point_buffer.hpp. Arguments that
+//are sequences of points are collected by the interpreter as they are pulled.
+Expression pointsProcedure(const std::vector<Atom>& args)
+{
+    ShapeBuilder builder(PointsType);
+    builder.addArguments(args);
+    return builder.finish();
+}
+
+Expression polylineProcedure(const std::vector<Atom>& args)
+{
+    ShapeBuilder builder(PolylineType);
+    builder.addArguments(args);
+    return builder.finish();
+}
+
+Expression polygonProcedure(const std::vector<Atom>& args)
+{
+    ShapeBuilder builder(PolygonType);
+    builder.addArguments(args);
+    return builder.finish();
+}
 
-    // Return an expression of none type.
-    return Expression();
+//Reductions over all the numbers of their arguments, see number_vector.hpp
+Expression sumProcedure(const std::vector<Atom>& args)
+{
+    return reduce(Reduction::Sum, args);
 }
 
+Expression minProcedure(const std::vector<Atom>& args)
+{
+    return reduce(Reduction::Min, args);
+}
+
+Expression maxProcedure(const std::vector<Atom>& args)
+{
+    return reduce(Reduction::Max, args);
+}
+
+Expression meanProcedure(const std::vector<Atom>& args)
+{
+    return reduce(Reduction::Mean, args);
+}
+
+Expression dotProcedure(const std::vector<Atom>& args)
+{
+    return reduce(Reduction::Dot, args);
+}
 
 //Class constructor
 //Contains built in symbols and procedures
-Environment::Environment()
+Environment::Environment(): version(freshVersion())
 {
     //Built in symbols
     addSymbol("pi", Expression(atan2(0, -1)));
@@ -359,6 +835,36 @@ Environment::Environment()
     addProcedure("cos", cosProcedure);
     addProcedure("arctan", arctanProcedure);
 
+    // Procedures for lazy sequences, map and iterate are special forms
+    addProcedure("range", rangeProcedure);
+    addProcedure("take", takeProcedure);
+
+    // Procedures for packed numeric vectors
+    addProcedure("vector", vectorProcedure);
+    addProcedure("linspace", linspaceProcedure);
+    addProcedure("sum", sumProcedure);
+    addProcedure("min", minProcedure);
+    addProcedure("max", maxProcedure);
+    addProcedure("mean", meanProcedure);
+    addProcedure("dot", dotProcedure);
+
+    // Procedures for packed shapes
+    addProcedure("points", pointsProcedure);
+    addProcedure("polyline", polylineProcedure);
+    addProcedure("polygon", polygonProcedure);
+
+}
+
+// Copies take a fresh version: cached slots point into the source's map
+Environment::Environment(const Environment& other): envmap(other.envmap), version(freshVersion())
+{
+}
+
+Environment& Environment::operator=(const Environment& other)
+{
+    envmap = other.envmap;
+    version = freshVersion();
+    return *this;
 }
 
 //Adds a given symbol to the environment
@@ -368,6 +874,18 @@ void Environment::addSymbol(const Symbol& symbol, const Expression& value)
     result.type = ExpressionType;
     result.exp = value;
     envmap[symbol] = result;
+    version = freshVersion();
+}
+
+//Replaces the value of a symbol bound to an expression
+void Environment::setSymbol(const Symbol& symbol, const Expression& value)
+{
+    auto it = envmap.find(symbol);
+    if (it == envmap.end() || it->second.type != ExpressionType)
+    {
+        throw InterpreterSemanticError("Error: Symbol not found or not associated with an expression.");
+    }
+    it->second.exp = value;
 }
 
 //Adds a given procedure to the environment
@@ -377,6 +895,34 @@ void Environment::addProcedure(const Symbol& symbol, Procedure procedure)
     result.type = ProcedureType;
     result.proc = procedure;
     envmap[symbol] = result;
+    version = freshVersion();
+}
+
+//Returns the stored value slot for a symbol, or nullptr
+const Expression * Environment::lookupExpression(const Symbol& symbol) const
+{
+    auto it = envmap.find(symbol);
+    if (it != envmap.end() && it->second.type == ExpressionType)
+    {
+        return &it->second.exp;
+    }
+    return nullptr;
+}
+
+//Returns the procedure bound to a symbol, or nullptr
+Procedure Environment::lookupProcedure(const Symbol& symbol) const
+{
+    auto it = envmap.find(symbol);
+    if (it != envmap.end() && it->second.type == ProcedureType)
+    {
+        return it->second.proc;
+    }
+    return nullptr;
+}
+
+unsigned long Environment::getVersion() const
+{
+    return version;
 }
 
 //Gets the procedure / symbol based on the given symbol
@@ -408,33 +954,49 @@ bool Environment::isSymbolDefined(const Symbol& symbol)
 */
 Expression Environment::evaluateProcedure(const Symbol& symbol, const std::vector<Expression>& args)
 {
-    auto it = envmap.find(symbol);
-    if (it != envmap.end() && it->second.type == ProcedureType)
+    Procedure procedure = lookupProcedure(symbol);
+    if (procedure != nullptr)
     {
-        std::vector<Atom> atomArgs;
+        return applyProcedure(procedure, args);
+    }
+
+    throw InterpreterSemanticError("Error: Symbol not found or not associated with a procedure.");
+}
 
-        for (const auto& exp : args)
+//Converts evaluated arguments to atoms and calls an already resolved procedure
+Expression Environment::applyProcedure(Procedure procedure, const std::vector<Expression>& args)
+{
+    std::vector<Atom> atomArgs;
+    atomArgs.reserve(args.size());
+
+    for (const auto& exp : args)
+    {
+        atomArgs.push_back(exp.head); // Directly use the head of the Expression as the Atom
+    }
+
+    return applyProcedure(procedure, atomArgs);
+}
+
+//Checks the argument atoms, converting symbols in place, and calls an already resolved procedure
+Expression Environment::applyProcedure(Procedure procedure, std::vector<Atom>& args)
+{
+    for (auto& atom : args)
+    {
+        // Check if the Atom is of a type that needs to be converted to another Atom type
+        if (atom.type == SymbolType && !token_to_atom(atom.value.sym_value, atom))
         {
-            Atom atom = exp.head; // Directly use the head of the Expression as the Atom
-
-            // Check if the Atom is of a type that needs to be converted to another Atom type
-            if (atom.type == SymbolType && !token_to_atom(atom.value.sym_value, atom))
-            {
-                throw InterpreterSemanticError("Error: Failed to convert symbol to atom.");
-            }
-            
-            if (atom.type != NumberType && atom.type != BooleanType &&
-                atom.type != PointType && atom.type != LineType && atom.type != ArcType)
-            {
-                // If the atom type is not one of the expected types, throw an error
-                throw InterpreterSemanticError("Error: Unexpected expression type.");
-            }
-
-            atomArgs.push_back(atom);
+            throw InterpreterSemanticError("Error: Failed to convert symbol to atom.");
         }
 
-        return it->second.proc(atomArgs);
+        if (atom.type != NumberType && atom.type != BooleanType &&
+            atom.type != PointType && atom.type != LineType && atom.type != ArcType &&
+            atom.type != SequenceType && atom.type != VectorType && atom.type != MaskType &&
+            !isShape(atom.type))
+        {
+            // If the atom type is not one of the expected types, throw an error
+            throw InterpreterSemanticError("Error: Unexpected expression type.");
+        }
     }
 
-    throw InterpreterSemanticError("Error: Symbol not found or not associated with a procedure.");
+    return procedure(args);
 }
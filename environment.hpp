@@ -21,17 +21,75 @@ Expression greaterThanOrEqualProcedure(const std::vector<Atom>& args);
 Expression equalProcedure(const std::vector<Atom>& args);
 Expression log10Procedure(const std::vector<Atom>& args);
 Expression powProcedure(const std::vector<Atom>& args);
+Expression pointProcedure(const std::vector<Atom>& args);
+Expression lineProcedure(const std::vector<Atom>& args);
+Expression arcProcedure(const std::vector<Atom>& args);
+Expression sinProcedure(const std::vector<Atom>& args);
+Expression cosProcedure(const std::vector<Atom>& args);
+Expression arctanProcedure(const std::vector<Atom>& args);
+Expression drawProcedure(const std::vector<Atom>& args);
+Expression rangeProcedure(const std::vector<Atom>& args);
+Expression takeProcedure(const std::vector<Atom>& args);
+Expression vectorProcedure(const std::vector<Atom>& args);
+Expression linspaceProcedure(const std::vector<Atom>& args);
+Expression sumProcedure(const std::vector<Atom>& args);
+Expression minProcedure(const std::vector<Atom>& args);
+Expression maxProcedure(const std::vector<Atom>& args);
+Expression meanProcedure(const std::vector<Atom>& args);
+Expression dotProcedure(const std::vector<Atom>& args);
+Expression pointsProcedure(const std::vector<Atom>& args);
+Expression polylineProcedure(const std::vector<Atom>& args);
+Expression polygonProcedure(const std::vector<Atom>& args);
+
+// Unchecked variants, used where type inference proved the arguments
+Expression notUnchecked(const std::vector<Atom>& args);
+Expression andUnchecked(const std::vector<Atom>& args);
+Expression orUnchecked(const std::vector<Atom>& args);
+Expression ADDUnchecked(const std::vector<Atom>& args);
+Expression subtractUnchecked(const std::vector<Atom>& args);
+Expression multiplyUnchecked(const std::vector<Atom>& args);
+Expression divideUnchecked(const std::vector<Atom>& args);
+Expression lessThanUnchecked(const std::vector<Atom>& args);
+Expression lessThanOrEqualUnchecked(const std::vector<Atom>& args);
+Expression greaterThanUnchecked(const std::vector<Atom>& args);
+Expression greaterThanOrEqualUnchecked(const std::vector<Atom>& args);
+Expression equalUnchecked(const std::vector<Atom>& args);
+Expression log10Unchecked(const std::vector<Atom>& args);
+Expression powUnchecked(const std::vector<Atom>& args);
+Expression pointUnchecked(const std::vector<Atom>& args);
+Expression lineUnchecked(const std::vector<Atom>& args);
+Expression arcUnchecked(const std::vector<Atom>& args);
+Expression sinUnchecked(const std::vector<Atom>& args);
+Expression cosUnchecked(const std::vector<Atom>& args);
+Expression arctanUnchecked(const std::vector<Atom>& args);
 
 class Environment
 {
 public:
   Environment();
+  Environment(const Environment& other);
+  Environment& operator=(const Environment& other);
   void addSymbol(const Symbol& symbol, const Expression& value);
+
+  // Replaces the value of a bound symbol in place. Inline caches stay
+  // valid, so the version is kept.
+  void setSymbol(const Symbol& symbol, const Expression& value);
   void addProcedure(const Symbol& symbol, Procedure procedure);
   Expression get(const Symbol& symbol);
   bool isSymbolDefined(const Symbol& symbol);
   Expression evaluateProcedure(const Symbol& symbol, const std::vector<Expression>& args);
 
+  // Direct lookups used by the evaluator's inline caches.
+  // They return nullptr when the symbol is not bound to that kind of entry.
+  const Expression * lookupExpression(const Symbol& symbol) const;
+  Procedure lookupProcedure(const Symbol& symbol) const;
+  Expression applyProcedure(Procedure procedure, const std::vector<Expression>& args);
+  Expression applyProcedure(Procedure procedure, std::vector<Atom>& args);
+
+  // Changes whenever a binding is added or replaced, or the environment
+  // is copied; never repeats across Environment instances.
+  unsigned long getVersion() const;
+
 
 private:
 
@@ -45,6 +103,7 @@ private:
 
 
   std::map<Symbol,EnvResult> envmap;
+  unsigned long version;
 };
 
 #endif
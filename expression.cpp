@@ -8,6 +8,194 @@
 #include <cctype>
 #include <tuple>
 #include <iostream>
+#include <functional>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+
+// module includes
+#include "number_vector.hpp"
+#include "point_buffer.hpp"
+
+Tail::Tail(const std::vector<Expression> & items)
+{
+	if (!items.empty())
+	{
+		data = std::make_shared<Storage>();
+		data->items = items;
+	}
+}
+
+const std::vector<Expression> & Tail::none()
+{
+	static const std::vector<Expression> empty;
+	return empty;
+}
+
+// Gives this Tail its own copy of a shared storage before a write
+// and drops the cached hash, which the write may invalidate.
+void Tail::detach()
+{
+	if (!data)
+	{
+		data = std::make_shared<Storage>();
+	}
+	else if (data.use_count() > 1)
+	{
+		std::shared_ptr<Storage> copy = std::make_shared<Storage>();
+		copy->items = data->items;
+		data = copy;
+	}
+	data->hashed = false;
+}
+
+Expression & Tail::operator[](std::size_t i)
+{
+	detach();
+	return data->items[i];
+}
+
+Tail::iterator Tail::begin()
+{
+	detach();
+	return data->items.begin();
+}
+
+Tail::iterator Tail::end()
+{
+	detach();
+	return data->items.end();
+}
+
+void Tail::push_back(const Expression & exp)
+{
+	detach();
+	data->items.push_back(exp);
+}
+
+void Tail::reserve(std::size_t n)
+{
+	detach();
+	data->items.reserve(n);
+}
+
+static std::size_t combineHash(std::size_t seed, std::size_t value)
+{
+	return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+static std::size_t hashPoint(std::size_t seed, const Point & p)
+{
+	std::hash<double> hashDouble;
+	return combineHash(combineHash(seed, hashDouble(p.x)), hashDouble(p.y));
+}
+
+static std::size_t hashAtom(const Atom & atom)
+{
+	std::size_t seed = std::hash<int>()(atom.type);
+	switch (atom.type)
+	{
+	case BooleanType:
+		return combineHash(seed, atom.value.bool_value);
+	case NumberType:
+		return combineHash(seed, std::hash<double>()(atom.value.num_value));
+	case SymbolType:
+		return combineHash(seed, std::hash<std::string>()(atom.value.sym_value));
+	case PointType:
+		return hashPoint(seed, atom.value.point_value);
+	case LineType:
+		return hashPoint(hashPoint(seed, atom.value.line_value.first), atom.value.line_value.second);
+	case ArcType:
+		seed = hashPoint(hashPoint(seed, atom.value.arc_value.center), atom.value.arc_value.start);
+		return combineHash(seed, std::hash<double>()(atom.value.arc_value.span));
+	case VectorType:
+		{
+			// the length and ends only, sameAtom compares the rest
+			const std::vector<Number> & values = atom.value.vector()->values;
+			seed = combineHash(seed, values.size());
+			return values.empty() ? seed : combineHash(combineHash(seed, std::hash<double>()(values.front())), std::hash<double>()(values.back()));
+		}
+	case PointsType:
+	case PolylineType:
+	case PolygonType:
+		{
+			// the vertex count and first vertex only, sameAtom compares the rest
+			const PointBuffer & points = *atom.value.shape();
+			seed = combineHash(seed, points.size());
+			return points.size() == 0 ? seed : hashPoint(seed, Point{points.xs.front(), points.ys.front()});
+		}
+	default:
+		return seed;
+	}
+}
+
+std::size_t Tail::hash() const
+{
+	if (!data)
+	{
+		return 0;
+	}
+	if (!data->hashed)
+	{
+		std::size_t seed = data->items.size();
+		for (const Expression & exp : data->items)
+		{
+			seed = combineHash(seed, exp.hash());
+		}
+		data->hash = seed;
+		data->hashed = true;
+	}
+	return data->hash;
+}
+
+std::size_t Expression::hash() const
+{
+	return combineHash(hashAtom(head), tail.hash());
+}
+
+bool sameAtom(const Atom & a, const Atom & b)
+{
+	if (a.type != b.type)
+	{
+		return false;
+	}
+	switch (a.type)
+	{
+	case BooleanType:
+		return a.value.bool_value == b.value.bool_value;
+	case NumberType:
+		if (a.value.is_integer || b.value.is_integer)
+		{
+			return a.value.is_integer == b.value.is_integer && a.value.int_value == b.value.int_value;
+		}
+		return a.value.num_value == b.value.num_value;
+	case SymbolType:
+		return a.value.sym_value == b.value.sym_value;
+	case PointType:
+		return a.value.point_value.x == b.value.point_value.x && a.value.point_value.y == b.value.point_value.y;
+	case LineType:
+		return a.value.line_value.first.x == b.value.line_value.first.x && a.value.line_value.first.y == b.value.line_value.first.y &&
+			a.value.line_value.second.x == b.value.line_value.second.x && a.value.line_value.second.y == b.value.line_value.second.y;
+	case ArcType:
+		return a.value.arc_value.center.x == b.value.arc_value.center.x && a.value.arc_value.center.y == b.value.arc_value.center.y &&
+			a.value.arc_value.start.x == b.value.arc_value.start.x && a.value.arc_value.start.y == b.value.arc_value.start.y &&
+			a.value.arc_value.span == b.value.arc_value.span;
+	case LambdaType:
+		return a.value.closure() == b.value.closure();
+	case SequenceType:
+		return a.value.sequence() == b.value.sequence();
+	case VectorType:
+		return a.value.vector()->values == b.value.vector()->values;
+	case MaskType:
+		return a.value.mask()->values == b.value.mask()->values;
+	case PointsType:
+	case PolylineType:
+	case PolygonType:
+		return a.value.shape()->xs == b.value.shape()->xs && a.value.shape()->ys == b.value.shape()->ys;
+	default:
+		return true;
+	}
+}
 
 Expression::Expression(bool tf)
 {
@@ -21,6 +209,14 @@ Expression::Expression(double num)
 	head.value.num_value = num;
 }
 
+Expression::Expression(Integer num)
+{
+	head.type = NumberType;
+	head.value.num_value = static_cast<Number>(num);
+	head.value.int_value = num;
+	head.value.is_integer = true;
+}
+
 Expression::Expression(const std::string & sym)
 {
 	head.type = SymbolType;
@@ -73,7 +269,11 @@ bool Expression::operator==(const Expression & exp) const noexcept
 	case BooleanType:
 		return head.value.bool_value == exp.head.value.bool_value;
 	case NumberType:
-		// Compare floating-point numbers with tolerance
+		// Integers are exact, other numbers compared with tolerance
+		if (head.value.is_integer && exp.head.value.is_integer)
+		{
+			return head.value.int_value == exp.head.value.int_value;
+		}
 		return std::abs(head.value.num_value - exp.head.value.num_value) <= std::numeric_limits<double>::epsilon();
 	case SymbolType:
 		return head.value.sym_value == exp.head.value.sym_value;
@@ -86,6 +286,38 @@ bool Expression::operator==(const Expression & exp) const noexcept
 		return (head.value.arc_value.center == exp.head.value.arc_value.center) &&
 			(head.value.arc_value.start == exp.head.value.arc_value.start) &&
 			(fabs(head.value.arc_value.span - exp.head.value.arc_value.span) < std::numeric_limits<double>::epsilon());
+	case LambdaType:
+		return head.value.closure() == exp.head.value.closure();
+	case SequenceType:
+		return head.value.sequence() == exp.head.value.sequence();
+	case VectorType:
+		// elements compared with the tolerance of numbers
+		return head.value.vector()->values.size() == exp.head.value.vector()->values.size() &&
+			std::equal(head.value.vector()->values.begin(), head.value.vector()->values.end(),
+				exp.head.value.vector()->values.begin(),
+				[](Number a, Number b) { return std::abs(a - b) <= std::numeric_limits<double>::epsilon(); });
+	case MaskType:
+		return head.value.mask()->values == exp.head.value.mask()->values;
+	case PointsType:
+	case PolylineType:
+	case PolygonType:
+		{
+			// vertices compared with the tolerance of points
+			const PointBuffer & a = *head.value.shape();
+			const PointBuffer & b = *exp.head.value.shape();
+			if (a.size() != b.size())
+			{
+				return false;
+			}
+			for (std::size_t i = 0; i < a.size(); ++i)
+			{
+				if (Point{a.xs[i], a.ys[i]} != Point{b.xs[i], b.ys[i]})
+				{
+					return false;
+				}
+			}
+			return true;
+		}
 	default:
 		std::cerr << "ERROR: Invalid type " << std::endl;
 		return false; // Invalid type
@@ -101,6 +333,10 @@ std::ostream & operator<<(std::ostream & out, const Expression & exp)
 		{
 			out << (exp.head.value.bool_value ? "True" : "False");
 		}
+		else if (exp.head.type == NumberType && exp.head.value.is_integer)
+		{
+			out << exp.head.value.int_value;
+		}
 		else if (exp.head.type == NumberType)
 		{
 			out << exp.head.value.num_value;
@@ -121,6 +357,49 @@ std::ostream & operator<<(std::ostream & out, const Expression & exp)
 		{
 			out << "((" << exp.head.value.arc_value.center.x << "," << exp.head.value.arc_value.center.y << ")," << "(" << exp.head.value.arc_value.start.x << "," << exp.head.value.arc_value.start.y << ")," << exp.head.value.arc_value.span << ")";
 		}
+		else if (exp.head.type == LambdaType)
+		{
+			out << "<lambda>";
+		}
+		else if (exp.head.type == SequenceType)
+		{
+			out << "<sequence>";
+		}
+		else if (exp.head.type == VectorType)
+		{
+			out << "#(";
+			const std::vector<Number> & values = exp.head.value.vector()->values;
+			for (std::size_t i = 0; i < values.size(); ++i)
+			{
+				out << (i == 0 ? "" : " ") << values[i];
+			}
+			out << ")";
+		}
+		else if (exp.head.type == MaskType)
+		{
+			out << "#(";
+			const std::vector<unsigned char> & values = exp.head.value.mask()->values;
+			for (std::size_t i = 0; i < values.size(); ++i)
+			{
+				out << (i == 0 ? "" : " ") << (values[i] ? "True" : "False");
+			}
+			out << ")";
+		}
+		else if (isShape(exp.head.type))
+		{
+			// shapes may have millions of vertices, so only their count is printed
+			const char * name = exp.head.type == PointsType ? "points" : exp.head.type == PolylineType ? "polyline" : "polygon";
+			out << "<" << name << " of " << exp.head.value.shape()->size() << " points>";
+		}
+	}
+	else if (exp.head.type == ListType)
+	{
+		out << "(";
+		for (std::size_t i = 0; i < exp.tail.size(); ++i)
+		{
+			out << (i == 0 ? "" : " ") << exp.tail[i];
+		}
+		out << ")";
 	}
 	else
 	{
@@ -171,6 +450,17 @@ bool token_to_atom(const std::string & token, Atom & atom)
 
 			atom.type = NumberType;
 			atom.value.num_value = num;
+
+			// integer literals, digits with an optional sign, are integers if they fit
+			std::size_t digits = token[0] == '-' || token[0] == '+' ? 1 : 0;
+			atom.value.is_integer = digits < token.size() &&
+				std::all_of(token.begin() + digits, token.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; });
+			if (atom.value.is_integer)
+			{
+				errno = 0;
+				atom.value.int_value = std::strtoll(token.c_str(), nullptr, 10);
+				atom.value.is_integer = errno != ERANGE;
+			}
 		}
 		catch (const std::invalid_argument&)
 		{
@@ -195,3 +485,55 @@ bool token_to_atom(const std::string & token, Atom & atom)
 	return true; // Valid token
 }
 
+bool addIntegers(Integer a, Integer b, Integer & result)
+{
+#if defined(__GNUC__)
+	return !__builtin_add_overflow(a, b, &result);
+#else
+	if ((b > 0 && a > std::numeric_limits<Integer>::max() - b) || (b < 0 && a < std::numeric_limits<Integer>::min() - b))
+	{
+		return false;
+	}
+	result = a + b;
+	return true;
+#endif
+}
+
+bool subtractIntegers(Integer a, Integer b, Integer & result)
+{
+#if defined(__GNUC__)
+	return !__builtin_sub_overflow(a, b, &result);
+#else
+	if ((b < 0 && a > std::numeric_limits<Integer>::max() + b) || (b > 0 && a < std::numeric_limits<Integer>::min() + b))
+	{
+		return false;
+	}
+	result = a - b;
+	return true;
+#endif
+}
+
+bool multiplyIntegers(Integer a, Integer b, Integer & result)
+{
+#if defined(__GNUC__)
+	return !__builtin_mul_overflow(a, b, &result);
+#else
+	if (a != 0 && b != 0)
+	{
+		const Integer min = std::numeric_limits<Integer>::min();
+		if ((a == -1 && b == min) || (b == -1 && a == min))
+		{
+			return false;
+		}
+		// the product modulo 2^64, correct if dividing it back gives a
+		Integer product = static_cast<Integer>(static_cast<std::uint64_t>(a) * static_cast<std::uint64_t>(b));
+		if (product / b != a)
+		{
+			return false;
+		}
+	}
+	result = a * b;
+	return true;
+#endif
+}
+
@@ -7,10 +7,14 @@
 #include <tuple>
 #include <cmath>
 #include <limits>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
 
 // A Type is a literal boolean, literal number, or symbol
 enum Type {NoneType, BooleanType, NumberType, ListType, SymbolType,
-	   PointType, LineType, ArcType};
+	   PointType, LineType, ArcType, LambdaType, SequenceType,
+	   VectorType, MaskType, PointsType, PolylineType, PolygonType};
 
 // A Boolean is a C++ bool
 typedef bool Boolean;
@@ -18,6 +22,9 @@ typedef bool Boolean;
 // A Number is a C++ double
 typedef double Number;
 
+// An Integer is a whole Number kept exactly in 64 bits (see Value)
+typedef std::int64_t Integer;
+
 // A Symbol is a string
 typedef std::string Symbol;
 
@@ -46,17 +53,51 @@ struct Arc{
   Point start;
   Number span;
 };
+
+// A Closure is a lambda with its captured variables (see closure.hpp)
+struct Closure;
+struct LambdaInfo;
+
+// A Sequence generates its elements lazily (see sequence.hpp)
+struct Sequence;
+
+// Packed numbers and booleans (see number_vector.hpp)
+struct NumberVector;
+struct BooleanMask;
+
+// Packed vertices of point arrays, polylines and polygons (see point_buffer.hpp)
+struct PointBuffer;
   
-// A Value is a boolean, number, or symbol
-// cannot use a union because symbol is non-POD
-// this wastes space but is simple 
+// A Value holds the payload of an Atom in the member its type selects.
+// The symbol and the handle of the heap object have constructors, so they
+// are members of their own; the exact integer shares a union with the plain graphic
+// structs, since no atom is both a number and a graphic.
 struct Value {
   Boolean bool_value;
+  // Set on numbers that are integers: int_value holds the exact value and
+  // num_value the nearest double. Integer literals are integers, and + - *
+  // of integers give integers while the result fits in 64 bits.
+  bool is_integer = false;
   Number num_value;
   Symbol sym_value;
-  Point point_value;
-  Line line_value;
-  Arc arc_value;
+  union {
+    Integer int_value = 0;
+    Point point_value;
+    Line line_value;
+    Arc arc_value;
+  };
+  // The closure, sequence, vector, mask or shape, as the type of the
+  // Atom tells. One handle holds all of them, read through the accessors.
+  std::shared_ptr<const void> object;
+
+  const Closure * closure() const { return static_cast<const Closure *>(object.get()); }
+  const Sequence * sequence() const { return static_cast<const Sequence *>(object.get()); }
+  const NumberVector * vector() const { return static_cast<const NumberVector *>(object.get()); }
+  const BooleanMask * mask() const { return static_cast<const BooleanMask *>(object.get()); }
+  const PointBuffer * shape() const { return static_cast<const PointBuffer *>(object.get()); }
+
+  // shares ownership of the object, which must be a T
+  template<typename T> std::shared_ptr<const T> shared() const { return std::static_pointer_cast<const T>(object); }
 };
   
 // An Atom has a type and value
@@ -65,12 +106,117 @@ struct Atom{
   Value value;
 };
 
+struct Expression;
+struct Signature;
+
+// A Procedure is a C++ function pointer taking
+// a vector of Atoms as arguments
+typedef Expression (*Procedure)(const std::vector<Atom> & args);
+
+// The tail of an Expression: a list of expressions.
+// Structurally identical tails may share one storage (see hash_consing.hpp).
+// Writing through a shared Tail copies the storage first,
+// so the sharing is never observable.
+class Tail{
+public:
+  typedef std::vector<Expression>::const_iterator const_iterator;
+  typedef std::vector<Expression>::iterator iterator;
+
+  Tail() = default;
+  Tail(const std::vector<Expression> & items);
+
+  bool empty() const;
+  std::size_t size() const;
+  const Expression & operator[](std::size_t i) const;
+  const Expression & back() const;
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  // mutating access, unshares the storage
+  Expression & operator[](std::size_t i);
+  iterator begin();
+  iterator end();
+  void push_back(const Expression & exp);
+  void reserve(std::size_t n);
+
+  // Structural hash of the elements, cached in the storage
+  std::size_t hash() const;
+
+  // Address of the storage, equal for all Tails sharing it
+  const void * storage() const;
+
+private:
+  struct Storage;
+  static const std::vector<Expression> & none();
+  void detach();
+
+  std::shared_ptr<Storage> data;
+};
+
+// The binding a call site or variable reference last resolved to: a
+// procedure for call sites, a stored value slot for variable references.
+// Only valid while version matches the Environment's version.
+struct InlineCache{
+  unsigned long version = 0;
+  Procedure proc = nullptr;
+  const Expression * value = nullptr;
+};
+
+// Owns the InlineCache of a node, allocated when the node is first
+// resolved, so literals and other nodes never resolved pay one pointer.
+// A copy starts empty and resolves again when it is evaluated.
+class InlineCacheSlot{
+public:
+  InlineCacheSlot() = default;
+  InlineCacheSlot(const InlineCacheSlot &) {}
+  InlineCacheSlot(InlineCacheSlot &&) = default;
+  InlineCacheSlot & operator=(const InlineCacheSlot &)
+  {
+    cache.reset();
+    return *this;
+  }
+  InlineCacheSlot & operator=(InlineCacheSlot &&) = default;
+
+  InlineCache & get() const
+  {
+    if (!cache)
+    {
+      cache.reset(new InlineCache);
+    }
+    return *cache;
+  }
+
+private:
+  mutable std::unique_ptr<InlineCache> cache;
+};
+
 // An expression is an atom called the head
 // followed by a (possibly empty) list of expressions
 // called the tail
 struct Expression{
   Atom head;
-  std::vector<Expression> tail;
+  Tail tail;
+
+  // Inline cache of the binding this node last resolved to, allocated
+  // only on the call sites and variable references that get resolved
+  InlineCacheSlot cache;
+
+  // Set by type inference on call sites whose arguments are proven to
+  // match this builtin signature (see type_inference.hpp)
+  mutable const Signature * signature = nullptr;
+
+  // Set by common subexpression elimination on repeated pure subexpressions,
+  // the slot of the interpreter's memo holding its value (-1 if none)
+  mutable int cseSlot = -1;
+
+  // Set by scope resolution on references to variables bound by lambda or
+  // let (see closure.hpp): the slot in the current frame, or the index in
+  // the current closure's captured values (-1 for globals)
+  int frameSlot = -1;
+  int captureSlot = -1;
+
+  // Set by scope resolution on lambda expressions
+  std::shared_ptr<const LambdaInfo> lambda;
 
   Expression() 
   {
@@ -87,6 +233,7 @@ struct Expression{
   Expression(const Atom & atom): head(atom){};
   Expression(bool tf);
   Expression(double num);
+  Expression(Integer num);
   Expression(const std::string & sym);
 
   // Construct an Expression with a single Point atom with value
@@ -104,12 +251,54 @@ struct Expression{
 	     double angle);
   
   bool operator==(const Expression & exp) const noexcept;
+
+  // Structural hash of the whole subtree
+  std::size_t hash() const;
 };
 
+struct Tail::Storage{
+  std::vector<Expression> items;
+  mutable std::size_t hash = 0;
+  mutable bool hashed = false;
+};
 
-// A Procedure is a C++ function pointer taking
-// a vector of Atoms as arguments
-typedef Expression (*Procedure)(const std::vector<Atom> & args);
+inline bool Tail::empty() const
+{
+  return !data || data->items.empty();
+}
+
+inline std::size_t Tail::size() const
+{
+  return data ? data->items.size() : 0;
+}
+
+inline const Expression & Tail::operator[](std::size_t i) const
+{
+  return data->items[i];
+}
+
+inline const Expression & Tail::back() const
+{
+  return data->items.back();
+}
+
+inline Tail::const_iterator Tail::begin() const
+{
+  return data ? data->items.cbegin() : none().cbegin();
+}
+
+inline Tail::const_iterator Tail::end() const
+{
+  return data ? data->items.cend() : none().cend();
+}
+
+inline const void * Tail::storage() const
+{
+  return data.get();
+}
+
+// true if two atoms are identical, numbers compared exactly
+bool sameAtom(const Atom & a, const Atom & b);
 
 // format an expression for output
 std::ostream & operator<<(std::ostream & out, const Expression & exp);
@@ -117,4 +306,9 @@ std::ostream & operator<<(std::ostream & out, const Expression & exp);
 // map a token to an Atom
 bool token_to_atom(const std::string & token, Atom & atom);
 
+// Integer arithmetic, false if the result does not fit in an Integer
+bool addIntegers(Integer a, Integer b, Integer & result);
+bool subtractIntegers(Integer a, Integer b, Integer & result);
+bool multiplyIntegers(Integer a, Integer b, Integer & result);
+
 #endif
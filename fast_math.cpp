@@ -0,0 +1,478 @@
+#include "fast_math.hpp"
+
+// system includes
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+// module includes
+#include "number_vector.hpp"
+#include "simd.hpp"
+
+// sin and cos reduce x to r = x - k pi/2 with |r| <= pi/4 and take sin(r) or
+// cos(r) by the quadrant k mod 4. pi/2 is split in three parts of 33 bits and
+// a tail, so k times each part is exact for k < 2^20, and r is kept as the sum
+// of two doubles, r and a tail below its last bit.
+static const Number reductionLimit = 524288; // 2^19
+static const Number twoOverPi = 6.36619772367581382433e-01;
+static const Number piOver2Part1 = 1.57079632673412561417e+00;
+static const Number piOver2Part2 = 6.07710050630396597660e-11;
+static const Number piOver2Part3 = 2.02226624871116645580e-21;
+static const Number piOver2Tail = 8.47842766036889956997e-32;
+
+// sin(x) rounds to x below 2^-27, which keeps the sign of zero
+static const Number sinTiny = 7.450580596923828125e-09;
+
+// Adding 1.5 * 2^52 rounds to an integer, left in the low bits of the sum
+static const Number roundingShift = 6755399441055744.0;
+
+// Polynomials of sin and cos on [-pi/4, pi/4], from fdlibm
+static const Number S1 = -1.66666666666666324348e-01;
+static const Number S2 = 8.33333333332248946124e-03;
+static const Number S3 = -1.98412698298579493134e-04;
+static const Number S4 = 2.75573137070700676789e-06;
+static const Number S5 = -2.50507602534068634195e-08;
+static const Number S6 = 1.58969099521155010221e-10;
+static const Number C1 = 4.16666666666666019037e-02;
+static const Number C2 = -1.38888888888741095749e-03;
+static const Number C3 = 2.48015872894767294178e-05;
+static const Number C4 = -2.75573143513906633035e-07;
+static const Number C5 = 2.08757232129817482790e-09;
+static const Number C6 = -1.13596475577881948265e-11;
+
+// atan2(y, x) takes atan of a = min(|x|, |y|) / max(|x|, |y|) in [0, 1], by
+// a rational function on [0, 0.66] and as pi/4 + atan((a - 1) / (a + 1))
+// above, from Cephes. The octant then gives the angle from pi/2 and pi,
+// which are split in two doubles.
+static const Number atanSplit = 0.66;
+static const Number P0 = -8.750608600031904122785e-01;
+static const Number P1 = -1.615753718733365076637e+01;
+static const Number P2 = -7.500855792314704667340e+01;
+static const Number P3 = -1.228866684490136173410e+02;
+static const Number P4 = -6.485021904942025371773e+01;
+static const Number Q0 = 2.485846490142306297962e+01;
+static const Number Q1 = 1.650270098316988542046e+02;
+static const Number Q2 = 4.328810604912902668951e+02;
+static const Number Q3 = 4.853903996359136964868e+02;
+static const Number Q4 = 1.945506571482613964425e+02;
+static const Number piOver4 = 7.85398163397448278999e-01;
+static const Number piOver2 = 1.57079632679489655800e+00;
+static const Number piOver2Low = 6.12323399573676588613e-17;
+static const Number pi = 3.14159265358979311600e+00;
+static const Number piLow = 1.22464679914735317723e-16;
+
+// The largest finite number, atan2 of anything larger or NaN uses libm
+static const Number finiteLimit = std::numeric_limits<Number>::max();
+
+// sum + error = a + b exactly
+static void twoSum(Number a, Number b, Number & sum, Number & error)
+{
+  sum = a + b;
+  Number bb = sum - a;
+  error = (a - (sum - bb)) + (b - bb);
+}
+
+static void reduce(Number x, Number k, Number & r, Number & tail)
+{
+  Number s, e, s2, e2;
+  twoSum(x - k * piOver2Part1, -(k * piOver2Part2), s, e);
+  twoSum(s, -(k * piOver2Part3), s2, e2);
+  Number low = (e + e2) - k * piOver2Tail;
+  r = s2 + low;
+  tail = (s2 - r) + low;
+}
+
+static Number sinKernel(Number x, Number tail)
+{
+  Number z = x * x;
+  Number v = z * x;
+  Number r = S2 + z * (S3 + z * (S4 + z * (S5 + z * S6)));
+  return x - ((z * (0.5 * tail - v * r) - tail) - v * S1);
+}
+
+static Number cosKernel(Number x, Number tail)
+{
+  Number z = x * x;
+  Number r = z * (C1 + z * (C2 + z * (C3 + z * (C4 + z * (C5 + z * C6)))));
+  return 1.0 - (0.5 * z - (z * r - x * tail));
+}
+
+// Quadrants 0 to 3 give sin(r), cos(r), -sin(r) and -cos(r).
+// cos(x) is sin(x + pi/2), one quadrant further.
+static Number sinQuadrant(Number x, long long offset)
+{
+  Number shifted = x * twoOverPi + roundingShift;
+  Number k = shifted - roundingShift;
+  long long quadrant = static_cast<long long>(k) + offset;
+  Number r, tail;
+  reduce(x, k, r, tail);
+  Number value = (quadrant & 1) ? cosKernel(r, tail) : sinKernel(r, tail);
+  return (quadrant & 2) ? -value : value;
+}
+
+Number fastSin(Number x)
+{
+  if (!(std::fabs(x) <= reductionLimit))
+  {
+    return std::sin(x);
+  }
+  if (std::fabs(x) < sinTiny)
+  {
+    return x;
+  }
+  return sinQuadrant(x, 0);
+}
+
+Number fastCos(Number x)
+{
+  if (!(std::fabs(x) <= reductionLimit))
+  {
+    return std::cos(x);
+  }
+  return sinQuadrant(x, 1);
+}
+
+Number fastAtan2(Number y, Number x)
+{
+  Number ax = std::fabs(x);
+  Number ay = std::fabs(y);
+  if (!(ax <= finiteLimit && ay <= finiteLimit))
+  {
+    return std::atan2(y, x);
+  }
+  bool swap = ay > ax;
+  Number num = swap ? ax : ay;
+  Number den = swap ? ay : ax;
+  Number a = den > 0 ? num / den : 0;
+  bool big = a > atanSplit;
+  Number t = big ? (a - 1) / (a + 1) : a;
+  Number z = t * t;
+  Number p = (((P0 * z + P1) * z + P2) * z + P3) * z + P4;
+  Number q = ((((z + Q0) * z + Q1) * z + Q2) * z + Q3) * z + Q4;
+  Number atan = t * (z * p / q) + t;
+
+  // the angle is high + low
+  Number base = big ? piOver4 : 0;
+  Number more = big ? 0.5 * piOver2Low : 0;
+  Number high = swap ? piOver2 - base : base;
+  Number low = swap ? (piOver2Low - more) - atan : more + atan;
+  if (std::signbit(x))
+  {
+    high = pi - high;
+    low = piLow - low;
+  }
+  return std::copysign(high + low, y);
+}
+
+#ifdef SLISP_X86_SIMD
+// The SIMD forms below compute the same operations as the scalar ones lane
+// by lane. A block with a lane the scalar form would pass to libm is
+// computed by the scalar form instead.
+
+static void twoSum(__m128d a, __m128d b, __m128d & sum, __m128d & error)
+{
+  sum = _mm_add_pd(a, b);
+  __m128d bb = _mm_sub_pd(sum, a);
+  error = _mm_add_pd(_mm_sub_pd(a, _mm_sub_pd(sum, bb)), _mm_sub_pd(b, bb));
+}
+
+TARGET_AVX2 static void twoSum(__m256d a, __m256d b, __m256d & sum, __m256d & error)
+{
+  sum = _mm256_add_pd(a, b);
+  __m256d bb = _mm256_sub_pd(sum, a);
+  error = _mm256_add_pd(_mm256_sub_pd(a, _mm256_sub_pd(sum, bb)), _mm256_sub_pd(b, bb));
+}
+
+// mask ? a : b, for masks of all-ones or all-zeros lanes
+static __m128d select(__m128d mask, __m128d a, __m128d b)
+{
+  return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+}
+
+// All-ones lanes where the sign bit is set. SSE2 has no 64-bit arithmetic
+// shift, so the high halves are shifted and copied to the low ones.
+static __m128d signMask(__m128i bits)
+{
+  return _mm_castsi128_pd(_mm_shuffle_epi32(_mm_srai_epi32(bits, 31), _MM_SHUFFLE(3, 3, 1, 1)));
+}
+
+template <long long Offset>
+static void sinCosSSE2(const Number * in, Number * out, std::size_t n)
+{
+  const __m128d sign = _mm_set1_pd(-0.0);
+  std::size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+  {
+    __m128d x = _mm_loadu_pd(in + i);
+    if (_mm_movemask_pd(_mm_cmple_pd(_mm_andnot_pd(sign, x), _mm_set1_pd(reductionLimit))) != 3)
+    {
+      out[i] = Offset ? fastCos(in[i]) : fastSin(in[i]);
+      out[i + 1] = Offset ? fastCos(in[i + 1]) : fastSin(in[i + 1]);
+      continue;
+    }
+    __m128d shifted = _mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(twoOverPi)), _mm_set1_pd(roundingShift));
+    __m128d k = _mm_sub_pd(shifted, _mm_set1_pd(roundingShift));
+
+    __m128d s, e, s2, e2;
+    twoSum(_mm_sub_pd(x, _mm_mul_pd(k, _mm_set1_pd(piOver2Part1))),
+           _mm_xor_pd(_mm_mul_pd(k, _mm_set1_pd(piOver2Part2)), sign), s, e);
+    twoSum(s, _mm_xor_pd(_mm_mul_pd(k, _mm_set1_pd(piOver2Part3)), sign), s2, e2);
+    __m128d low = _mm_sub_pd(_mm_add_pd(e, e2), _mm_mul_pd(k, _mm_set1_pd(piOver2Tail)));
+    __m128d r = _mm_add_pd(s2, low);
+    __m128d tail = _mm_add_pd(_mm_sub_pd(s2, r), low);
+
+    __m128d z = _mm_mul_pd(r, r);
+    __m128d v = _mm_mul_pd(z, r);
+    __m128d sp = _mm_add_pd(_mm_mul_pd(z, _mm_set1_pd(S6)), _mm_set1_pd(S5));
+    sp = _mm_add_pd(_mm_mul_pd(z, sp), _mm_set1_pd(S4));
+    sp = _mm_add_pd(_mm_mul_pd(z, sp), _mm_set1_pd(S3));
+    sp = _mm_add_pd(_mm_mul_pd(z, sp), _mm_set1_pd(S2));
+    __m128d half = _mm_set1_pd(0.5);
+    __m128d sinValue = _mm_sub_pd(r, _mm_sub_pd(_mm_sub_pd(_mm_mul_pd(z, _mm_sub_pd(_mm_mul_pd(half, tail), _mm_mul_pd(v, sp))), tail),
+                                                _mm_mul_pd(v, _mm_set1_pd(S1))));
+    __m128d cp = _mm_add_pd(_mm_mul_pd(z, _mm_set1_pd(C6)), _mm_set1_pd(C5));
+    cp = _mm_add_pd(_mm_mul_pd(z, cp), _mm_set1_pd(C4));
+    cp = _mm_add_pd(_mm_mul_pd(z, cp), _mm_set1_pd(C3));
+    cp = _mm_add_pd(_mm_mul_pd(z, cp), _mm_set1_pd(C2));
+    cp = _mm_mul_pd(z, _mm_add_pd(_mm_mul_pd(z, cp), _mm_set1_pd(C1)));
+    __m128d cosValue = _mm_sub_pd(_mm_set1_pd(1.0), _mm_sub_pd(_mm_mul_pd(half, z), _mm_sub_pd(_mm_mul_pd(z, cp), _mm_mul_pd(r, tail))));
+
+    // the quadrant is in the low bits of shifted
+    __m128i quadrant = _mm_add_epi64(_mm_castpd_si128(shifted), _mm_set1_epi64x(Offset));
+    __m128d value = select(signMask(_mm_slli_epi64(quadrant, 63)), cosValue, sinValue);
+    value = _mm_xor_pd(value, _mm_and_pd(_mm_castsi128_pd(_mm_slli_epi64(quadrant, 62)), sign));
+    if (Offset == 0)
+    {
+      value = select(_mm_cmplt_pd(_mm_andnot_pd(sign, x), _mm_set1_pd(sinTiny)), x, value);
+    }
+    _mm_storeu_pd(out + i, value);
+  }
+  for (; i < n; ++i)
+  {
+    out[i] = Offset ? fastCos(in[i]) : fastSin(in[i]);
+  }
+}
+template <long long Offset>
+TARGET_AVX2 static void sinCosAVX2(const Number * in, Number * out, std::size_t n)
+{
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256d x = _mm256_loadu_pd(in + i);
+    if (_mm256_movemask_pd(_mm256_cmp_pd(_mm256_andnot_pd(sign, x), _mm256_set1_pd(reductionLimit), _CMP_LE_OQ)) != 15)
+    {
+      for (std::size_t j = i; j < i + 4; ++j)
+      {
+        out[j] = Offset ? fastCos(in[j]) : fastSin(in[j]);
+      }
+      continue;
+    }
+    __m256d shifted = _mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(twoOverPi)), _mm256_set1_pd(roundingShift));
+    __m256d k = _mm256_sub_pd(shifted, _mm256_set1_pd(roundingShift));
+
+    __m256d s, e, s2, e2;
+    twoSum(_mm256_sub_pd(x, _mm256_mul_pd(k, _mm256_set1_pd(piOver2Part1))),
+           _mm256_xor_pd(_mm256_mul_pd(k, _mm256_set1_pd(piOver2Part2)), sign), s, e);
+    twoSum(s, _mm256_xor_pd(_mm256_mul_pd(k, _mm256_set1_pd(piOver2Part3)), sign), s2, e2);
+    __m256d low = _mm256_sub_pd(_mm256_add_pd(e, e2), _mm256_mul_pd(k, _mm256_set1_pd(piOver2Tail)));
+    __m256d r = _mm256_add_pd(s2, low);
+    __m256d tail = _mm256_add_pd(_mm256_sub_pd(s2, r), low);
+
+    __m256d z = _mm256_mul_pd(r, r);
+    __m256d v = _mm256_mul_pd(z, r);
+    __m256d sp = _mm256_add_pd(_mm256_mul_pd(z, _mm256_set1_pd(S6)), _mm256_set1_pd(S5));
+    sp = _mm256_add_pd(_mm256_mul_pd(z, sp), _mm256_set1_pd(S4));
+    sp = _mm256_add_pd(_mm256_mul_pd(z, sp), _mm256_set1_pd(S3));
+    sp = _mm256_add_pd(_mm256_mul_pd(z, sp), _mm256_set1_pd(S2));
+    __m256d half = _mm256_set1_pd(0.5);
+    __m256d sinValue = _mm256_sub_pd(r, _mm256_sub_pd(_mm256_sub_pd(_mm256_mul_pd(z, _mm256_sub_pd(_mm256_mul_pd(half, tail), _mm256_mul_pd(v, sp))), tail),
+                                                      _mm256_mul_pd(v, _mm256_set1_pd(S1))));
+    __m256d cp = _mm256_add_pd(_mm256_mul_pd(z, _mm256_set1_pd(C6)), _mm256_set1_pd(C5));
+    cp = _mm256_add_pd(_mm256_mul_pd(z, cp), _mm256_set1_pd(C4));
+    cp = _mm256_add_pd(_mm256_mul_pd(z, cp), _mm256_set1_pd(C3));
+    cp = _mm256_add_pd(_mm256_mul_pd(z, cp), _mm256_set1_pd(C2));
+    cp = _mm256_mul_pd(z, _mm256_add_pd(_mm256_mul_pd(z, cp), _mm256_set1_pd(C1)));
+    __m256d cosValue = _mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_sub_pd(_mm256_mul_pd(half, z), _mm256_sub_pd(_mm256_mul_pd(z, cp), _mm256_mul_pd(r, tail))));
+
+    // blendv selects by the sign bit alone
+    __m256i quadrant = _mm256_add_epi64(_mm256_castpd_si256(shifted), _mm256_set1_epi64x(Offset));
+    __m256d value = _mm256_blendv_pd(sinValue, cosValue, _mm256_castsi256_pd(_mm256_slli_epi64(quadrant, 63)));
+    value = _mm256_xor_pd(value, _mm256_and_pd(_mm256_castsi256_pd(_mm256_slli_epi64(quadrant, 62)), sign));
+    if (Offset == 0)
+    {
+      value = _mm256_blendv_pd(value, x, _mm256_cmp_pd(_mm256_andnot_pd(sign, x), _mm256_set1_pd(sinTiny), _CMP_LT_OQ));
+    }
+    _mm256_storeu_pd(out + i, value);
+  }
+  for (; i < n; ++i)
+  {
+    out[i] = Offset ? fastCos(in[i]) : fastSin(in[i]);
+  }
+}
+
+static void atan2SSE2(const Number * y, const Number * x, Number * out, std::size_t n)
+{
+  const __m128d sign = _mm_set1_pd(-0.0);
+  const __m128d one = _mm_set1_pd(1.0);
+  std::size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+  {
+    __m128d vy = _mm_loadu_pd(y + i);
+    __m128d vx = _mm_loadu_pd(x + i);
+    __m128d ax = _mm_andnot_pd(sign, vx);
+    __m128d ay = _mm_andnot_pd(sign, vy);
+    __m128d limit = _mm_set1_pd(finiteLimit);
+    if (_mm_movemask_pd(_mm_and_pd(_mm_cmple_pd(ax, limit), _mm_cmple_pd(ay, limit))) != 3)
+    {
+      out[i] = fastAtan2(y[i], x[i]);
+      out[i + 1] = fastAtan2(y[i + 1], x[i + 1]);
+      continue;
+    }
+    __m128d swap = _mm_cmpgt_pd(ay, ax);
+    __m128d num = select(swap, ax, ay);
+    __m128d den = select(swap, ay, ax);
+    __m128d a = _mm_and_pd(_mm_div_pd(num, den), _mm_cmpgt_pd(den, _mm_setzero_pd()));
+    __m128d big = _mm_cmpgt_pd(a, _mm_set1_pd(atanSplit));
+    __m128d t = select(big, _mm_div_pd(_mm_sub_pd(a, one), _mm_add_pd(a, one)), a);
+    __m128d z = _mm_mul_pd(t, t);
+    __m128d p = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(P0), z), _mm_set1_pd(P1));
+    p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(P2));
+    p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(P3));
+    p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(P4));
+    __m128d q = _mm_add_pd(_mm_mul_pd(_mm_add_pd(z, _mm_set1_pd(Q0)), z), _mm_set1_pd(Q1));
+    q = _mm_add_pd(_mm_mul_pd(q, z), _mm_set1_pd(Q2));
+    q = _mm_add_pd(_mm_mul_pd(q, z), _mm_set1_pd(Q3));
+    q = _mm_add_pd(_mm_mul_pd(q, z), _mm_set1_pd(Q4));
+    __m128d atan = _mm_add_pd(_mm_mul_pd(t, _mm_div_pd(_mm_mul_pd(z, p), q)), t);
+
+    __m128d base = _mm_and_pd(big, _mm_set1_pd(piOver4));
+    __m128d more = _mm_and_pd(big, _mm_set1_pd(0.5 * piOver2Low));
+    __m128d high = select(swap, _mm_sub_pd(_mm_set1_pd(piOver2), base), base);
+    __m128d low = select(swap, _mm_sub_pd(_mm_sub_pd(_mm_set1_pd(piOver2Low), more), atan), _mm_add_pd(more, atan));
+    __m128d negative = signMask(_mm_castpd_si128(vx));
+    high = select(negative, _mm_sub_pd(_mm_set1_pd(pi), high), high);
+    low = select(negative, _mm_sub_pd(_mm_set1_pd(piLow), low), low);
+    _mm_storeu_pd(out + i, _mm_or_pd(_mm_add_pd(high, low), _mm_and_pd(vy, sign)));
+  }
+  for (; i < n; ++i)
+  {
+    out[i] = fastAtan2(y[i], x[i]);
+  }
+}
+
+TARGET_AVX2 static void atan2AVX2(const Number * y, const Number * x, Number * out, std::size_t n)
+{
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  const __m256d one = _mm256_set1_pd(1.0);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256d vy = _mm256_loadu_pd(y + i);
+    __m256d vx = _mm256_loadu_pd(x + i);
+    __m256d ax = _mm256_andnot_pd(sign, vx);
+    __m256d ay = _mm256_andnot_pd(sign, vy);
+    __m256d limit = _mm256_set1_pd(finiteLimit);
+    if (_mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(ax, limit, _CMP_LE_OQ), _mm256_cmp_pd(ay, limit, _CMP_LE_OQ))) != 15)
+    {
+      for (std::size_t j = i; j < i + 4; ++j)
+      {
+        out[j] = fastAtan2(y[j], x[j]);
+      }
+      continue;
+    }
+    __m256d swap = _mm256_cmp_pd(ay, ax, _CMP_GT_OQ);
+    __m256d num = _mm256_blendv_pd(ay, ax, swap);
+    __m256d den = _mm256_blendv_pd(ax, ay, swap);
+    __m256d a = _mm256_and_pd(_mm256_div_pd(num, den), _mm256_cmp_pd(den, _mm256_setzero_pd(), _CMP_GT_OQ));
+    __m256d big = _mm256_cmp_pd(a, _mm256_set1_pd(atanSplit), _CMP_GT_OQ);
+    __m256d t = _mm256_blendv_pd(a, _mm256_div_pd(_mm256_sub_pd(a, one), _mm256_add_pd(a, one)), big);
+    __m256d z = _mm256_mul_pd(t, t);
+    __m256d p = _mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(P0), z), _mm256_set1_pd(P1));
+    p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(P2));
+    p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(P3));
+    p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(P4));
+    __m256d q = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(z, _mm256_set1_pd(Q0)), z), _mm256_set1_pd(Q1));
+    q = _mm256_add_pd(_mm256_mul_pd(q, z), _mm256_set1_pd(Q2));
+    q = _mm256_add_pd(_mm256_mul_pd(q, z), _mm256_set1_pd(Q3));
+    q = _mm256_add_pd(_mm256_mul_pd(q, z), _mm256_set1_pd(Q4));
+    __m256d atan = _mm256_add_pd(_mm256_mul_pd(t, _mm256_div_pd(_mm256_mul_pd(z, p), q)), t);
+
+    __m256d base = _mm256_and_pd(big, _mm256_set1_pd(piOver4));
+    __m256d more = _mm256_and_pd(big, _mm256_set1_pd(0.5 * piOver2Low));
+    __m256d high = _mm256_blendv_pd(base, _mm256_sub_pd(_mm256_set1_pd(piOver2), base), swap);
+    __m256d low = _mm256_blendv_pd(_mm256_add_pd(more, atan), _mm256_sub_pd(_mm256_sub_pd(_mm256_set1_pd(piOver2Low), more), atan), swap);
+    high = _mm256_blendv_pd(high, _mm256_sub_pd(_mm256_set1_pd(pi), high), vx);
+    low = _mm256_blendv_pd(low, _mm256_sub_pd(_mm256_set1_pd(piLow), low), vx);
+    _mm256_storeu_pd(out + i, _mm256_or_pd(_mm256_add_pd(high, low), _mm256_and_pd(vy, sign)));
+  }
+  for (; i < n; ++i)
+  {
+    out[i] = fastAtan2(y[i], x[i]);
+  }
+}
+#endif
+
+void fastSin(const Number * in, Number * out, std::size_t n)
+{
+#ifdef SLISP_X86_SIMD
+  switch (simdLevel())
+  {
+  case SimdLevel::AVX2: sinCosAVX2<0>(in, out, n); return;
+  case SimdLevel::SSE2: sinCosSSE2<0>(in, out, n); return;
+  default: break;
+  }
+#endif
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    out[i] = fastSin(in[i]);
+  }
+}
+
+void fastCos(const Number * in, Number * out, std::size_t n)
+{
+#ifdef SLISP_X86_SIMD
+  switch (simdLevel())
+  {
+  case SimdLevel::AVX2: sinCosAVX2<1>(in, out, n); return;
+  case SimdLevel::SSE2: sinCosSSE2<1>(in, out, n); return;
+  default: break;
+  }
+#endif
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    out[i] = fastCos(in[i]);
+  }
+}
+
+void fastAtan2(const Number * y, const Number * x, Number * out, std::size_t n)
+{
+#ifdef SLISP_X86_SIMD
+  switch (simdLevel())
+  {
+  case SimdLevel::AVX2: atan2AVX2(y, x, out, n); return;
+  case SimdLevel::SSE2: atan2SSE2(y, x, out, n); return;
+  default: break;
+  }
+#endif
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    out[i] = fastAtan2(y[i], x[i]);
+  }
+}
+
+static std::atomic<bool> & fastMathEnabled()
+{
+  static std::atomic<bool> enabled(false);
+  return enabled;
+}
+
+bool fastMath()
+{
+  return fastMathEnabled();
+}
+
+void setFastMath(bool enabled)
+{
+  fastMathEnabled() = enabled;
+}
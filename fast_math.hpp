@@ -0,0 +1,29 @@
+#ifndef FAST_MATH_HPP
+#define FAST_MATH_HPP
+
+// system includes
+#include <cstddef>
+
+// module includes
+#include "expression.hpp"
+
+// Polynomial approximations of sin, cos and atan2 for rendering, faster
+// than libm and vectorised over arrays. Every result is within 2 ULP of the
+// exact value. sin and cos reduce their argument exactly for |x| <= 2^19
+// and use libm beyond; atan2 uses libm for infinite and NaN arguments.
+// The results do not depend on the SIMD level.
+Number fastSin(Number x);
+Number fastCos(Number x);
+Number fastAtan2(Number y, Number x);
+
+// out[i] = fastSin(in[i]) for i < n, and likewise; out may be in
+void fastSin(const Number * in, Number * out, std::size_t n);
+void fastCos(const Number * in, Number * out, std::size_t n);
+void fastAtan2(const Number * y, const Number * x, Number * out, std::size_t n);
+
+// Selects the approximations for the sin, cos and arctan builtins,
+// numbers and vectors alike. Off by default, the builtins then use libm.
+bool fastMath();
+void setFastMath(bool enabled);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef GRAPHICS_WRITER_HPP
+#define GRAPHICS_WRITER_HPP
+
+struct PointBuffer;
+
+// A GraphicsWriter takes what QtInterpreter draws one graphic at a time,
+// as it is drawn, in place of the scene items it would otherwise create,
+// and writes it out
+class GraphicsWriter{
+public:
+  virtual ~GraphicsWriter() = default;
+
+  // a point is a 1x1 ellipse at (x, y), as QtInterpreter draws it
+  virtual void point(double x, double y) = 0;
+  virtual void line(double x1, double y1, double x2, double y2) = 0;
+  // takes the arguments of the QGraphicsArcItem constructor
+  virtual void arc(double x, double y, double width, double height) = 0;
+  // a polyline, or a polygon if closed
+  virtual void polyline(const PointBuffer &points, bool closed) = 0;
+
+  // false if the output could not be opened or written
+  virtual bool good() const = 0;
+
+  // Completes the output; returns false if writing failed
+  virtual bool finish() = 0;
+};
+
+#endif
@@ -0,0 +1,162 @@
+#include "hash_consing.hpp"
+
+// system includes
+#include <map>
+#include <set>
+#include <utility>
+
+// module includes
+#include "type_inference.hpp"
+#include "constant_folding.hpp"
+#include "closure.hpp"
+
+// Tails are equivalent if their elements have identical heads and share
+// their own tails, which holds for identical subtrees once those are interned
+static bool equivalent(const Tail & a, const Tail & b)
+{
+  if (a.size() != b.size())
+  {
+    return false;
+  }
+  for (std::size_t i = 0; i < a.size(); ++i)
+  {
+    if (!sameAtom(a[i].head, b[i].head) || a[i].tail.storage() != b[i].tail.storage())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void HashConsTable::intern(Expression & expr)
+{
+  if (expr.tail.empty())
+  {
+    return;
+  }
+
+  std::size_t hash = expr.tail.hash();
+  auto range = tails.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it)
+  {
+    if (equivalent(it->second, expr.tail))
+    {
+      expr.tail = it->second;
+      ++hitCount;
+      return;
+    }
+  }
+  tails.emplace(hash, expr.tail);
+}
+
+std::size_t HashConsTable::hits() const
+{
+  return hitCount;
+}
+
+// A subexpression is identified by its head symbol and its shared tail
+typedef std::pair<const void *, Symbol> NodeKey;
+
+class CommonSubexpressions
+{
+public:
+  CommonSubexpressions(const Environment & environment, const std::set<Symbol> & definitions,
+                       const std::set<Symbol> & assignments)
+    : env(environment), defined(definitions), assigned(assignments) {}
+
+  // Counts the occurrences of every pure call, returns true if expr is pure
+  bool count(const Expression & expr);
+
+  // Gives a slot to every pure call occurring more than once
+  void assign(const Expression & expr);
+
+  std::size_t slots = 0;
+
+private:
+  bool isPureCall(const Expression & expr) const;
+
+  const Environment & env;
+  const std::set<Symbol> & defined;
+  const std::set<Symbol> & assigned;
+  std::map<NodeKey, std::size_t> occurrences;
+  std::map<NodeKey, int> slotOf;
+};
+
+bool CommonSubexpressions::isPureCall(const Expression & expr) const
+{
+  const Symbol & symbol = expr.head.value.sym_value;
+  if (defined.count(symbol) != 0)
+  {
+    return false;
+  }
+  Procedure procedure = env.lookupProcedure(symbol);
+  return procedure != nullptr && findSignature(procedure) != nullptr;
+}
+
+bool CommonSubexpressions::count(const Expression & expr)
+{
+  if (expr.tail.empty())
+  {
+    // a variable assigned by set! may change between two occurrences
+    return expr.head.type != SymbolType || assigned.count(expr.head.value.sym_value) == 0;
+  }
+  if (expr.head.type != SymbolType)
+  {
+    return false;
+  }
+  // the body of a binding form depends on variables whose values differ
+  // from one evaluation of the body to the next
+  if (isBindingForm(expr))
+  {
+    return false;
+  }
+
+  bool pure = isPureCall(expr);
+  for (const auto & e : expr.tail)
+  {
+    pure = count(e) && pure;
+  }
+  if (pure)
+  {
+    ++occurrences[NodeKey(expr.tail.storage(), expr.head.value.sym_value)];
+  }
+  return pure;
+}
+
+void CommonSubexpressions::assign(const Expression & expr)
+{
+  expr.cseSlot = -1;
+  if (expr.tail.empty() || isBindingForm(expr))
+  {
+    return;
+  }
+
+  NodeKey key(expr.tail.storage(), expr.head.value.sym_value);
+  auto it = occurrences.find(key);
+  if (it != occurrences.end() && it->second > 1)
+  {
+    auto slot = slotOf.find(key);
+    if (slot == slotOf.end())
+    {
+      slot = slotOf.emplace(key, static_cast<int>(slots++)).first;
+    }
+    expr.cseSlot = slot->second;
+  }
+  for (const auto & e : expr.tail)
+  {
+    assign(e);
+  }
+}
+
+std::size_t eliminateCommonSubexpressions(const Expression & ast, const Environment & env)
+{
+  std::set<Symbol> defined;
+  collectDefinitions(ast, defined);
+  std::set<Symbol> assigned;
+  collectAssignments(ast, assigned);
+
+  CommonSubexpressions cse(env, defined, assigned);
+  cse.count(ast);
+  cse.assign(ast);
+  return cse.slots;
+}
@@ -0,0 +1,33 @@
+#ifndef HASH_CONSING_HPP
+#define HASH_CONSING_HPP
+
+// system includes
+#include <cstddef>
+#include <unordered_map>
+
+// module includes
+#include "expression.hpp"
+#include "environment.hpp"
+
+// Interns tails while an AST is built bottom-up, so that structurally
+// identical subtrees are stored once and the AST becomes a DAG.
+class HashConsTable{
+public:
+  // Replaces the tail of expr by an identical one interned earlier, or
+  // interns it. The elements of the tail must have been interned already.
+  void intern(Expression & expr);
+
+  // number of tails replaced by an interned one
+  std::size_t hits() const;
+
+private:
+  std::unordered_multimap<std::size_t, Tail> tails;
+  std::size_t hitCount = 0;
+};
+
+// Marks every pure builtin call that occurs more than once in ast with a
+// memo slot (Expression::cseSlot), so it is evaluated once per evaluation.
+// Returns the number of slots used.
+std::size_t eliminateCommonSubexpressions(const Expression & ast, const Environment & env);
+
+#endif
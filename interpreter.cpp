@@ -5,16 +5,73 @@
 #include <stdexcept>
 #include <iostream>
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 // module includes
 #include "tokenize.hpp"
 #include "expression.hpp"
 #include "environment.hpp"
 #include "interpreter_semantic_error.hpp"
+#include "sequence.hpp"
+#include "number_vector.hpp"
+#include "point_buffer.hpp"
 
 
+// true for the token tokenize leaves in place of a vector literal
+static bool isVectorLiteral(const std::string& token)
+{
+    return token.size() > 2 && token[0] == '#' && token[1] == OPEN;
+}
+
+// Type of the shape a builtin creates, NoneType for other procedures
+static Type shapeType(Procedure procedure)
+{
+    return procedure == pointsProcedure ? PointsType : procedure == polylineProcedure ? PolylineType :
+        procedure == polygonProcedure ? PolygonType : NoneType;
+}
+
+static bool hasSequence(const std::vector<Atom>& args)
+{
+    for (const auto& arg : args){
+        if (arg.type == SequenceType){
+            return true;
+        }
+    }
+    return false;
+}
+
+// Iterations of a loop counting from 0 while below count, which may be
+// fractional, beyond 64 bits or NaN
+static std::uint64_t iterationCount(Number count)
+{
+    if (!(count > 0)){
+        return 0;
+    }
+    if (count >= 18446744073709551616.0){ // 2^64
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+    return static_cast<std::uint64_t>(std::ceil(count));
+}
+
+// Appends the heads of the elements of a list, and of the lists within it
+static void appendElements(const Expression& list, std::vector<Atom>& args)
+{
+    for (const auto& element : list.tail){
+        if (element.head.type == ListType){
+            appendElements(element, args);
+        }
+        else{
+            args.push_back(element.head);
+        }
+    }
+}
+
 //class constructor
-Interpreter::Interpreter() {}
+Interpreter::Interpreter()
+{
+    registerStandardPasses(passes);
+}
 
 bool Interpreter::parse(std::istream & expression) noexcept
 {
@@ -25,7 +82,16 @@ bool Interpreter::parse(std::istream & expression) noexcept
         return false;
     }
 
-    TokenSequenceType tokens = tokenize(expression);
+    TokenSequenceType tokens;
+    try
+    {
+        vectorLiterals.clear();
+        tokens = tokenize(expression, vectorLiterals);
+    }
+    catch (...)
+    {
+        return false;
+    }
     auto iter = tokens.begin();
     if (iter == tokens.end())
     {
@@ -35,6 +101,12 @@ bool Interpreter::parse(std::istream & expression) noexcept
     try
     {
         ast = parseExpression(iter, tokens.end());
+        consTable = HashConsTable();
+        optimized = false;
+        if (ast.head.type == ListType && ast.tail.empty())
+        {
+            return false; // Empty expression
+        }
 
         // After successfully parsing an expression, there should be no tokens left.
         if (iter != tokens.end())
@@ -44,6 +116,7 @@ bool Interpreter::parse(std::istream & expression) noexcept
     }
     catch (...)
     {
+        consTable = HashConsTable();
         return false;
     }
 
@@ -57,9 +130,49 @@ Expression Interpreter::eval()
         throw InterpreterSemanticError("Error: No AST to evaluate.");
     }
 
+    prepare();
     return evaluateExpression(ast);
 }
 
+// Checks and optimises the parsed AST before it is evaluated.
+// The whole pipeline runs once per parsed AST; afterwards only the passes
+// that depend on the environment rerun, and only when it has changed.
+void Interpreter::prepare()
+{
+    if (!optimized)
+    {
+        passes.run(ast, env);
+        cseMemo.assign(passes.results().cseSlots, CommonValue());
+        optimized = true;
+        passedVersion = env.getVersion();
+    }
+    else if (passedVersion != env.getVersion())
+    {
+        passes.rerun(ast, env);
+        passedVersion = env.getVersion();
+    }
+    frames.assign(passes.results().frameSize, Expression());
+    frameBase = 0;
+    closure = nullptr;
+    graphics.clear();
+    ++evaluation;
+}
+
+void Interpreter::setPassOptions(const PassOptions & options)
+{
+    passes.setOptions(options);
+}
+
+void Interpreter::reportPassTimings(std::ostream & out) const
+{
+    passes.reportTimings(out);
+}
+
+const TypeInferenceStats& Interpreter::typeInferenceStats() const
+{
+    return passes.results().typeStats;
+}
+
 /*
  * Parses and constructs an Expression from a sequence of tokens.
  *
@@ -78,11 +191,42 @@ Expression Interpreter::parseExpression(TokenIteratorType& token, TokenIteratorT
     if (currentToken == "(")
     {
         ++token;
-        if (token == end || *token == ")")
+        if (token == end)
         {
             throw InterpreterSemanticError("Error: empty expression.");
         }
         currentToken = *token;
+        if (currentToken == "(" || currentToken == ")")
+        {
+            // A list with no operator, such as the bindings of let, the
+            // parameters () of lambda or the call ((lambda (x) x) 1)
+            std::vector<Expression> items;
+            while (token != end && *token != ")")
+            {
+                items.push_back(parseExpression(token, end));
+            }
+            if (token == end)
+            {
+                throw InterpreterSemanticError("Error: expected closing parenthesis.");
+            }
+            ++token;
+            Expression list;
+            list.head.type = ListType;
+            list.tail = Tail(items);
+            consTable.intern(list);
+            return list;
+        }
+        if (isVectorLiteral(currentToken))
+        {
+            // (#(1 2)) is the vector, as (1) is the number
+            Expression vector = parseExpression(token, end);
+            if (token == end || *token != ")")
+            {
+                throw InterpreterSemanticError("Error: expected closing parenthesis after atomic expression.");
+            }
+            ++token;
+            return vector;
+        }
         Atom potentialAtom;
         if (!token_to_atom(currentToken, potentialAtom))
         {
@@ -114,7 +258,26 @@ Expression Interpreter::parseExpression(TokenIteratorType& token, TokenIteratorT
             throw InterpreterSemanticError("Error: expected closing parenthesis.");
         }
         ++token;
-        return Expression(currentToken, operands);
+        if (operands.empty())
+        {
+            // (f) is a list, so it stays apart from the variable f: it calls
+            // a closure with no arguments, and lambda takes it for (x)
+            Expression list;
+            list.head.type = ListType;
+            list.tail = Tail(std::vector<Expression>(1, Expression(potentialAtom)));
+            consTable.intern(list);
+            return list;
+        }
+        Expression node(currentToken, operands);
+        consTable.intern(node);
+        return node;
+    }
+    if (isVectorLiteral(currentToken))
+    {
+        // the numbers were parsed by tokenize, the token holds their index
+        std::size_t index = std::stoul(currentToken.substr(2));
+        ++token;
+        return vectorExpression(std::move(vectorLiterals.at(index)));
     }
     if (currentToken != ")")
     {
@@ -130,22 +293,69 @@ Expression Interpreter::parseExpression(TokenIteratorType& token, TokenIteratorT
 }
 
 /**
- * Parses and constructs an Expression from a sequence of tokens.
+ * Evaluates an Expression in the current environment and frame.
  *
- * This function is responsible for recursively parsing tokens to build a structured
- * Expression object. It handles different types of tokens, including atomic values,
- * parentheses, and operations. If encountered, it validates the token sequence and
- * constructs an Expression accordingly.
+ * Tail positions (the branches of if, the last form of begin, the body of
+ * let and of a called closure) are evaluated by the loop itself rather than
+ * by a nested call, so they run in constant C++ stack. A closure called in
+ * tail position replaces the frame the loop pushed for the previous one.
+ * Other nested evaluations may use up to maxEvaluationStack bytes of stack.
  */
-Expression Interpreter::evaluateExpression(const Expression& expr){ // If the expression is atomic (has no tail):
-    if (expr.tail.empty()){// If the head is a symbol:
-        if (expr.head.type == SymbolType){
-            return env.get(expr.head.value.sym_value);
-        } return expr;  // If the head isn't a symbol
-    }
-    if (!expr.tail.empty()){ // If the expression is not atomic (has a tail):
-        if (expr.head.type == SymbolType){// The head should be an operation or procedure.
-            std::string symbol = expr.head.value.sym_value;         
+Expression Interpreter::evaluateExpression(const Expression& start){
+    DepthGuard guard(depth);
+    char marker;
+    std::uintptr_t here = reinterpret_cast<std::uintptr_t>(&marker);
+    if (depth == 1){
+        stackBase = here;
+    }
+    else if ((stackBase > here ? stackBase - here : here - stackBase) > maxEvaluationStack){
+        throw InterpreterSemanticError("Error: Maximum recursion depth exceeded.");
+    }
+
+    // the caller's frame, restored on return if the loop called a closure
+    const std::size_t callerTop = frames.size();
+    const std::size_t callerBase = frameBase;
+    const Closure * const caller = closure;
+    std::shared_ptr<const Closure> callee; // keeps the running closure alive
+
+    const Expression* current = &start;
+    Expression result;
+    try{
+        for (;;){
+            if (cancelled.load(std::memory_order_relaxed)){
+                throw InterpreterSemanticError("Error: Evaluation cancelled.");
+            }
+            const Expression& expr = *current;
+            if (expr.tail.empty()){ // If the expression is atomic (has no tail):
+                if (expr.head.type == SymbolType){
+                    result = lookupVariable(expr);
+                } else if (expr.head.type == ListType){
+                    throw InterpreterSemanticError("Error: empty expression.");
+                } else{
+                    result = expr;  // If the head isn't a symbol
+                }
+                break;
+            }
+            if (expr.head.type == ListType){
+                // (f) calls the closure f, or is the value of f as (1) is 1,
+                // and ((lambda (x) x) 1) applies the lambda at its head
+                Expression head = evaluateExpression(expr.tail[0]);
+                if (head.head.type != LambdaType){
+                    if (expr.tail.size() != 1){
+                        throw InterpreterSemanticError("Error: Head of expression is not a procedure.");
+                    }
+                    result = head;
+                    break;
+                }
+                std::shared_ptr<const Closure> function = head.head.value.shared<Closure>();
+                current = enterClosure(*function, expr, 1, callerTop);
+                callee = function;
+                continue;
+            }
+            if (expr.head.type != SymbolType){
+                throw InterpreterSemanticError("Error: Head of expression is not a symbol.");
+            }
+            const std::string& symbol = expr.head.value.sym_value;
             if (symbol == "if"){ // Special handling for special forms
                 if (expr.tail.size() != 3){
                     throw InterpreterSemanticError("Error: Incorrect number of arguments for 'if'.");
@@ -154,51 +364,582 @@ Expression Interpreter::evaluateExpression(const Expression& expr){ // If the ex
                 if (condition.head.type != BooleanType){
                     throw InterpreterSemanticError("Error: Conditional in 'if' is not a boolean.");
                 }
-                if (condition.head.value.bool_value){
-                    return evaluateExpression(expr.tail[1]);
-                }
-                if (!condition.head.value.bool_value){
-                    return evaluateExpression(expr.tail[2]);
-                } }
-            else if (symbol == "begin"){
-                if (expr.tail.empty()){
-                    throw InterpreterSemanticError("Error: 'begin' requires at least one argument.");
+                current = condition.head.value.bool_value ? &expr.tail[1] : &expr.tail[2];
+                continue;
+            }
+            if (symbol == "begin"){
+                for (std::size_t i = 0; i + 1 < expr.tail.size(); ++i){
+                    evaluateExpression(expr.tail[i]);
                 }
-                Expression lastExpr;
-                for (const auto& e : expr.tail){
-                    lastExpr = evaluateExpression(e);
-                } return lastExpr;
-            }
-            else if (symbol == "define"){
-                if (expr.tail.size() != 2 || expr.tail[0].head.type != SymbolType){
-                    throw InterpreterSemanticError("Error: Incorrect use of 'define'.");
+                current = &expr.tail.back();
+                continue;
+            }
+            if (symbol == "let"){
+                bindLet(expr);
+                current = &expr.tail[1];
+                continue;
+            }
+            if (symbol == "lambda"){
+                result = makeClosure(expr);
+                break;
+            }
+            if (symbol == "define"){
+                result = evaluateDefine(expr);
+                break;
+            }
+            if (symbol == "set!"){
+                result = evaluateSet(expr);
+                break;
+            }
+            if (symbol == "while"){
+                result = evaluateWhile(expr);
+                break;
+            }
+            if (symbol == "dotimes" || symbol == "for"){
+                result = evaluateFor(expr);
+                break;
+            }
+            if (symbol == "repeat"){
+                result = evaluateRepeat(expr);
+                break;
+            }
+            if (symbol == "map" || symbol == "iterate"){
+                result = makeSequence(expr);
+                break;
+            }
+            if (expr.cseSlot >= 0){
+                result = evaluateCommon(expr);
+                break;
+            }
+            if (expr.signature != nullptr){
+                result = applyProvenCall(expr);
+                break;
+            }
+
+            std::shared_ptr<const Closure> function = lookupClosure(expr);
+            if (!function){ // For other symbols, evaluate as procedures
+                std::vector<Atom>& args = atomBuffer();
+                evaluateArguments(expr, args);
+                Procedure procedure = lookupProcedure(expr);
+                if (shapeType(procedure) != NoneType && hasSequence(args)){
+                    result = collectShape(shapeType(procedure), args);
                 }
-                std::string variable = expr.tail[0].head.value.sym_value; // Extract the symbol string from the first item in the tail.
-                if (isSymbolStringDefined(variable)){
-                    throw InterpreterSemanticError("Error: Variable already exists");
+                else{
+                    result = env.applyProcedure(procedure, args);
                 }
-                std::string symbol_to_define = expr.tail[0].head.value.sym_value;
-                std::vector<std::string> specialForms = { "define", "if", "begin" };
-                std::vector<std::string> builtInSymbols = { "pi", "+", "-", "*", "/" };
-                if ((std::find(specialForms.begin(), specialForms.end(), symbol_to_define) != specialForms.end()) || (std::find(builtInSymbols.begin(), builtInSymbols.end(), symbol_to_define) != builtInSymbols.end())){
-                    throw InterpreterSemanticError("Error: Cannot redefine special form or built-in symbol.");
+                if (procedure == drawProcedure && recordGraphics && loopDepth > 0){
+                    if (result.head.type == ListType){
+                        appendElements(result, graphics);
+                    }
+                    else{
+                        graphics.push_back(result.head);
+                    }
                 }
-                Expression value = evaluateExpression(expr.tail[1]);
-                env.addSymbol(symbol_to_define, value);
-                return value;
-            }
-            else{
-                std::vector<Expression> args; // For other symbols, evaluate as procedures
-                for (const auto& e : expr.tail) {
-                    args.push_back(evaluateExpression(e));
-                }   return env.evaluateProcedure(symbol, args);
-            }}
+                break;
+            }
+
+            // call the closure in this loop, in the frame above the caller's
+            current = enterClosure(*function, expr, 0, callerTop);
+            callee = function;
+        }
+    }
+    catch (...){
+        frames.resize(callerTop);
+        frameBase = callerBase;
+        closure = caller;
+        throw;
+    }
+    if (callee){
+        frames.resize(callerTop);
+        frameBase = callerBase;
+        closure = caller;
+    }
+    return result;
+}
+
+// Evaluates the operands of a call from first on as the arguments of
+// function, moves them into its frame above callerTop and makes it the
+// running closure. Returns the body to evaluate next.
+const Expression* Interpreter::enterClosure(const Closure& function, const Expression& expr, std::size_t first, std::size_t callerTop)
+{
+    std::vector<Expression>& args = expressionBuffer();
+    args.clear();
+    for (std::size_t i = first; i < expr.tail.size(); ++i){
+        args.push_back(evaluateExpression(expr.tail[i]));
+    }
+
+    const LambdaInfo& lambda = *function.lambda;
+    if (args.size() != lambda.params){
+        throw InterpreterSemanticError("Error: Incorrect number of arguments for lambda.");
+    }
+    frames.resize(callerTop + lambda.frameSize);
+    for (std::size_t i = 0; i < args.size(); ++i){
+        frames[callerTop + i] = std::move(args[i]);
+    }
+    frameBase = callerTop;
+    closure = &function;
+    return &lambda.body;
+}
+
+// Binds a variable globally
+Expression Interpreter::evaluateDefine(const Expression& expr)
+{
+    if (expr.tail.size() != 2 || expr.tail[0].head.type != SymbolType){
+        throw InterpreterSemanticError("Error: Incorrect use of 'define'.");
+    }
+    std::string variable = expr.tail[0].head.value.sym_value; // Extract the symbol string from the first item in the tail.
+    if (isSymbolStringDefined(variable)){
+        throw InterpreterSemanticError("Error: Variable already exists");
+    }
+    std::vector<std::string> specialForms = { "define", "if", "begin", "lambda", "let", "set!", "while", "dotimes", "for", "repeat", "map", "iterate" };
+    std::vector<std::string> builtInSymbols = { "pi", "+", "-", "*", "/" };
+    if ((std::find(specialForms.begin(), specialForms.end(), variable) != specialForms.end()) || (std::find(builtInSymbols.begin(), builtInSymbols.end(), variable) != builtInSymbols.end())){
+        throw InterpreterSemanticError("Error: Cannot redefine special form or built-in symbol.");
+    }
+    Expression value = evaluateExpression(expr.tail[1]);
+    env.addSymbol(variable, value);
+    return value;
+}
+
+// Resolves a variable reference through the node's inline cache.
+// The map is searched only when the environment changed since the last hit.
+const Expression& Interpreter::lookupVariable(const Expression& expr)
+{
+    if (expr.frameSlot >= 0)
+    {
+        return frames[frameBase + expr.frameSlot];
+    }
+    if (expr.captureSlot >= 0)
+    {
+        return closure->captured[expr.captureSlot];
+    }
+    InlineCache& cache = expr.cache.get();
+    if (cache.version != env.getVersion() || cache.value == nullptr)
+    {
+        const Expression * slot = env.lookupExpression(expr.head.value.sym_value);
+        if (slot == nullptr)
+        {
+            throw InterpreterSemanticError("Error: Symbol not found or not associated with an expression.");
+        }
+        cache.value = slot;
+        cache.proc = nullptr;
+        cache.version = env.getVersion();
+    }
+    return *cache.value;
+}
+
+// Resolves the procedure of a call site through the node's inline cache.
+Procedure Interpreter::lookupProcedure(const Expression& expr)
+{
+    InlineCache& cache = expr.cache.get();
+    if (cache.version != env.getVersion() || cache.proc == nullptr)
+    {
+        Procedure procedure = env.lookupProcedure(expr.head.value.sym_value);
+        if (procedure == nullptr)
+        {
+            throw InterpreterSemanticError("Error: Symbol not found or not associated with a procedure.");
+        }
+        cache.proc = procedure;
+        cache.value = nullptr;
+        cache.version = env.getVersion();
+    }
+    return cache.proc;
+}
+
+// Evaluates the arguments of a call site and applies its builtin procedure
+Expression Interpreter::applyCall(const Expression& expr)
+{
+    if (expr.signature != nullptr){
+        return applyProvenCall(expr);
+    }
+    std::vector<Atom>& args = atomBuffer(); // For other symbols, evaluate as procedures
+    evaluateArguments(expr, args);
+    return env.applyProcedure(lookupProcedure(expr), args);
+}
+
+// Evaluates the arguments of a builtin call into args. A list argument,
+// such as draw returns for several graphics, stands for its elements,
+// since an atom cannot hold them.
+void Interpreter::evaluateArguments(const Expression& expr, std::vector<Atom>& args)
+{
+    args.clear();
+    for (const auto& e : expr.tail){
+        Expression value = evaluateExpression(e);
+        if (value.head.type == ListType){
+            appendElements(value, args);
+        }
+        else{
+            args.push_back(value.head);
+        }
+    }
+}
+
+// Argument buffers of the current evaluation depth. They are reused by
+// every call evaluated at that depth, so loops allocate them only once.
+// A deque keeps them in place while deeper ones are added.
+std::vector<Atom>& Interpreter::atomBuffer()
+{
+    if (atomBuffers.size() <= depth){
+        atomBuffers.resize(depth + 1);
+    }
+    return atomBuffers[depth];
+}
+
+std::vector<Expression>& Interpreter::expressionBuffer()
+{
+    if (expressionBuffers.size() <= depth){
+        expressionBuffers.resize(depth + 1);
+    }
+    return expressionBuffers[depth];
+}
+
+// Returns the closure a call site names, or nullptr if it names a builtin.
+// Global bindings go through the node's inline cache like procedures do.
+std::shared_ptr<const Closure> Interpreter::lookupClosure(const Expression& expr)
+{
+    const Expression * binding = nullptr;
+    if (expr.frameSlot >= 0 || expr.captureSlot >= 0)
+    {
+        binding = &lookupVariable(expr);
+        if (binding->head.type != LambdaType)
+        {
+            throw InterpreterSemanticError("Error: Symbol not found or not associated with a procedure.");
+        }
+        return binding->head.value.shared<Closure>();
+    }
+    InlineCache& cache = expr.cache.get();
+    if (cache.version != env.getVersion())
+    {
+        cache.proc = env.lookupProcedure(expr.head.value.sym_value);
+        cache.value = cache.proc == nullptr ? env.lookupExpression(expr.head.value.sym_value) : nullptr;
+        cache.version = env.getVersion();
+    }
+    binding = cache.value;
+    if (binding != nullptr && binding->head.type == LambdaType)
+    {
+        return binding->head.value.shared<Closure>();
+    }
+    return nullptr;
+}
+
+// Creates a closure, copying the variables the lambda captures
+// from the current frame and closure
+Expression Interpreter::makeClosure(const Expression& expr)
+{
+    if (!expr.lambda)
+    {
+        throw InterpreterSemanticError("Error: Incorrect use of 'lambda'.");
+    }
+    std::shared_ptr<Closure> result = std::make_shared<Closure>();
+    result->lambda = expr.lambda;
+    result->captured.reserve(expr.lambda->captures.size());
+    for (const CaptureSource& source : expr.lambda->captures)
+    {
+        result->captured.push_back(source.captured ? closure->captured[source.index] : frames[frameBase + source.index]);
+    }
+    Atom atom;
+    atom.type = LambdaType;
+    atom.value.object = result;
+    return Expression(atom);
+}
+
+// Assigns a variable bound by define, let, lambda or a loop.
+// The new value must have the type of the old one, which type inference relies on.
+Expression Interpreter::evaluateSet(const Expression& expr)
+{
+    if (expr.tail.size() != 2 || expr.tail[0].head.type != SymbolType || !expr.tail[0].tail.empty()){
+        throw InterpreterSemanticError("Error: Incorrect use of 'set!'.");
+    }
+    const Expression& variable = expr.tail[0];
+    std::vector<std::string> builtInSymbols = { "pi", "+", "-", "*", "/" };
+    if (std::find(builtInSymbols.begin(), builtInSymbols.end(), variable.head.value.sym_value) != builtInSymbols.end()){
+        throw InterpreterSemanticError("Error: Cannot redefine special form or built-in symbol.");
+    }
+    Expression value = evaluateExpression(expr.tail[1]);
+    if (lookupVariable(variable).head.type != value.head.type){
+        throw InterpreterSemanticError("Error: Cannot change the type of a variable with 'set!'.");
+    }
+    if (variable.frameSlot >= 0){
+        frames[frameBase + variable.frameSlot] = value;
+    }
+    else{
+        env.setSymbol(variable.head.value.sym_value, value);
+    }
+    return value;
+}
+
+// Loops return the value of their body in the last iteration, False if none ran
+Expression Interpreter::evaluateWhile(const Expression& expr)
+{
+    if (expr.tail.size() != 2){
+        throw InterpreterSemanticError("Error: Incorrect use of 'while'.");
+    }
+    DepthGuard loop(loopDepth);
+    Expression last(false);
+    for (;;){
+        Expression condition = evaluateExpression(expr.tail[0]);
+        if (condition.head.type != BooleanType){
+            throw InterpreterSemanticError("Error: Condition in 'while' is not a boolean.");
+        }
+        if (!condition.head.value.bool_value){
+            return last;
+        }
+        last = evaluateExpression(expr.tail[1]);
+    }
+}
+
+// (dotimes (i n) body) counts i from 0 to n - 1,
+// (for (i start end step) body) from start by step while before end
+Expression Interpreter::evaluateFor(const Expression& expr)
+{
+    const std::string& form = expr.head.value.sym_value;
+    const Expression& variable = expr.tail[0];
+    if (expr.tail.size() != 2 || variable.frameSlot < 0){
+        throw InterpreterSemanticError("Error: Incorrect use of '" + form + "'.");
+    }
+    Number bounds[3] = {0, 0, 1};
+    Integer integerBounds[3] = {0, 0, 1};
+    bool integer = true;
+    std::size_t first = form == "dotimes" ? 1 : 0;
+    for (std::size_t i = 0; i < variable.tail.size(); ++i){
+        Expression bound = evaluateExpression(variable.tail[i]);
+        if (bound.head.type != NumberType){
+            throw InterpreterSemanticError("Error: Bounds of '" + form + "' are not numbers.");
+        }
+        bounds[first + i] = bound.head.value.num_value;
+        integerBounds[first + i] = bound.head.value.int_value;
+        integer = integer && bound.head.value.is_integer;
+    }
+    if (bounds[2] == 0){
+        throw InterpreterSemanticError("Error: Step of 'for' is zero.");
+    }
+
+    // counting iterations avoids accumulating rounding errors in i, which
+    // is an integer if the bounds are; i lies between start and end, so
+    // computing it modulo 2^64 gives its exact value
+    std::uint64_t count = iterationCount(integer ? integerCount(integerBounds[0], integerBounds[1], integerBounds[2])
+                                                 : (bounds[1] - bounds[0]) / bounds[2]);
+    DepthGuard loop(loopDepth);
+    Expression last(false);
+    for (std::uint64_t k = 0; k < count; ++k){
+        if (integer){
+            frames[frameBase + variable.frameSlot] = Expression(static_cast<Integer>(static_cast<std::uint64_t>(integerBounds[0]) +
+                k * static_cast<std::uint64_t>(integerBounds[2])));
+        }
         else{
-            throw InterpreterSemanticError("Error: Head of expression is not a symbol.");
-        } }
+            frames[frameBase + variable.frameSlot] = Expression(bounds[0] + static_cast<Number>(k) * bounds[2]);
+        }
+        last = evaluateExpression(expr.tail[1]);
+    }
+    return last;
+}
+
+// (repeat (acc init) n body) evaluates body n times, acc holding init
+// and then the value of the previous iteration; returns the last value
+Expression Interpreter::evaluateRepeat(const Expression& expr)
+{
+    const Expression& variable = expr.tail[0];
+    if (expr.tail.size() != 3 || variable.frameSlot < 0){
+        throw InterpreterSemanticError("Error: Incorrect use of 'repeat'.");
+    }
+    Expression initial = evaluateExpression(variable.tail[0]);
+    Expression count = evaluateExpression(expr.tail[1]);
+    if (count.head.type != NumberType || count.head.value.num_value < 0){
+        throw InterpreterSemanticError("Error: Count of 'repeat' is not a non-negative number.");
+    }
+    frames[frameBase + variable.frameSlot] = initial;
+    DepthGuard loop(loopDepth);
+    for (std::uint64_t k = 0, n = iterationCount(count.head.value.num_value); k < n; ++k){
+        Expression next = evaluateExpression(expr.tail[2]);
+        frames[frameBase + variable.frameSlot] = std::move(next);
+    }
+    return frames[frameBase + variable.frameSlot];
+}
+
+// (map f sequence) and (iterate f seed) create sequences applying f lazily
+Expression Interpreter::makeSequence(const Expression& expr)
+{
+    const std::string& form = expr.head.value.sym_value;
+    if (expr.tail.size() != 2){
+        throw InterpreterSemanticError("Error: Incorrect use of '" + form + "'.");
+    }
+    std::shared_ptr<Sequence> sequence = std::make_shared<Sequence>();
+    sequence->function = evaluateFunction(expr.tail[0]);
+    Expression operand = evaluateExpression(expr.tail[1]);
+    if (form == "iterate"){
+        sequence->kind = Sequence::Iterate;
+        sequence->seed = operand;
+    }
+    else if (operand.head.type == SequenceType){
+        sequence->kind = Sequence::Map;
+        sequence->source = operand.head.value.shared<Sequence>();
+    }
+    else{
+        throw InterpreterSemanticError("Error: Second argument of 'map' is not a sequence.");
+    }
+    return sequenceExpression(sequence);
+}
+
+// (points ...), (polyline ...) or (polygon ...) with sequence arguments.
+// Elements are packed as they are pulled, never held as Expressions together.
+// The arguments are a copy: pulling elements reuses the argument buffers.
+Expression Interpreter::collectShape(Type type, std::vector<Atom> args)
+{
+    ShapeBuilder builder(type);
+    for (const auto& arg : args){
+        if (arg.type == SequenceType){
+            forEach(Expression(arg), [&builder](const Expression& element){
+                builder.add(element.head);
+            });
+        }
+        else{
+            builder.add(arg);
+        }
+    }
+    return builder.finish();
+}
+
+// Evaluates the function operand of map or iterate: a closure,
+// or a symbol naming a builtin procedure
+Expression Interpreter::evaluateFunction(const Expression& expr)
+{
+    if (expr.tail.empty() && expr.head.type == SymbolType && expr.frameSlot < 0 && expr.captureSlot < 0
+        && env.lookupProcedure(expr.head.value.sym_value) != nullptr){
+        return expr;
+    }
+    Expression function = evaluateExpression(expr);
+    if (function.head.type != LambdaType){
+        throw InterpreterSemanticError("Error: Symbol not found or not associated with a procedure.");
+    }
+    return function;
+}
+
+// Applies the function of a sequence to one element
+Expression Interpreter::applyFunction(const Expression& function, const Expression& argument)
+{
+    if (function.head.type == SymbolType){
+        Procedure procedure = env.lookupProcedure(function.head.value.sym_value);
+        if (procedure == nullptr){
+            throw InterpreterSemanticError("Error: Symbol not found or not associated with a procedure.");
+        }
+        std::vector<Atom>& args = atomBuffer();
+        args.assign(1, argument.head);
+        return env.applyProcedure(procedure, args);
+    }
+
+    // call the closure in a frame above the current one
+    const Closure& callee = *function.head.value.closure();
+    const LambdaInfo& lambda = *callee.lambda;
+    if (lambda.params != 1){
+        throw InterpreterSemanticError("Error: Incorrect number of arguments for lambda.");
+    }
+    const std::size_t callerTop = frames.size();
+    const std::size_t callerBase = frameBase;
+    const Closure * const caller = closure;
+    frames.resize(callerTop + lambda.frameSize);
+    frames[callerTop] = argument;
+    frameBase = callerTop;
+    closure = &callee;
+    Expression result;
+    try{
+        result = evaluateExpression(lambda.body);
+    }
+    catch (...){
+        frames.resize(callerTop);
+        frameBase = callerBase;
+        closure = caller;
+        throw;
+    }
+    frames.resize(callerTop);
+    frameBase = callerBase;
+    closure = caller;
+    return result;
+}
+
+// Pulls the elements of a sequence one at a time
+void Interpreter::forEach(const Expression& sequence, const std::function<void(const Expression&)>& visit)
+{
+    if (sequence.head.type != SequenceType){
+        throw InterpreterSemanticError("Error: Expression is not a sequence.");
+    }
+    SequenceApply apply = [this](const Expression& function, const Expression& argument){
+        return applyFunction(function, argument);
+    };
+    SequenceCursor cursor(*sequence.head.value.sequence());
+    Expression element;
+    while (cursor.next(element, apply)){
+        if (cancelled.load(std::memory_order_relaxed)){
+            throw InterpreterSemanticError("Error: Evaluation cancelled.");
+        }
+        visit(element);
+    }
+}
+
+void Interpreter::cancel()
+{
+    cancelled = true;
+}
+
+void Interpreter::clearCancel()
+{
+    cancelled = false;
+}
+
+// Evaluates the values of a let in the enclosing scope
+// and stores them in their frame slots
+void Interpreter::bindLet(const Expression& expr)
+{
+    if (expr.tail.size() != 2 || expr.tail[0].head.type != ListType){
+        throw InterpreterSemanticError("Error: Incorrect use of 'let'.");
+    }
+    const Tail& bindings = expr.tail[0].tail;
+    std::vector<Expression> values;
+    values.reserve(bindings.size());
+    for (const auto& binding : bindings){
+        if (binding.frameSlot < 0){
+            throw InterpreterSemanticError("Error: Incorrect use of 'let'.");
+        }
+        values.push_back(evaluateExpression(binding.tail[0]));
+    }
+    for (std::size_t i = 0; i < bindings.size(); ++i){
+        frames[frameBase + bindings[i].frameSlot] = std::move(values[i]);
+    }
+}
+
+// Evaluates a repeated pure subexpression once per evaluation.
+// The memoized value is reused only while the environment is unchanged.
+Expression Interpreter::evaluateCommon(const Expression& expr)
+{
+    CommonValue& memo = cseMemo[expr.cseSlot];
+    if (memo.evaluation == evaluation && memo.version == env.getVersion()){
+        return memo.value;
+    }
+    Expression value = applyCall(expr);
+    memo.value = value;
+    memo.evaluation = evaluation;
+    memo.version = env.getVersion();
+    return value;
+}
+
+// Calls a builtin whose arguments type inference has proven.
+// The unchecked variant is used only if the call site still resolves to the
+// builtin it was typed against; otherwise the regular checked path is taken.
+Expression Interpreter::applyProvenCall(const Expression& expr)
+{
+    std::vector<Atom>& args = atomBuffer();
+    args.clear();
+    for (const auto& e : expr.tail){
+        args.push_back(evaluateExpression(e).head);
+    }
+    Procedure procedure = lookupProcedure(expr);
+    if (procedure == expr.signature->checked){
+        return expr.signature->unchecked(args);
+    }
+    return env.applyProcedure(procedure, args);
 }
 
 // Reset environment to its default state
+// (the fresh Environment carries a new version, invalidating all caches)
 void Interpreter::resetEnvironment()
 {
     env = Environment();
@@ -4,13 +4,22 @@
 // system includes
 #include <string>
 #include <istream>
+#include <ostream>
+#include <cstdint>
 #include <vector>
+#include <deque>
+#include <functional>
+#include <atomic>
 
 
 // module includes
 #include "expression.hpp"
 #include "environment.hpp"
 #include "tokenize.hpp"
+#include "type_inference.hpp"
+#include "hash_consing.hpp"
+#include "pass_manager.hpp"
+#include "closure.hpp"
 
 // Interpreter has
 // Environment, which starts at a default
@@ -28,9 +37,88 @@ public:
   void resetEnvironment();
   bool isSymbolStringDefined(std::string variable);
 
+  // Runs the optimisation passes enabled by the pass options over the
+  // parsed AST; throws InterpreterSemanticError if it is ill-typed
+  void prepare();
+
+  void setPassOptions(const PassOptions & options);
+  void reportPassTimings(std::ostream & out) const;
+  const TypeInferenceStats& typeInferenceStats() const;
+
+  // Calls visit with each element of a sequence, generated on demand
+  void forEach(const Expression& sequence, const std::function<void(const Expression&)>& visit);
+
+  // Makes the running evaluation throw InterpreterSemanticError at its next
+  // safe point: each evaluation step and each element pulled from a sequence.
+  // Safe to call from any thread. Evaluations keep failing until clearCancel().
+  void cancel();
+  void clearCancel();
+
 protected:
+  const Expression& lookupVariable(const Expression& expr);
+  Procedure lookupProcedure(const Expression& expr);
+  Expression applyCall(const Expression& expr);
+  void evaluateArguments(const Expression& expr, std::vector<Atom>& args);
+  Expression applyProvenCall(const Expression& expr);
+  Expression evaluateCommon(const Expression& expr);
+  std::shared_ptr<const Closure> lookupClosure(const Expression& expr);
+  Expression makeClosure(const Expression& expr);
+  const Expression* enterClosure(const Closure& function, const Expression& expr, std::size_t first, std::size_t callerTop);
+  void bindLet(const Expression& expr);
+  Expression evaluateDefine(const Expression& expr);
+  Expression evaluateSet(const Expression& expr);
+  Expression evaluateWhile(const Expression& expr);
+  Expression evaluateFor(const Expression& expr);
+  Expression evaluateRepeat(const Expression& expr);
+  Expression makeSequence(const Expression& expr);
+  Expression collectShape(Type type, std::vector<Atom> args);
+  Expression evaluateFunction(const Expression& expr);
+  Expression applyFunction(const Expression& function, const Expression& argument);
+  std::vector<Atom>& atomBuffer();
+  std::vector<Expression>& expressionBuffer();
+
+  // C++ stack that nested evaluations may use; tail positions use none
+  static const std::size_t maxEvaluationStack = 4 * 1024 * 1024;
+  struct DepthGuard{
+    std::size_t& depth;
+    DepthGuard(std::size_t& d): depth(d) { ++depth; }
+    ~DepthGuard() { --depth; }
+  };
+
+  // Value of a common subexpression, valid for one evaluation
+  // while the environment keeps the same version
+  struct CommonValue{
+    unsigned long evaluation = 0;
+    unsigned long version = 0;
+    Expression value;
+  };
+
   Environment env;
   Expression ast;
+  VectorLiterals vectorLiterals; // numbers of the vector literals being parsed
+  PassManager passes;
+  bool optimized = false;
+  unsigned long passedVersion = 0; // environment version the passes last ran against
+  HashConsTable consTable;
+  std::vector<CommonValue> cseMemo;
+  unsigned long evaluation = 0;
+
+  // Frames of the closures being called, contiguous, the top level first
+  std::vector<Expression> frames;
+  std::size_t frameBase = 0;
+  const Closure * closure = nullptr; // closure being called, nullptr at the top level
+  std::size_t depth = 0;              // nesting of evaluateExpression calls
+  std::uintptr_t stackBase = 0;       // stack address of the outermost one
+  std::size_t loopDepth = 0;          // nesting of loops being evaluated
+  std::atomic<bool> cancelled{false};
+
+  // Argument buffers reused by the calls of each evaluation depth
+  std::deque<std::vector<Atom>> atomBuffers;
+  std::deque<std::vector<Expression>> expressionBuffers;
+
+  // Results of draw inside loops, recorded if recordGraphics is set
+  // since the loop itself only returns its last value
+  bool recordGraphics = false;
   std::vector<Atom> graphics;
 };
 
@@ -5,6 +5,8 @@
 #include <QLayout>
 #include <fstream>
 #include <QDebug>
+#include <QCoreApplication>
+#include <QGraphicsItem>
 
 #include "message_widget.hpp"
 #include "canvas_widget.hpp"
@@ -16,11 +18,25 @@ MainWindow::MainWindow(QWidget * parent): MainWindow("", parent)
   // Nothing to be added
 }
 
+MainWindow::MainWindow(std::string filename, QWidget * parent): MainWindow(filename, PassOptions(), parent)
+{
+  // Nothing to be added
+}
+
 // Constructor to create the main window.
-MainWindow::MainWindow(std::string filename, QWidget * parent): QWidget(parent)
+MainWindow::MainWindow(std::string filename, const PassOptions & options, QWidget * parent): QWidget(parent)
 {
+    interp.setPassOptions(options);
+
+    // Evaluation runs on the worker, with room for the interpreter's
+    // evaluation stack whatever the platform's default thread stack
+    qRegisterMetaType<QList<QGraphicsItem*>>("QList<QGraphicsItem*>");
+    worker.setStackSize(8 * 1024 * 1024);
+    interp.moveToThread(&worker);
+    worker.start();
+
     // Create the widgets
-    MessageWidget* messageWidget = new MessageWidget(this);
+    messageWidget = new MessageWidget(this);
     CanvasWidget* canvasWidget = new CanvasWidget(this);
     REPLWidget* replWidget = new REPLWidget(this);
 
@@ -36,31 +52,69 @@ MainWindow::MainWindow(std::string filename, QWidget * parent): QWidget(parent)
     // Connect signals and slots
     connect(&interp, &QtInterpreter::info, messageWidget, &MessageWidget::info);
     connect(&interp, &QtInterpreter::error, messageWidget, &MessageWidget::error);
-    connect(replWidget, &REPLWidget::lineEntered, &interp, &QtInterpreter::parseAndEvaluate);
-    connect(&interp, &QtInterpreter::drawGraphic, canvasWidget, &CanvasWidget::addGraphic);
-    connect(&interp, &QtInterpreter::error, canvasWidget, &CanvasWidget::clearCanvas);
+    connect(replWidget, &REPLWidget::lineEntered, this, &MainWindow::evaluate);
+    connect(replWidget, &REPLWidget::cancelRequested, this, [this] { interp.cancelAll(); });
+    connect(&interp, &QtInterpreter::drawGraphicBatch, canvasWidget, &CanvasWidget::addGraphics);
+    connect(&interp, &QtInterpreter::layerStarted, canvasWidget, &CanvasWidget::beginLayer);
+    connect(&interp, &QtInterpreter::layerFinished, canvasWidget, &CanvasWidget::endLayer);
+    connect(&interp, &QtInterpreter::canvasCleared, canvasWidget, &CanvasWidget::clearCanvas);
 
 
 
+    // A saved scene is shown as it is, with no script to evaluate
+    const std::string sceneExtension = ".slscene";
+    bool scene = filename.size() > sceneExtension.size() &&
+                 filename.compare(filename.size() - sceneExtension.size(), sceneExtension.size(), sceneExtension) == 0;
+    if (scene)
+    {
+        if (!canvasWidget->loadScene(QString::fromStdString(filename)))
+        {
+            messageWidget->error("Error: Could not read scene file.");
+        }
+    }
     // If a filename is provided, try to preload the script
-    if (!filename.empty()) 
+    else if (!filename.empty()) 
     {
-        try {
-            std::ifstream ifs(filename);
-            if (ifs) 
-            {
-                std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
-                QString qContent = QString::fromStdString(content);
-                interp.parseAndEvaluate(qContent);
-            }
-            else 
-            {
-                messageWidget->error("Error: Could not open file for reading.");
-            }
+        std::ifstream ifs(filename);
+        if (ifs) 
+        {
+            std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+            // each form of the script is a layer of its own
+            lastEntry = interp.submit(QString::fromStdString(content), true);
         }
-        catch (InterpreterSemanticError& e) 
+        else 
         {
-            messageWidget->error(QString::fromStdString(e.what()));
+            messageWidget->error("Error: Could not open file for reading.");
         }
     }
 }
+
+MainWindow::~MainWindow()
+{
+    interp.cancelAll();
+    worker.quit();
+    worker.wait();
+}
+
+// Hands an entry to the worker, which stops any unfinished earlier entry.
+// The results arrive as queued signals, so the GUI thread never blocks.
+void MainWindow::evaluate(QString entry)
+{
+    lastEntry = interp.submit(entry);
+}
+
+bool MainWindow::waitForResults(int msecs)
+{
+    if (!interp.waitFor(lastEntry, msecs))
+    {
+        return false;
+    }
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::MetaCall);
+    messageWidget->flush();
+    return true;
+}
+
+void MainWindow::reportPassTimings(std::ostream & out) const
+{
+    interp.reportPassTimings(out);
+}
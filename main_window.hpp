@@ -1,12 +1,17 @@
 #ifndef MAIN_WINDOW_HPP
 #define MAIN_WINDOW_HPP
 
+#include <ostream>
 #include <string>
 
 #include <QWidget>
+#include <QThread>
+#include <QString>
 
 #include "qt_interpreter.hpp"
 
+class MessageWidget;
+
 class MainWindow: public QWidget{
   Q_OBJECT
 
@@ -14,10 +19,28 @@ public:
 
   MainWindow(QWidget * parent = nullptr);
   MainWindow(std::string filename, QWidget * parent = nullptr);
+  MainWindow(std::string filename, const PassOptions & options, QWidget * parent = nullptr);
+  ~MainWindow();
+
+  void reportPassTimings(std::ostream & out) const;
+
+  // For tests: waits up to msecs for every entry submitted so far, then
+  // delivers its queued results and shows the last message at once.
+  // Returns false on timeout. The window itself never waits.
+  bool waitForResults(int msecs = 5000);
+
+private slots:
+
+  void evaluate(QString entry);
 
 private:
 
+  // The interpreter evaluates on the worker thread, declared first so that it
+  // outlives the interpreter. Its results arrive as queued signals.
+  QThread worker;
   QtInterpreter interp;
+  unsigned long lastEntry = 0;
+  MessageWidget * messageWidget;
 };
 
 
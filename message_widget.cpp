@@ -5,10 +5,10 @@
 #include <QLineEdit>
 #include <QDebug>
 
-MessageWidget::MessageWidget(QWidget* parent) : QWidget(parent)
+MessageWidget::MessageWidget(QWidget* parent) : QWidget(parent), ring(historySize)
 {
     // Initialize the QLineEdit to display messages
-    QLineEdit* messageEdit = new QLineEdit(this);
+    messageEdit = new QLineEdit(this);
     messageEdit->setObjectName("messageEdit"); 
     messageEdit->setReadOnly(true); 
 
@@ -19,46 +19,119 @@ MessageWidget::MessageWidget(QWidget* parent) : QWidget(parent)
     layout->addWidget(messageLabel);
     layout->addWidget(messageEdit);
     setLayout(layout);
+
+    // Info is black on white; errors are selected and highlighted in red
+    infoPalette = messageEdit->palette();
+    infoPalette.setColor(QPalette::WindowText, Qt::black);
+    infoPalette.setColor(QPalette::Window, Qt::white);
+    infoPalette.setColor(QPalette::Highlight, Qt::transparent);
+    errorPalette = infoPalette;
+    errorPalette.setColor(QPalette::Highlight, Qt::red);
+    errorPalette.setColor(QPalette::HighlightedText, Qt::black);
+
+    refresh.setSingleShot(true);
+    connect(&refresh, &QTimer::timeout, this, &MessageWidget::flush);
 }
 
 // Functionto display info regarding the procedure.
 void MessageWidget::info(QString message) 
 {
-    QLineEdit* messageEdit = findChild<QLineEdit*>("messageEdit");
-
-    messageEdit->clear();
-
-    // Clear any error formatting
-    QPalette palette = messageEdit->palette();
-    palette.setColor(QPalette::WindowText, Qt::black);
-    palette.setColor(QPalette::Window, Qt::white);
-    palette.setColor(QPalette::Highlight, Qt::transparent);
-    messageEdit->setPalette(palette);
-    messageEdit->setText(message);
-    messageEdit->deselect(); 
+    post(message, Info);
 }
 
 // Function to display errors
 void MessageWidget::error(QString message) 
 {
-    QLineEdit* messageEdit = findChild<QLineEdit*>("messageEdit");
-
-    messageEdit->clear();
-
-    // Set the text to black on a white background and highlight in red
-    QPalette palette = messageEdit->palette();
-    palette.setColor(QPalette::WindowText, Qt::black);
-    palette.setColor(QPalette::Window, Qt::white);
-    palette.setColor(QPalette::Highlight, Qt::red);
-    palette.setColor(QPalette::HighlightedText, Qt::black);
-    messageEdit->setPalette(palette);
-    messageEdit->setText(message);
-    messageEdit->selectAll(); 
+    post(message, Error);
 }
 
 // Function to clear any messages. 
 void MessageWidget::clear() 
 {
-    QLineEdit* messageEdit = findChild<QLineEdit*>("messageEdit");
+    refresh.stop();
+    pending = false;
     messageEdit->clear();
 }
+
+void MessageWidget::flush()
+{
+    if (pending)
+    {
+        refresh.stop();
+        display(ring[(next + historySize - 1) % historySize]);
+    }
+}
+
+// Records a message and shows it, now or at the next refresh
+void MessageWidget::post(const QString& text, Severity severity)
+{
+    if (stored == historySize)
+    {
+        ++droppedCount;
+    }
+    else
+    {
+        ++stored;
+    }
+    ring[next] = Message{text, severity};
+    next = (next + 1) % historySize;
+
+    if (pending)
+    {
+        ++coalescedCount;
+    }
+    bool due = !sinceRefresh.isValid() || sinceRefresh.elapsed() >= refreshInterval;
+    if (due || !styled || severity != shownSeverity)
+    {
+        refresh.stop();
+        display(ring[(next + historySize - 1) % historySize]);
+        return;
+    }
+    pending = true;
+    if (!refresh.isActive())
+    {
+        refresh.start(refreshInterval - static_cast<int>(sinceRefresh.elapsed()));
+    }
+}
+
+// Puts a message on the display, changing the palette only with the severity
+void MessageWidget::display(const Message& message)
+{
+    if (!styled || message.severity != shownSeverity)
+    {
+        messageEdit->setPalette(message.severity == Error ? errorPalette : infoPalette);
+        shownSeverity = message.severity;
+        styled = true;
+    }
+    messageEdit->setText(message.text);
+    if (message.severity == Error)
+    {
+        messageEdit->selectAll();
+    }
+    else
+    {
+        messageEdit->deselect();
+    }
+    pending = false;
+    sinceRefresh.start();
+}
+
+QList<MessageWidget::Message> MessageWidget::history() const
+{
+    QList<Message> messages;
+    for (int i = 0; i < stored; ++i)
+    {
+        messages.append(ring[(next + historySize - stored + i) % historySize]);
+    }
+    return messages;
+}
+
+unsigned long MessageWidget::dropped() const
+{
+    return droppedCount;
+}
+
+unsigned long MessageWidget::coalesced() const
+{
+    return coalescedCount;
+}
@@ -1,7 +1,12 @@
 #ifndef MESSAGE_WINDOW_HPP
 #define MESSAGE_WINDOW_HPP
 
+#include <QElapsedTimer>
+#include <QList>
+#include <QPalette>
 #include <QString>
+#include <QTimer>
+#include <QVector>
 #include <QWidget>
 
 class QLineEdit;
@@ -12,6 +17,23 @@ class MessageWidget : public QWidget {
 public:
   MessageWidget(QWidget *parent = nullptr);
 
+  enum Severity { Info, Error };
+
+  struct Message {
+    QString text;
+    Severity severity;
+  };
+
+  // The most recent messages, oldest first, at most historySize of them
+  QList<Message> history() const;
+
+  // Messages that fell out of the history, and messages replaced by a
+  // later one before they were shown
+  unsigned long dropped() const;
+  unsigned long coalesced() const;
+
+  static const int historySize = 256;
+
 public slots:
 
   void info(QString message);
@@ -19,6 +41,35 @@ public slots:
   void error(QString message);
 
   void clear();
+
+  // Shows the latest message now if it is waiting for the next refresh
+  void flush();
+
+private:
+
+  void post(const QString &text, Severity severity);
+  void display(const Message &message);
+
+  QLineEdit *messageEdit;
+  QPalette infoPalette;
+  QPalette errorPalette;
+  bool styled = false;
+  Severity shownSeverity = Info;
+
+  // history as a ring: next is where the following message goes
+  QVector<Message> ring;
+  int next = 0;
+  int stored = 0;
+  unsigned long droppedCount = 0;
+  unsigned long coalescedCount = 0;
+
+  // The display changes at most once per refresh: a message arriving
+  // sooner waits on the timer, replacing any other still waiting. A change
+  // of severity is shown at once, so errors are never held back.
+  static const int refreshInterval = 16; // milliseconds, a frame at 60 fps
+  QElapsedTimer sinceRefresh;
+  QTimer refresh;
+  bool pending = false;
 };
 
 #endif
@@ -0,0 +1,851 @@
+#include "number_vector.hpp"
+
+// system includes
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+
+// module includes
+#include "interpreter_semantic_error.hpp"
+#include "fast_math.hpp"
+#include "simd.hpp"
+#include "thread_pool.hpp"
+
+SimdLevel detectSimdLevel()
+{
+#if defined(SLISP_X86_SIMD) && defined(__GNUC__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#elif defined(SLISP_X86_SIMD) && defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+  __cpuidex(info, 7, 0);
+  return osSavesAvx && (info[1] & (1 << 5)) != 0 ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#else
+  return SimdLevel::Scalar;
+#endif
+}
+
+static SimdLevel & currentLevel()
+{
+  static SimdLevel level = detectSimdLevel();
+  return level;
+}
+
+SimdLevel simdLevel()
+{
+  return currentLevel();
+}
+
+void setSimdLevel(SimdLevel level)
+{
+  currentLevel() = std::min(level, detectSimdLevel());
+}
+
+// Operations with SIMD kernels. Each has a scalar form, used for the
+// elements left over after the last full register, and SSE2 and AVX2 forms.
+struct AddOp{
+  static Number scalar(Number a, Number b) { return a + b; }
+#ifdef SLISP_X86_SIMD
+  static __m128d sse2(__m128d a, __m128d b) { return _mm_add_pd(a, b); }
+  TARGET_AVX2 static __m256d avx2(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+#endif
+};
+
+struct SubtractOp{
+  static Number scalar(Number a, Number b) { return a - b; }
+#ifdef SLISP_X86_SIMD
+  static __m128d sse2(__m128d a, __m128d b) { return _mm_sub_pd(a, b); }
+  TARGET_AVX2 static __m256d avx2(__m256d a, __m256d b) { return _mm256_sub_pd(a, b); }
+#endif
+};
+
+struct MultiplyOp{
+  static Number scalar(Number a, Number b) { return a * b; }
+#ifdef SLISP_X86_SIMD
+  static __m128d sse2(__m128d a, __m128d b) { return _mm_mul_pd(a, b); }
+  TARGET_AVX2 static __m256d avx2(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+#endif
+};
+
+struct DivideOp{
+  static Number scalar(Number a, Number b) { return a / b; }
+#ifdef SLISP_X86_SIMD
+  static __m128d sse2(__m128d a, __m128d b) { return _mm_div_pd(a, b); }
+  TARGET_AVX2 static __m256d avx2(__m256d a, __m256d b) { return _mm256_div_pd(a, b); }
+#endif
+};
+
+struct LessOp{
+  static bool scalar(Number a, Number b) { return a < b; }
+#ifdef SLISP_X86_SIMD
+  static __m128d sse2(__m128d a, __m128d b) { return _mm_cmplt_pd(a, b); }
+  TARGET_AVX2 static __m256d avx2(__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+#endif
+};
+
+struct LessEqualOp{
+  static bool scalar(Number a, Number b) { return a <= b; }
+#ifdef SLISP_X86_SIMD
+  static __m128d sse2(__m128d a, __m128d b) { return _mm_cmple_pd(a, b); }
+  TARGET_AVX2 static __m256d avx2(__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+#endif
+};
+
+struct GreaterOp{
+  static bool scalar(Number a, Number b) { return a > b; }
+#ifdef SLISP_X86_SIMD
+  static __m128d sse2(__m128d a, __m128d b) { return _mm_cmpgt_pd(a, b); }
+  TARGET_AVX2 static __m256d avx2(__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+#endif
+};
+
+struct GreaterEqualOp{
+  static bool scalar(Number a, Number b) { return a >= b; }
+#ifdef SLISP_X86_SIMD
+  static __m128d sse2(__m128d a, __m128d b) { return _mm_cmpge_pd(a, b); }
+  TARGET_AVX2 static __m256d avx2(__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+#endif
+};
+
+struct EqualOp{
+  static bool scalar(Number a, Number b) { return a == b; }
+#ifdef SLISP_X86_SIMD
+  static __m128d sse2(__m128d a, __m128d b) { return _mm_cmpeq_pd(a, b); }
+  TARGET_AVX2 static __m256d avx2(__m256d a, __m256d b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+#endif
+};
+
+// Kernels computing out[i] = Op(a[i], b[i]) for i < n.
+// A scalar operand (ScalarA, ScalarB) is read from a[0] or b[0] for every i.
+// out may be the same array as a or b.
+typedef void (*ArithmeticKernel)(const Number * a, const Number * b, Number * out, std::size_t n);
+typedef void (*CompareKernel)(const Number * a, const Number * b, unsigned char * out, std::size_t n);
+
+template <class Op, bool ScalarA, bool ScalarB>
+static void arithmeticScalar(const Number * a, const Number * b, Number * out, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    out[i] = Op::scalar(a[ScalarA ? 0 : i], b[ScalarB ? 0 : i]);
+  }
+}
+
+template <class Op, bool ScalarA, bool ScalarB>
+static void compareScalar(const Number * a, const Number * b, unsigned char * out, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    out[i] = Op::scalar(a[ScalarA ? 0 : i], b[ScalarB ? 0 : i]);
+  }
+}
+
+#ifdef SLISP_X86_SIMD
+template <class Op, bool ScalarA, bool ScalarB>
+static void arithmeticSSE2(const Number * a, const Number * b, Number * out, std::size_t n)
+{
+  std::size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+  {
+    __m128d x = ScalarA ? _mm_set1_pd(a[0]) : _mm_loadu_pd(a + i);
+    __m128d y = ScalarB ? _mm_set1_pd(b[0]) : _mm_loadu_pd(b + i);
+    _mm_storeu_pd(out + i, Op::sse2(x, y));
+  }
+  for (; i < n; ++i)
+  {
+    out[i] = Op::scalar(a[ScalarA ? 0 : i], b[ScalarB ? 0 : i]);
+  }
+}
+
+template <class Op, bool ScalarA, bool ScalarB>
+TARGET_AVX2 static void arithmeticAVX2(const Number * a, const Number * b, Number * out, std::size_t n)
+{
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256d x = ScalarA ? _mm256_set1_pd(a[0]) : _mm256_loadu_pd(a + i);
+    __m256d y = ScalarB ? _mm256_set1_pd(b[0]) : _mm256_loadu_pd(b + i);
+    _mm256_storeu_pd(out + i, Op::avx2(x, y));
+  }
+  for (; i < n; ++i)
+  {
+    out[i] = Op::scalar(a[ScalarA ? 0 : i], b[ScalarB ? 0 : i]);
+  }
+}
+
+// comparisons yield all-ones lanes for true, packed to one bit per lane by movemask
+template <class Op, bool ScalarA, bool ScalarB>
+static void compareSSE2(const Number * a, const Number * b, unsigned char * out, std::size_t n)
+{
+  std::size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+  {
+    __m128d x = ScalarA ? _mm_set1_pd(a[0]) : _mm_loadu_pd(a + i);
+    __m128d y = ScalarB ? _mm_set1_pd(b[0]) : _mm_loadu_pd(b + i);
+    int bits = _mm_movemask_pd(Op::sse2(x, y));
+    out[i] = bits & 1;
+    out[i + 1] = (bits >> 1) & 1;
+  }
+  for (; i < n; ++i)
+  {
+    out[i] = Op::scalar(a[ScalarA ? 0 : i], b[ScalarB ? 0 : i]);
+  }
+}
+
+template <class Op, bool ScalarA, bool ScalarB>
+TARGET_AVX2 static void compareAVX2(const Number * a, const Number * b, unsigned char * out, std::size_t n)
+{
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256d x = ScalarA ? _mm256_set1_pd(a[0]) : _mm256_loadu_pd(a + i);
+    __m256d y = ScalarB ? _mm256_set1_pd(b[0]) : _mm256_loadu_pd(b + i);
+    int bits = _mm256_movemask_pd(Op::avx2(x, y));
+    out[i] = bits & 1;
+    out[i + 1] = (bits >> 1) & 1;
+    out[i + 2] = (bits >> 2) & 1;
+    out[i + 3] = (bits >> 3) & 1;
+  }
+  for (; i < n; ++i)
+  {
+    out[i] = Op::scalar(a[ScalarA ? 0 : i], b[ScalarB ? 0 : i]);
+  }
+}
+#endif
+
+template <class Op, bool ScalarA, bool ScalarB>
+static ArithmeticKernel arithmeticKernel()
+{
+#ifdef SLISP_X86_SIMD
+  switch (currentLevel())
+  {
+  case SimdLevel::AVX2: return arithmeticAVX2<Op, ScalarA, ScalarB>;
+  case SimdLevel::SSE2: return arithmeticSSE2<Op, ScalarA, ScalarB>;
+  default: break;
+  }
+#endif
+  return arithmeticScalar<Op, ScalarA, ScalarB>;
+}
+
+template <class Op, bool ScalarA, bool ScalarB>
+static CompareKernel compareKernel()
+{
+#ifdef SLISP_X86_SIMD
+  switch (currentLevel())
+  {
+  case SimdLevel::AVX2: return compareAVX2<Op, ScalarA, ScalarB>;
+  case SimdLevel::SSE2: return compareSSE2<Op, ScalarA, ScalarB>;
+  default: break;
+  }
+#endif
+  return compareScalar<Op, ScalarA, ScalarB>;
+}
+
+// An argument of a broadcast: n packed values, or one value repeated
+struct Operand{
+  const Number * numbers;
+  const unsigned char * booleans;
+  bool scalar;
+  unsigned char boolean;
+};
+
+template <class Op>
+static void arithmetic(const Operand & a, const Operand & b, Number * out, std::size_t n)
+{
+  if (a.scalar && b.scalar)
+  {
+    std::fill(out, out + n, Op::scalar(a.numbers[0], b.numbers[0]));
+  }
+  else if (a.scalar)
+  {
+    arithmeticKernel<Op, true, false>()(a.numbers, b.numbers, out, n);
+  }
+  else if (b.scalar)
+  {
+    arithmeticKernel<Op, false, true>()(a.numbers, b.numbers, out, n);
+  }
+  else
+  {
+    arithmeticKernel<Op, false, false>()(a.numbers, b.numbers, out, n);
+  }
+}
+
+template <class Op>
+static void compare(const Operand & a, const Operand & b, unsigned char * out, std::size_t n)
+{
+  if (a.scalar && b.scalar)
+  {
+    std::fill(out, out + n, Op::scalar(a.numbers[0], b.numbers[0]));
+  }
+  else if (a.scalar)
+  {
+    compareKernel<Op, true, false>()(a.numbers, b.numbers, out, n);
+  }
+  else if (b.scalar)
+  {
+    compareKernel<Op, false, true>()(a.numbers, b.numbers, out, n);
+  }
+  else
+  {
+    compareKernel<Op, false, false>()(a.numbers, b.numbers, out, n);
+  }
+}
+
+// Operations without SIMD kernels, applied by plain loops
+template <class Function>
+static void elementwise(const Operand & a, const Operand & b, Number * out, std::size_t n, Function f)
+{
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    out[i] = f(a.numbers[a.scalar ? 0 : i], b.numbers[b.scalar ? 0 : i]);
+  }
+}
+
+template <class Function>
+static void logical(const Operand & a, const Operand & b, unsigned char * out, std::size_t n, Function f)
+{
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    out[i] = f(a.scalar ? a.boolean : a.booleans[i], b.scalar ? b.boolean : b.booleans[i]);
+  }
+}
+
+// The n numbers of an operand, a repeated number copied into storage
+static const Number * packedNumbers(const Operand & a, std::vector<Number> & storage, std::size_t n)
+{
+  if (!a.scalar)
+  {
+    return a.numbers;
+  }
+  storage.assign(n, a.numbers[0]);
+  return storage.data();
+}
+
+// Name, arity and element type of each operation, in the order of Elementwise
+struct Operation{
+  const char * name;
+  std::size_t minArgs;
+  std::size_t maxArgs;
+  bool logical;
+};
+
+static const Operation operations[] = {
+  {"addition", 2, SIZE_MAX, false},
+  {"subtraction", 1, 2, false},
+  {"multiplication", 2, SIZE_MAX, false},
+  {"division", 2, 2, false},
+  {"pow", 2, 2, false},
+  {"arctan", 2, 2, false},
+  {"sin", 1, 1, false},
+  {"cos", 1, 1, false},
+  {"log10", 1, 1, false},
+  {"<", 2, 2, false},
+  {"<=", 2, 2, false},
+  {">", 2, 2, false},
+  {">=", 2, 2, false},
+  {"=", 2, 2, false},
+  {"not", 1, 1, true},
+  {"and", 2, SIZE_MAX, true},
+  {"or", 2, SIZE_MAX, true},
+};
+
+bool hasPackedArgument(const std::vector<Atom> & args)
+{
+  for (const auto & arg : args)
+  {
+    if (arg.type == VectorType || arg.type == MaskType)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static Operand operand(const Atom & arg)
+{
+  Operand result = {nullptr, nullptr, true, 0};
+  switch (arg.type)
+  {
+  case NumberType:
+    result.numbers = &arg.value.num_value;
+    break;
+  case BooleanType:
+    result.boolean = arg.value.bool_value;
+    break;
+  case VectorType:
+    result.numbers = arg.value.vector()->values.data();
+    result.scalar = false;
+    break;
+  case MaskType:
+    result.booleans = arg.value.mask()->values.data();
+    result.scalar = false;
+    break;
+  default:
+    break;
+  }
+  return result;
+}
+
+static std::size_t packedSize(const Atom & arg)
+{
+  return arg.type == VectorType ? arg.value.vector()->values.size() : arg.value.mask()->values.size();
+}
+
+Expression broadcast(Elementwise op, const std::vector<Atom> & args)
+{
+  const Operation & operation = operations[static_cast<int>(op)];
+  const std::string name = operation.name;
+  if (args.size() < operation.minArgs || args.size() > operation.maxArgs)
+  {
+    throw InterpreterSemanticError("Error: Invalid number of arguments for " + name + ".");
+  }
+
+  // all vectors and masks must have the same length n
+  Type scalarType = operation.logical ? BooleanType : NumberType;
+  Type packedType = operation.logical ? MaskType : VectorType;
+  std::size_t n = 0;
+  bool sized = false;
+  for (const auto & arg : args)
+  {
+    if (arg.type != scalarType && arg.type != packedType)
+    {
+      throw InterpreterSemanticError("Error: Invalid arguments for " + name + ".");
+    }
+    if (arg.type == packedType)
+    {
+      if (sized && packedSize(arg) != n)
+      {
+        throw InterpreterSemanticError("Error: Vectors of different lengths in " + name + ".");
+      }
+      n = packedSize(arg);
+      sized = true;
+    }
+  }
+
+  if (operation.logical)
+  {
+    std::vector<unsigned char> out(n);
+    Operand a = operand(args[0]);
+    if (op == Elementwise::Not)
+    {
+      logical(a, a, out.data(), n, [](unsigned char x, unsigned char) { return !x; });
+      return maskExpression(std::move(out));
+    }
+    // later arguments fold into the result in place
+    for (std::size_t i = 1; i < args.size(); ++i)
+    {
+      Operand b = operand(args[i]);
+      if (op == Elementwise::And)
+      {
+        logical(a, b, out.data(), n, [](unsigned char x, unsigned char y) { return x && y; });
+      }
+      else
+      {
+        logical(a, b, out.data(), n, [](unsigned char x, unsigned char y) { return x || y; });
+      }
+      a = Operand{nullptr, out.data(), false, 0};
+    }
+    return maskExpression(std::move(out));
+  }
+
+  Operand a = operand(args[0]);
+  Operand b = args.size() > 1 ? operand(args[1]) : a;
+  switch (op)
+  {
+  case Elementwise::Less:
+  case Elementwise::LessEqual:
+  case Elementwise::Greater:
+  case Elementwise::GreaterEqual:
+  case Elementwise::Equal:
+    {
+      std::vector<unsigned char> out(n);
+      switch (op)
+      {
+      case Elementwise::Less: compare<LessOp>(a, b, out.data(), n); break;
+      case Elementwise::LessEqual: compare<LessEqualOp>(a, b, out.data(), n); break;
+      case Elementwise::Greater: compare<GreaterOp>(a, b, out.data(), n); break;
+      case Elementwise::GreaterEqual: compare<GreaterEqualOp>(a, b, out.data(), n); break;
+      default: compare<EqualOp>(a, b, out.data(), n); break;
+      }
+      return maskExpression(std::move(out));
+    }
+  default:
+    break;
+  }
+
+  std::vector<Number> out(n);
+  const Number zero = 0;
+  switch (op)
+  {
+  case Elementwise::Subtract:
+    if (args.size() == 1)
+    {
+      arithmetic<SubtractOp>(Operand{&zero, nullptr, true, 0}, a, out.data(), n);
+    }
+    else
+    {
+      arithmetic<SubtractOp>(a, b, out.data(), n);
+    }
+    break;
+  case Elementwise::Divide:
+    if (b.scalar ? b.numbers[0] == 0 : std::find(b.numbers, b.numbers + n, 0.0) != b.numbers + n)
+    {
+      throw InterpreterSemanticError("Error: Invalid arguments for division");
+    }
+    arithmetic<DivideOp>(a, b, out.data(), n);
+    break;
+  case Elementwise::Pow:
+    elementwise(a, b, out.data(), n, [](Number x, Number y) { return std::pow(x, y); });
+    break;
+  case Elementwise::Arctan:
+    if (fastMath())
+    {
+      std::vector<Number> ys, xs;
+      fastAtan2(packedNumbers(a, ys, n), packedNumbers(b, xs, n), out.data(), n);
+      break;
+    }
+    elementwise(a, b, out.data(), n, [](Number x, Number y) { return std::atan2(x, y); });
+    break;
+  case Elementwise::Sin:
+    if (fastMath())
+    {
+      fastSin(a.numbers, out.data(), n);
+      break;
+    }
+    elementwise(a, a, out.data(), n, [](Number x, Number) { return std::sin(x); });
+    break;
+  case Elementwise::Cos:
+    if (fastMath())
+    {
+      fastCos(a.numbers, out.data(), n);
+      break;
+    }
+    elementwise(a, a, out.data(), n, [](Number x, Number) { return std::cos(x); });
+    break;
+  case Elementwise::Log10:
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      if (a.numbers[i] <= 0)
+      {
+        throw InterpreterSemanticError("Error: Non-positive argument for log10");
+      }
+    }
+    elementwise(a, a, out.data(), n, [](Number x, Number) { return std::log10(x); });
+    break;
+  default:
+    // addition and multiplication fold later arguments into the result in place
+    for (std::size_t i = 1; i < args.size(); ++i)
+    {
+      Operand next = operand(args[i]);
+      if (op == Elementwise::Add)
+      {
+        arithmetic<AddOp>(a, next, out.data(), n);
+      }
+      else
+      {
+        arithmetic<MultiplyOp>(a, next, out.data(), n);
+      }
+      a = Operand{out.data(), nullptr, false, 0};
+    }
+    break;
+  }
+  return vectorExpression(std::move(out));
+}
+
+// Reduction kernels accumulate element i in lane i % 8 and then combine the
+// lanes in the fixed order of combineLanes. The SSE2 and AVX2 forms keep the
+// same lanes in their registers, so all forms give bit-identical results.
+static const std::size_t lanes = 8;
+
+struct SumReduction{
+  static Number identity() { return 0; }
+  static Number scalar(Number acc, Number a, Number) { return acc + a; }
+  static Number combine(Number a, Number b) { return a + b; }
+#ifdef SLISP_X86_SIMD
+  static __m128d sse2(__m128d acc, __m128d a, __m128d) { return _mm_add_pd(acc, a); }
+  TARGET_AVX2 static __m256d avx2(__m256d acc, __m256d a, __m256d) { return _mm256_add_pd(acc, a); }
+#endif
+};
+
+struct DotReduction{
+  static Number identity() { return 0; }
+  static Number scalar(Number acc, Number a, Number b) { return acc + a * b; }
+  static Number combine(Number a, Number b) { return a + b; }
+#ifdef SLISP_X86_SIMD
+  static __m128d sse2(__m128d acc, __m128d a, __m128d b) { return _mm_add_pd(acc, _mm_mul_pd(a, b)); }
+  TARGET_AVX2 static __m256d avx2(__m256d acc, __m256d a, __m256d b) { return _mm256_add_pd(acc, _mm256_mul_pd(a, b)); }
+#endif
+};
+
+struct MinReduction{
+  static Number identity() { return std::numeric_limits<Number>::infinity(); }
+  static Number scalar(Number acc, Number a, Number) { return a < acc ? a : acc; }
+  static Number combine(Number a, Number b) { return b < a ? b : a; }
+#ifdef SLISP_X86_SIMD
+  static __m128d sse2(__m128d acc, __m128d a, __m128d) { return _mm_min_pd(a, acc); }
+  TARGET_AVX2 static __m256d avx2(__m256d acc, __m256d a, __m256d) { return _mm256_min_pd(a, acc); }
+#endif
+};
+
+struct MaxReduction{
+  static Number identity() { return -std::numeric_limits<Number>::infinity(); }
+  static Number scalar(Number acc, Number a, Number) { return a > acc ? a : acc; }
+  static Number combine(Number a, Number b) { return b > a ? b : a; }
+#ifdef SLISP_X86_SIMD
+  static __m128d sse2(__m128d acc, __m128d a, __m128d) { return _mm_max_pd(a, acc); }
+  TARGET_AVX2 static __m256d avx2(__m256d acc, __m256d a, __m256d) { return _mm256_max_pd(a, acc); }
+#endif
+};
+
+template <class Op>
+static Number combineLanes(const Number * lane)
+{
+  return Op::combine(Op::combine(Op::combine(lane[0], lane[1]), Op::combine(lane[2], lane[3])),
+                     Op::combine(Op::combine(lane[4], lane[5]), Op::combine(lane[6], lane[7])));
+}
+
+// b is only read by Dot
+typedef Number (*ReductionKernel)(const Number * a, const Number * b, std::size_t n);
+
+template <class Op>
+static Number reduceScalar(const Number * a, const Number * b, std::size_t n)
+{
+  Number lane[lanes];
+  std::fill(lane, lane + lanes, Op::identity());
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    lane[i % lanes] = Op::scalar(lane[i % lanes], a[i], b[i]);
+  }
+  return combineLanes<Op>(lane);
+}
+
+#ifdef SLISP_X86_SIMD
+template <class Op>
+static Number reduceSSE2(const Number * a, const Number * b, std::size_t n)
+{
+  __m128d acc[4];
+  for (auto & r : acc)
+  {
+    r = _mm_set1_pd(Op::identity());
+  }
+  std::size_t i = 0;
+  for (; i + lanes <= n; i += lanes)
+  {
+    for (std::size_t r = 0; r < 4; ++r)
+    {
+      acc[r] = Op::sse2(acc[r], _mm_loadu_pd(a + i + 2 * r), _mm_loadu_pd(b + i + 2 * r));
+    }
+  }
+  Number lane[lanes];
+  for (std::size_t r = 0; r < 4; ++r)
+  {
+    _mm_storeu_pd(lane + 2 * r, acc[r]);
+  }
+  for (; i < n; ++i)
+  {
+    lane[i % lanes] = Op::scalar(lane[i % lanes], a[i], b[i]);
+  }
+  return combineLanes<Op>(lane);
+}
+
+template <class Op>
+TARGET_AVX2 static Number reduceAVX2(const Number * a, const Number * b, std::size_t n)
+{
+  __m256d low = _mm256_set1_pd(Op::identity());
+  __m256d high = low;
+  std::size_t i = 0;
+  for (; i + lanes <= n; i += lanes)
+  {
+    low = Op::avx2(low, _mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));
+    high = Op::avx2(high, _mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));
+  }
+  Number lane[lanes];
+  _mm256_storeu_pd(lane, low);
+  _mm256_storeu_pd(lane + 4, high);
+  for (; i < n; ++i)
+  {
+    lane[i % lanes] = Op::scalar(lane[i % lanes], a[i], b[i]);
+  }
+  return combineLanes<Op>(lane);
+}
+#endif
+
+template <class Op>
+static ReductionKernel reductionKernel()
+{
+#ifdef SLISP_X86_SIMD
+  switch (currentLevel())
+  {
+  case SimdLevel::AVX2: return reduceAVX2<Op>;
+  case SimdLevel::SSE2: return reduceSSE2<Op>;
+  default: break;
+  }
+#endif
+  return reduceScalar<Op>;
+}
+
+// Chunks are reduced independently; inputs of fewer elements than the
+// threshold stay on the calling thread
+static const std::size_t chunkSize = 1 << 16;
+static const std::size_t parallelThreshold = 1 << 18;
+
+static std::atomic<bool> & parallelReductions()
+{
+  static std::atomic<bool> parallel(true);
+  return parallel;
+}
+
+void setParallelReductions(bool parallel)
+{
+  parallelReductions() = parallel;
+}
+
+template <class Op>
+static Number pairwise(const Number * values, std::size_t n)
+{
+  if (n == 1)
+  {
+    return values[0];
+  }
+  return Op::combine(pairwise<Op>(values, n / 2), pairwise<Op>(values + n / 2, n - n / 2));
+}
+
+template <class Op>
+static Number chunkedReduce(const Number * a, const Number * b, std::size_t n)
+{
+  if (n == 0)
+  {
+    return Op::identity();
+  }
+  ReductionKernel kernel = reductionKernel<Op>();
+  std::size_t chunks = (n + chunkSize - 1) / chunkSize;
+  std::vector<Number> partial(chunks);
+  auto reduceChunk = [&](std::size_t c)
+  {
+    std::size_t begin = c * chunkSize;
+    partial[c] = kernel(a + begin, b + begin, std::min(chunkSize, n - begin));
+  };
+  if (n >= parallelThreshold && parallelReductions())
+  {
+    ThreadPool::instance().run(chunks, reduceChunk);
+  }
+  else
+  {
+    for (std::size_t c = 0; c < chunks; ++c)
+    {
+      reduceChunk(c);
+    }
+  }
+  return pairwise<Op>(partial.data(), chunks);
+}
+
+static const char * reductionName(Reduction op)
+{
+  switch (op)
+  {
+  case Reduction::Sum: return "sum";
+  case Reduction::Min: return "min";
+  case Reduction::Max: return "max";
+  case Reduction::Mean: return "mean";
+  default: return "dot";
+  }
+}
+
+Expression reduce(Reduction op, const std::vector<Atom> & args)
+{
+  const std::string name = reductionName(op);
+  if (op == Reduction::Dot)
+  {
+    if (args.size() != 2 || args[0].type != VectorType || args[1].type != VectorType)
+    {
+      throw InterpreterSemanticError("Error: Invalid arguments for dot, expected two vectors.");
+    }
+    const std::vector<Number> & a = args[0].value.vector()->values;
+    const std::vector<Number> & b = args[1].value.vector()->values;
+    if (a.size() != b.size())
+    {
+      throw InterpreterSemanticError("Error: Vectors of different lengths in dot.");
+    }
+    return Expression(chunkedReduce<DotReduction>(a.data(), b.data(), a.size()));
+  }
+
+  if (args.empty())
+  {
+    throw InterpreterSemanticError("Error: Invalid number of arguments for " + name + ".");
+  }
+  for (const auto & arg : args)
+  {
+    if (arg.type != NumberType && arg.type != VectorType)
+    {
+      throw InterpreterSemanticError("Error: Invalid arguments for " + name + ", expected numbers or vectors.");
+    }
+  }
+
+  // a single vector is reduced in place, anything else gathered first
+  std::vector<Number> gathered;
+  const Number * data = nullptr;
+  std::size_t n = 0;
+  if (args.size() == 1 && args[0].type == VectorType)
+  {
+    data = args[0].value.vector()->values.data();
+    n = args[0].value.vector()->values.size();
+  }
+  else
+  {
+    for (const auto & arg : args)
+    {
+      if (arg.type == NumberType)
+      {
+        gathered.push_back(arg.value.num_value);
+      }
+      else
+      {
+        gathered.insert(gathered.end(), arg.value.vector()->values.begin(), arg.value.vector()->values.end());
+      }
+    }
+    data = gathered.data();
+    n = gathered.size();
+  }
+  if (n == 0 && op != Reduction::Sum)
+  {
+    throw InterpreterSemanticError("Error: " + name + " of no numbers.");
+  }
+
+  switch (op)
+  {
+  case Reduction::Min:
+    return Expression(chunkedReduce<MinReduction>(data, data, n));
+  case Reduction::Max:
+    return Expression(chunkedReduce<MaxReduction>(data, data, n));
+  case Reduction::Mean:
+    return Expression(chunkedReduce<SumReduction>(data, data, n) / n);
+  default:
+    return Expression(chunkedReduce<SumReduction>(data, data, n));
+  }
+}
+
+Expression vectorExpression(std::vector<Number> values)
+{
+  std::shared_ptr<NumberVector> vector = std::make_shared<NumberVector>();
+  vector->values = std::move(values);
+  Atom atom{};
+  atom.type = VectorType;
+  atom.value.object = vector;
+  return Expression(atom);
+}
+
+Expression maskExpression(std::vector<unsigned char> values)
+{
+  std::shared_ptr<BooleanMask> mask = std::make_shared<BooleanMask>();
+  mask->values = std::move(values);
+  Atom atom{};
+  atom.type = MaskType;
+  atom.value.object = mask;
+  return Expression(atom);
+}
@@ -0,0 +1,66 @@
+#ifndef NUMBER_VECTOR_HPP
+#define NUMBER_VECTOR_HPP
+
+// system includes
+#include <cstddef>
+#include <vector>
+
+// module includes
+#include "expression.hpp"
+
+// A NumberVector stores numbers contiguously, 8 bytes each rather than one
+// Expression per number. The numeric builtins apply to vectors elementwise.
+struct NumberVector{
+  std::vector<Number> values;
+};
+
+// A BooleanMask is the packed result of comparing vectors, one byte (0 or 1)
+// per element. The logical builtins apply to masks elementwise.
+struct BooleanMask{
+  std::vector<unsigned char> values;
+};
+
+// Elementwise operations of the builtins that broadcast over vectors
+enum class Elementwise {Add, Subtract, Multiply, Divide, Pow, Arctan, Sin, Cos, Log10,
+                        Less, LessEqual, Greater, GreaterEqual, Equal, Not, And, Or};
+
+// true if any argument is a NumberVector or a BooleanMask
+bool hasPackedArgument(const std::vector<Atom> & args);
+
+// Applies an operation elementwise, broadcasting numbers over vectors and
+// booleans over masks. All vector arguments must have the same length.
+// Subtract with one argument negates. Arithmetic and comparisons run in SIMD
+// kernels, as do sin, cos and arctan in fast math mode (see fast_math.hpp),
+// the other operations in plain loops over the packed storage.
+// Throws InterpreterSemanticError on invalid arguments.
+Expression broadcast(Elementwise op, const std::vector<Atom> & args);
+
+// Reductions of all the numbers of their arguments, numbers and vectors alike.
+// Dot takes two vectors of the same length.
+enum class Reduction {Sum, Min, Max, Mean, Dot};
+
+// Reduces in chunks of a fixed size, in parallel on the thread pool for
+// large inputs, with SIMD kernels inside each chunk. Chunk results are
+// combined pairwise in a fixed order, so the result does not depend on the
+// number of threads or the SIMD level. Throws InterpreterSemanticError on
+// invalid arguments and for min, max and mean of no numbers.
+Expression reduce(Reduction op, const std::vector<Atom> & args);
+
+// Lets reductions run on the thread pool (the default) or on the calling thread only
+void setParallelReductions(bool parallel);
+
+Expression vectorExpression(std::vector<Number> values);
+Expression maskExpression(std::vector<unsigned char> values);
+
+// Instruction sets the kernels may use, detected at run time
+enum class SimdLevel {Scalar, SSE2, AVX2};
+
+// The best level the processor supports
+SimdLevel detectSimdLevel();
+
+// The level the kernels use, initially the detected one. Setting a level
+// above the detected one selects the detected one.
+SimdLevel simdLevel();
+void setSimdLevel(SimdLevel level);
+
+#endif
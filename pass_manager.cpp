@@ -0,0 +1,245 @@
+#include "pass_manager.hpp"
+
+// system includes
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+
+// module includes
+#include "constant_folding.hpp"
+#include "hash_consing.hpp"
+#include "closure.hpp"
+
+bool parsePassOption(const std::string & arg, PassOptions & options)
+{
+  if (arg == "-O0" || arg == "-O1" || arg == "-O2")
+  {
+    options.level = arg[2] - '0';
+  }
+  else if (arg == "--time-passes")
+  {
+    options.timePasses = true;
+  }
+  else if (arg == "--dump-passes")
+  {
+    options.dumpPasses = true;
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
+
+void PassManager::registerPass(const Pass & pass)
+{
+  passes.push_back(pass);
+}
+
+void PassManager::setOptions(const PassOptions & passOptions)
+{
+  options = passOptions;
+}
+
+const PassResults & PassManager::results() const
+{
+  return passResults;
+}
+
+// Orders the enabled passes so that each one follows the passes it names in
+// after, keeping registration order otherwise
+std::vector<const Pass *> PassManager::schedule() const
+{
+  std::map<std::string, const Pass *> byName;
+  for (const Pass & pass : passes)
+  {
+    byName[pass.name] = &pass;
+  }
+
+  std::vector<const Pass *> order;
+  std::map<std::string, int> state; // 1 while visiting, 2 once scheduled
+
+  // depth first, dependencies before dependents
+  struct Visitor{
+    const std::map<std::string, const Pass *> & byName;
+    std::map<std::string, int> & state;
+    std::vector<const Pass *> & order;
+    int level;
+
+    void visit(const Pass & pass)
+    {
+      int & mark = state[pass.name];
+      if (mark == 2)
+      {
+        return;
+      }
+      if (mark == 1)
+      {
+        throw std::logic_error("Error: pass dependency cycle at " + pass.name);
+      }
+      mark = 1;
+      for (const std::string & name : pass.after)
+      {
+        auto it = byName.find(name);
+        if (it == byName.end())
+        {
+          throw std::logic_error("Error: pass " + pass.name + " depends on unknown pass " + name);
+        }
+        if (it->second->level <= level)
+        {
+          visit(*it->second);
+        }
+      }
+      state[pass.name] = 2;
+      order.push_back(&pass);
+    }
+  } visitor{byName, state, order, options.level};
+
+  for (const Pass & pass : passes)
+  {
+    if (pass.level <= options.level)
+    {
+      visitor.visit(pass);
+    }
+  }
+  return order;
+}
+
+void PassManager::run(Expression & ast, const Environment & env)
+{
+  passResults = PassResults();
+  runPasses(ast, env, false);
+}
+
+void PassManager::rerun(Expression & ast, const Environment & env)
+{
+  runPasses(ast, env, true);
+}
+
+void PassManager::runPasses(Expression & ast, const Environment & env, bool environmentDependentOnly)
+{
+  for (const Pass * pass : schedule())
+  {
+    if (environmentDependentOnly && !pass->environmentDependent)
+    {
+      continue;
+    }
+    if (options.dumpPasses)
+    {
+      std::cerr << "*** AST before " << pass->name << " ***\n" << ast << std::endl;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    pass->function(ast, env, passResults);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (options.timePasses)
+    {
+      std::size_t i = 0;
+      while (i < timings.size() && timings[i].name != pass->name)
+      {
+        ++i;
+      }
+      if (i == timings.size())
+      {
+        timings.push_back(Timing{pass->name, 0, 0});
+      }
+      timings[i].seconds += elapsed.count();
+      ++timings[i].runs;
+    }
+    if (options.dumpPasses)
+    {
+      std::cerr << "*** AST after " << pass->name << " ***\n" << ast << std::endl;
+    }
+#ifndef NDEBUG
+    verifyAST(ast, passResults, pass->name);
+#endif
+  }
+}
+
+void PassManager::reportTimings(std::ostream & out) const
+{
+  double total = 0;
+  out << "===-- pass execution times --===" << std::endl;
+  for (const Timing & timing : timings)
+  {
+    out << std::fixed << std::setprecision(3) << std::setw(10) << timing.seconds * 1000 << " ms  "
+        << timing.name << " (" << timing.runs << (timing.runs == 1 ? " run)" : " runs)") << std::endl;
+    total += timing.seconds;
+  }
+  out << std::fixed << std::setprecision(3) << std::setw(10) << total * 1000 << " ms  total" << std::endl;
+}
+
+static void typeCheckPass(Expression & ast, const Environment & env, PassResults &)
+{
+  inferTypes(ast, env, false);
+}
+
+static void constantFoldingPass(Expression & ast, const Environment & env, PassResults & results)
+{
+  results.foldedNodes += foldConstants(ast, env);
+}
+
+static void uncheckedBuiltinsPass(Expression & ast, const Environment & env, PassResults & results)
+{
+  results.typeStats = inferTypes(ast, env, true);
+}
+
+static void commonSubexpressionPass(Expression & ast, const Environment & env, PassResults & results)
+{
+  results.cseSlots = eliminateCommonSubexpressions(ast, env);
+}
+
+static void resolveScopesPass(Expression & ast, const Environment &, PassResults & results)
+{
+  results.frameSize = resolveScopes(ast);
+}
+
+void registerStandardPasses(PassManager & manager)
+{
+  // Type checking runs at every level so -O never changes which programs are rejected
+  manager.registerPass(Pass{"type-check", typeCheckPass, 0, {}, true});
+  manager.registerPass(Pass{"constant-folding", constantFoldingPass, 1, {"type-check"}, false});
+  manager.registerPass(Pass{"unchecked-builtins", uncheckedBuiltinsPass, 1, {"type-check", "constant-folding"}, true});
+  manager.registerPass(Pass{"cse", commonSubexpressionPass, 2, {"unchecked-builtins"}, false});
+  // Last, since it unshares the bodies of lambda and let to annotate them
+  manager.registerPass(Pass{"resolve-scopes", resolveScopesPass, 0,
+                            {"type-check", "constant-folding", "unchecked-builtins", "cse"}, false});
+}
+
+static void verifyNode(const Expression & expr, const PassResults & results, const std::string & pass)
+{
+  if (expr.tail.empty())
+  {
+    if (expr.head.type == NoneType)
+    {
+      throw std::logic_error("Error: after pass " + pass + ": empty atom in AST");
+    }
+    return;
+  }
+  if (expr.head.type != SymbolType && expr.head.type != ListType)
+  {
+    throw std::logic_error("Error: after pass " + pass + ": head of expression is not a symbol");
+  }
+  if (expr.signature != nullptr &&
+      (expr.tail.size() < expr.signature->minArgs || expr.tail.size() > expr.signature->maxArgs))
+  {
+    throw std::logic_error("Error: after pass " + pass + ": unchecked call to " + expr.head.value.sym_value +
+                           " with wrong number of arguments");
+  }
+  if (expr.cseSlot >= 0 && static_cast<std::size_t>(expr.cseSlot) >= results.cseSlots)
+  {
+    throw std::logic_error("Error: after pass " + pass + ": memo slot out of range");
+  }
+  for (const auto & e : expr.tail)
+  {
+    verifyNode(e, results, pass);
+  }
+}
+
+void verifyAST(const Expression & ast, const PassResults & results, const std::string & pass)
+{
+  verifyNode(ast, results, pass);
+}
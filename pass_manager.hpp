@@ -0,0 +1,88 @@
+#ifndef PASS_MANAGER_HPP
+#define PASS_MANAGER_HPP
+
+// system includes
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// module includes
+#include "expression.hpp"
+#include "environment.hpp"
+#include "type_inference.hpp"
+
+// Results the passes leave for the evaluator and for reporting
+struct PassResults{
+  TypeInferenceStats typeStats;
+  std::size_t foldedNodes = 0;
+  std::size_t cseSlots = 0;
+  std::size_t frameSize = 0;  // frame slots used by let at the top level
+};
+
+// A PassFunction transforms or analyses the AST between parse and eval
+typedef void (*PassFunction)(Expression & ast, const Environment & env, PassResults & results);
+
+struct Pass{
+  std::string name;
+  PassFunction function;
+  int level;                           // lowest -O level enabling the pass
+  std::vector<std::string> after;      // passes that run first when enabled
+  bool environmentDependent;           // rerun when the environment changes
+};
+
+// Options selected on the command line of slisp and sldraw
+struct PassOptions{
+  int level = 2;
+  bool timePasses = false;
+  bool dumpPasses = false;
+};
+
+// Parses -O0, -O1, -O2, --time-passes and --dump-passes.
+// Returns false if arg is not a pass option.
+bool parsePassOption(const std::string & arg, PassOptions & options);
+
+// Runs the registered passes enabled at the current -O level, ordered by
+// their dependencies, timing each one. In debug builds the AST is verified
+// after every pass.
+class PassManager{
+public:
+  void registerPass(const Pass & pass);
+  void setOptions(const PassOptions & options);
+
+  // Runs every enabled pass
+  void run(Expression & ast, const Environment & env);
+
+  // Runs the enabled passes whose result depends on the environment
+  void rerun(Expression & ast, const Environment & env);
+
+  const PassResults & results() const;
+
+  // Prints the accumulated time spent in every pass
+  void reportTimings(std::ostream & out) const;
+
+private:
+  struct Timing{
+    std::string name;
+    double seconds;
+    std::size_t runs;
+  };
+
+  void runPasses(Expression & ast, const Environment & env, bool environmentDependentOnly);
+  std::vector<const Pass *> schedule() const;
+
+  std::vector<Pass> passes;
+  std::vector<Timing> timings;
+  PassOptions options;
+  PassResults passResults;
+};
+
+// Registers type checking, constant folding, unchecked builtins, common
+// subexpression elimination and scope resolution
+void registerStandardPasses(PassManager & manager);
+
+// Checks the structural invariants the evaluator relies on.
+// Throws std::logic_error naming the pass that broke one.
+void verifyAST(const Expression & ast, const PassResults & results, const std::string & pass);
+
+#endif
@@ -0,0 +1,83 @@
+#include "point_buffer.hpp"
+
+// system includes
+#include <string>
+
+// module includes
+#include "interpreter_semantic_error.hpp"
+#include "number_vector.hpp"
+
+bool isShape(Type type)
+{
+  return type == PointsType || type == PolylineType || type == PolygonType;
+}
+
+// Name of the builtin creating a shape type, for error messages
+static std::string builtinName(Type type)
+{
+  return type == PointsType ? "points" : type == PolylineType ? "polyline" : "polygon";
+}
+
+ShapeBuilder::ShapeBuilder(Type type): type(type), buffer(std::make_shared<PointBuffer>())
+{
+}
+
+void ShapeBuilder::add(const Atom & atom)
+{
+  if (atom.type == PointType)
+  {
+    buffer->xs.push_back(atom.value.point_value.x);
+    buffer->ys.push_back(atom.value.point_value.y);
+  }
+  else if (isShape(atom.type))
+  {
+    const PointBuffer & points = *atom.value.shape();
+    buffer->xs.insert(buffer->xs.end(), points.xs.begin(), points.xs.end());
+    buffer->ys.insert(buffer->ys.end(), points.ys.begin(), points.ys.end());
+  }
+  else
+  {
+    throw InterpreterSemanticError("Error: Invalid arguments for " + builtinName(type) +
+                                   ", expected points, shapes, sequences of points or two vectors of coordinates.");
+  }
+}
+
+void ShapeBuilder::addArguments(const std::vector<Atom> & args)
+{
+  if (args.size() == 2 && args[0].type == VectorType && args[1].type == VectorType)
+  {
+    const std::vector<Number> & xs = args[0].value.vector()->values;
+    const std::vector<Number> & ys = args[1].value.vector()->values;
+    if (xs.size() != ys.size())
+    {
+      throw InterpreterSemanticError("Error: Coordinate vectors of " + builtinName(type) + " differ in length.");
+    }
+    buffer->xs.insert(buffer->xs.end(), xs.begin(), xs.end());
+    buffer->ys.insert(buffer->ys.end(), ys.begin(), ys.end());
+    return;
+  }
+  for (const Atom & atom : args)
+  {
+    add(atom);
+  }
+}
+
+Expression ShapeBuilder::finish()
+{
+  std::size_t minimum = type == PolygonType ? 3 : type == PolylineType ? 2 : 0;
+  if (buffer->size() < minimum)
+  {
+    throw InterpreterSemanticError("Error: A " + builtinName(type) + " needs at least " + std::to_string(minimum) + " points.");
+  }
+  buffer->xs.shrink_to_fit();
+  buffer->ys.shrink_to_fit();
+  return shapeExpression(type, buffer);
+}
+
+Expression shapeExpression(Type type, const std::shared_ptr<const PointBuffer> & points)
+{
+  Atom atom{};
+  atom.type = type;
+  atom.value.object = points;
+  return Expression(atom);
+}
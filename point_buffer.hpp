@@ -0,0 +1,51 @@
+#ifndef POINT_BUFFER_HPP
+#define POINT_BUFFER_HPP
+
+// system includes
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// module includes
+#include "expression.hpp"
+
+// A PointBuffer stores the vertices of a shape as two arrays of coordinates,
+// 16 bytes per vertex rather than one Point or Line Expression per vertex.
+// Point arrays, polylines and polygons share it; a polygon is closed from
+// its last vertex back to its first.
+struct PointBuffer{
+  std::vector<Number> xs;
+  std::vector<Number> ys;
+
+  std::size_t size() const { return xs.size(); }
+};
+
+// true for PointsType, PolylineType and PolygonType
+bool isShape(Type type);
+
+// Collects the vertices of a shape from the arguments of points, polyline
+// and polygon: points, other shapes, or two vectors of x and y coordinates
+class ShapeBuilder{
+public:
+  explicit ShapeBuilder(Type type);
+
+  // Appends a point, or the vertices of a shape.
+  // Throws InterpreterSemanticError on other atoms.
+  void add(const Atom & atom);
+
+  // Appends the arguments of a call, taking two vectors as coordinates
+  void addArguments(const std::vector<Atom> & args);
+
+  // The shape of the collected vertices. Throws InterpreterSemanticError
+  // if a polyline has fewer than two or a polygon fewer than three.
+  Expression finish();
+
+private:
+  Type type;
+  std::shared_ptr<PointBuffer> buffer;
+};
+
+// Wraps a buffer in an Expression of a shape type
+Expression shapeExpression(Type type, const std::shared_ptr<const PointBuffer> & points);
+
+#endif
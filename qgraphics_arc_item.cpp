@@ -6,12 +6,17 @@
 #include <QPainter>
 #include <qmath.h>
 
+int arcSpan(qreal radians)
+{
+    return static_cast<int>(radians * (180 / M_PI) * 16);
+}
+
 //Function to copy the values necessary for drawing an arc.
 QGraphicsArcItem::QGraphicsArcItem(qreal x, qreal y, qreal width, qreal height, QGraphicsItem* parent) : QGraphicsEllipseItem(x - width, y - width, 2 * width, 2 * width, parent) 
 { 
     centerPoint = QPointF(x, y);
     startPoint = QPointF(x + width, y);
-    spanAngle = height; 
+    spanAngle = arcSpan(height); // Convert radians to 1/16th degrees once
 }
 
 // Paint funcction to draw the arc
@@ -21,10 +26,8 @@ void QGraphicsArcItem::paint(QPainter* painter, const QStyleOptionGraphicsItem*
     QRectF rectangle(centerPoint.x() - radius, centerPoint.y() - radius, 2 * radius, 2 * radius);
 
     int startAngle = 0;
-    spanAngle = spanAngle * (180 / M_PI) * 16; // Convert radians to 1/16th degrees
 
-    QPen pen(Qt::black);  
-    painter->setPen(pen);
+    painter->setPen(Qt::black);
 
     painter->drawArc(rectangle, startAngle, spanAngle); 
 }
@@ -3,6 +3,10 @@
 
 #include <QGraphicsEllipseItem>
 
+// The span QPainter::drawArc takes for an arc of the given radians: the
+// angle in 1/16 degrees, truncated
+int arcSpan(qreal radians);
+
 class QGraphicsArcItem: public QGraphicsEllipseItem{
 
 public:
@@ -16,7 +20,7 @@ private:
 	QPointF centerPoint; // Store the center point
 	QPointF startPoint;
 	QPointF endPoint;
-	double spanAngle = 0;    // Store the span angle
+	int spanAngle = 0;    // Store the span angle in 1/16th degrees
 };
 
 
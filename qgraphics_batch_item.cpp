@@ -0,0 +1,276 @@
+#include "qgraphics_batch_item.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <QImage>
+#include <QPainter>
+#include <QPaintDevice>
+#include <QGraphicsEllipseItem>
+#include <QGraphicsLineItem>
+#include <QStyleOptionGraphicsItem>
+
+#include "qgraphics_arc_item.hpp"
+
+QGraphicsBatchItem::QGraphicsBatchItem(QGraphicsItem* parent) : QGraphicsItem(parent), pen(Qt::black)
+{
+    // paint() queries the R-trees with the exposed rectangle
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+Box boxOf(const QRectF& rectangle, qreal margin)
+{
+    QRectF r = rectangle.normalized();
+    return Box{r.left() - margin, r.top() - margin, r.right() + margin, r.bottom() + margin};
+}
+
+// Grows the bounding rectangle by a rectangle and the half pen width around it
+void QGraphicsBatchItem::include(const QRectF& rectangle)
+{
+    prepareGeometryChange();
+    indexed = false;
+    QRectF stroked = rectangle.normalized().adjusted(-0.5, -0.5, 0.5, 0.5);
+    bounds = bounds.isNull() ? stroked : bounds.united(stroked);
+}
+
+// A point is a 1x1 ellipse at (x, y), as QtInterpreter::drawPoint draws it
+void QGraphicsBatchItem::addPoint(qreal x, qreal y)
+{
+    points.append(QPointF(x, y));
+    include(QRectF(x, y, 1, 1));
+}
+
+void QGraphicsBatchItem::addLine(qreal x1, qreal y1, qreal x2, qreal y2)
+{
+    lines.append(QLineF(x1, y1, x2, y2));
+    include(QRectF(QPointF(x1, y1), QPointF(x2, y2)));
+}
+
+// The arc QGraphicsArcItem paints: centered at (x, y) with radius width,
+// starting at angle 0 and spanning height radians
+void QGraphicsBatchItem::addArc(qreal x, qreal y, qreal width, qreal height)
+{
+    Arc arc;
+    arc.x = x;
+    arc.y = y;
+    arc.width = width;
+    arc.height = height;
+    qreal radius = std::abs(width);
+    arc.rectangle = QRectF(x - radius, y - radius, 2 * radius, 2 * radius);
+    arc.span = arcSpan(height);
+    arcs.append(arc);
+    include(arc.rectangle);
+}
+
+int QGraphicsBatchItem::count() const
+{
+    return points.size() + lines.size() + arcs.size();
+}
+
+QList<QGraphicsItem *> QGraphicsBatchItem::separateItems() const
+{
+    QList<QGraphicsItem *> items;
+    for (const QPointF& point : points)
+    {
+        items.append(new QGraphicsEllipseItem(point.x(), point.y(), 1, 1));
+    }
+    for (const QLineF& line : lines)
+    {
+        items.append(new QGraphicsLineItem(line));
+    }
+    for (const Arc& arc : arcs)
+    {
+        items.append(new QGraphicsArcItem(arc.x, arc.y, arc.width, arc.height));
+    }
+    return items;
+}
+
+QRectF QGraphicsBatchItem::boundingRect() const
+{
+    return bounds;
+}
+
+// Indexes the bounding boxes of the primitives with their pen
+void QGraphicsBatchItem::buildIndexes() const
+{
+    if (indexed)
+    {
+        return;
+    }
+    std::vector<Box> boxes;
+    boxes.reserve(points.size());
+    for (const QPointF& point : points)
+    {
+        boxes.push_back(boxOf(QRectF(point.x(), point.y(), 1, 1), 0.5));
+    }
+    pointIndex = SpatialIndex(boxes);
+    boxes.clear();
+    for (const QLineF& line : lines)
+    {
+        boxes.push_back(boxOf(QRectF(line.p1(), line.p2()), 0.5));
+    }
+    lineIndex = SpatialIndex(boxes);
+    boxes.clear();
+    for (const Arc& arc : arcs)
+    {
+        boxes.push_back(boxOf(arc.rectangle, 0.5));
+    }
+    arcIndex = SpatialIndex(boxes);
+    indexed = true;
+}
+
+QVariant QGraphicsBatchItem::itemChange(GraphicsItemChange change, const QVariant& value)
+{
+    if (change == ItemSceneHasChanged && scene() != nullptr)
+    {
+        buildIndexes();
+    }
+    return QGraphicsItem::itemChange(change, value);
+}
+
+// true within half a pen width of a point's ellipse or a line, and inside
+// the circle of an arc, as for the items separateItems returns
+bool QGraphicsBatchItem::contains(const QPointF& point) const
+{
+    if (!bounds.contains(point))
+    {
+        return false;
+    }
+    buildIndexes();
+    Box area = boxOf(QRectF(point, point));
+    bool found = false;
+    pointIndex.query(area, [&](std::size_t i)
+    {
+        found = found || QLineF(points[i] + QPointF(0.5, 0.5), point).length() <= 1;
+    });
+    lineIndex.query(area, [&](std::size_t i)
+    {
+        const QLineF& line = lines[i];
+        QPointF direction = line.p2() - line.p1();
+        qreal length2 = QPointF::dotProduct(direction, direction);
+        qreal t = length2 == 0 ? 0 : qBound<qreal>(0, QPointF::dotProduct(point - line.p1(), direction) / length2, 1);
+        found = found || QLineF(line.p1() + t * direction, point).length() <= 0.5;
+    });
+    arcIndex.query(area, [&](std::size_t i)
+    {
+        const Arc& arc = arcs[i];
+        found = found || (arc.width != 0 && QLineF(arc.rectangle.center(), point).length() <= arc.rectangle.width() / 2 + 0.5);
+    });
+    return found;
+}
+
+// Paints the primitives intersecting the exposed rectangle with one pen:
+// the lines in a single call, then the arcs and points, at the detail the
+// current zoom can show
+void QGraphicsBatchItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    Q_UNUSED(widget);
+
+    buildIndexes();
+    const QRectF exposed = option->exposedRect;
+    const Box area = boxOf(exposed);
+    const qreal pixel = 1 / QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+
+    painter->setPen(pen);
+    painter->setBrush(Qt::NoBrush);
+
+    // lines and arcs within a pixel are drawn as that pixel
+    QVector<QPointF> dots;
+    QVector<QLineF> visibleLines;
+    lineIndex.query(area, [&](std::size_t i)
+    {
+        const QLineF& line = lines[i];
+        if (std::abs(line.dx()) < pixel && std::abs(line.dy()) < pixel)
+        {
+            dots.append(line.p1());
+        }
+        else
+        {
+            visibleLines.append(line);
+        }
+    });
+    painter->drawLines(visibleLines.constData(), visibleLines.size());
+    arcIndex.query(area, [&](std::size_t i)
+    {
+        const Arc& arc = arcs[i];
+        if (arc.rectangle.width() < pixel)
+        {
+            dots.append(arc.rectangle.center());
+        }
+        else
+        {
+            painter->drawArc(arc.rectangle, 0, arc.span);
+        }
+    });
+    painter->drawPoints(dots.constData(), dots.size());
+
+    QVector<QPointF> visiblePoints;
+    pointIndex.query(area, [&](std::size_t i)
+    {
+        visiblePoints.append(points[i]);
+    });
+    if (pixel > 1)
+    {
+        paintDensity(painter, exposed, visiblePoints);
+        return;
+    }
+    for (const QPointF& point : visiblePoints)
+    {
+        painter->drawEllipse(QRectF(point.x(), point.y(), 1, 1));
+    }
+}
+
+// Draws points smaller than a pixel as an image with one pixel per device
+// pixel, darker the more points fall on it: a single point covers 40% of
+// its pixel, as an antialiased sub-pixel ellipse would, and each further
+// point 40% of what is left
+void paintDensity(QPainter* painter, const QRectF& exposed, const QVector<QPointF>& visible)
+{
+    const QTransform transform = painter->worldTransform();
+    QRect target = transform.mapRect(exposed).toAlignedRect();
+    if (painter->device() != nullptr)
+    {
+        target &= QRect(0, 0, painter->device()->width(), painter->device()->height());
+    }
+    if (target.isEmpty() || visible.isEmpty())
+    {
+        return;
+    }
+
+    std::vector<std::uint32_t> counts(static_cast<std::size_t>(target.width()) * target.height(), 0);
+    for (const QPointF& point : visible)
+    {
+        QPointF device = transform.map(point + QPointF(0.5, 0.5));
+        int x = static_cast<int>(std::floor(device.x())) - target.left();
+        int y = static_cast<int>(std::floor(device.y())) - target.top();
+        if (x >= 0 && y >= 0 && x < target.width() && y < target.height())
+        {
+            ++counts[static_cast<std::size_t>(y) * target.width() + x];
+        }
+    }
+
+    static const int shades = 16;
+    QRgb shade[shades + 1];
+    for (int count = 0; count <= shades; ++count)
+    {
+        int alpha = qRound(255 * (1 - std::pow(0.6, count)));
+        shade[count] = qRgba(0, 0, 0, alpha); // premultiplied black
+    }
+    QImage image(target.size(), QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < target.height(); ++y)
+    {
+        QRgb* line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        const std::uint32_t* row = counts.data() + static_cast<std::size_t>(y) * target.width();
+        for (int x = 0; x < target.width(); ++x)
+        {
+            line[x] = shade[std::min<std::uint32_t>(row[x], shades)];
+        }
+    }
+
+    painter->save();
+    painter->resetTransform();
+    painter->drawImage(target.topLeft(), image);
+    painter->restore();
+}
@@ -0,0 +1,81 @@
+#ifndef QGRAPHIC_BATCH_ITEM_HPP
+#define QGRAPHIC_BATCH_ITEM_HPP
+
+#include <QGraphicsItem>
+#include <QList>
+#include <QPen>
+#include <QVector>
+
+#include "spatial_index.hpp"
+
+// A QGraphicsBatchItem holds many points, lines and arcs in packed arrays
+// and paints them all in one paint() call, so the scene keeps a single
+// item and BSP entry for the batch rather than one per primitive. Points
+// and arcs look as the QGraphicsEllipseItem and QGraphicsArcItem that
+// QtInterpreter draws for one primitive.
+//
+// Painting is bounded by what is visible: an R-tree over the primitives
+// picks those intersecting the exposed rectangle, lines and arcs smaller
+// than a pixel are drawn as a single pixel, and points smaller than a
+// pixel are summed into a density raster drawn as one image.
+class QGraphicsBatchItem: public QGraphicsItem{
+
+public:
+
+  QGraphicsBatchItem(QGraphicsItem *parent = nullptr);
+
+  void addPoint(qreal x, qreal y);
+  void addLine(qreal x1, qreal y1, qreal x2, qreal y2);
+  // takes the arguments of the QGraphicsArcItem constructor
+  void addArc(qreal x, qreal y, qreal width, qreal height);
+
+  int count() const;
+
+  // One item per primitive, for batches small enough that
+  // the scene may as well pick the primitives one by one
+  QList<QGraphicsItem *> separateItems() const;
+
+  QRectF boundingRect() const override;
+  bool contains(const QPointF &point) const override;
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+protected:
+
+  // builds the indexes on joining a scene, so painting only reads the item
+  QVariant itemChange(GraphicsItemChange change, const QVariant &value) override;
+
+private:
+
+  // an arc with its rectangle and span in 1/16 degrees computed once
+  struct Arc{
+    qreal x, y, width, height;
+    QRectF rectangle;
+    int span;
+  };
+
+  void include(const QRectF &rectangle);
+  void buildIndexes() const;
+
+  QVector<QPointF> points;
+  QVector<QLineF> lines;
+  QVector<Arc> arcs;
+  QRectF bounds;
+  QPen pen;
+
+  // built on first use, once the item is complete
+  mutable bool indexed = false;
+  mutable SpatialIndex pointIndex;
+  mutable SpatialIndex lineIndex;
+  mutable SpatialIndex arcIndex;
+};
+
+// A Box of a rectangle, normalized and grown by margin on every side
+Box boxOf(const QRectF &rectangle, qreal margin = 0);
+
+// Paints points smaller than a device pixel, each the 1x1 ellipse at its
+// position, as one image of the exposed rectangle, darker where more points
+// fall on a pixel
+void paintDensity(QPainter *painter, const QRectF &exposed, const QVector<QPointF> &visible);
+
+
+#endif
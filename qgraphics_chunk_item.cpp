@@ -0,0 +1,121 @@
+#include "qgraphics_chunk_item.hpp"
+
+#include <cmath>
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QVector>
+
+#include "qgraphics_arc_item.hpp"
+#include "qgraphics_batch_item.hpp"
+#include "qgraphics_polyline_item.hpp"
+
+QGraphicsChunkItem::QGraphicsChunkItem(std::shared_ptr<const void> mapping, const SceneChunk& chunk, QGraphicsItem* parent)
+    : QGraphicsItem(parent), mapping(mapping), chunk(chunk), pen(Qt::black)
+{
+    // paint() skips the primitives outside the exposed rectangle, reading
+    // them from the file as it goes
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+QRectF QGraphicsChunkItem::boundingRect() const
+{
+    return QRectF(QPointF(chunk.box.minX, chunk.box.minY), QPointF(chunk.box.maxX, chunk.box.maxY));
+}
+
+// Paints the primitives of the chunk intersecting the exposed rectangle as
+// QGraphicsBatchItem does: lines and arcs within a pixel as that pixel,
+// and points smaller than a pixel as a density image
+void QGraphicsChunkItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    Q_UNUSED(widget);
+
+    const QRectF exposed = option->exposedRect.adjusted(-0.5, -0.5, 0.5, 0.5);
+    const qreal pixel = 1 / QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    const double* data = chunk.data;
+
+    painter->setPen(pen);
+    painter->setBrush(Qt::NoBrush);
+
+    QVector<QPointF> dots;
+    switch (chunk.kind)
+    {
+    case ChunkKind::Points:
+    {
+        QVector<QPointF> visible;
+        for (std::uint32_t i = 0; i < chunk.count; ++i)
+        {
+            QRectF point(data[2 * i], data[2 * i + 1], 1, 1);
+            if (!exposed.intersects(point))
+            {
+                continue;
+            }
+            if (pixel > 1)
+            {
+                visible.append(point.topLeft());
+            }
+            else
+            {
+                painter->drawEllipse(point);
+            }
+        }
+        paintDensity(painter, option->exposedRect, visible);
+        break;
+    }
+
+    case ChunkKind::Lines:
+    {
+        QVector<QLineF> visible;
+        for (std::uint32_t i = 0; i < chunk.count; ++i)
+        {
+            QLineF line(data[4 * i], data[4 * i + 1], data[4 * i + 2], data[4 * i + 3]);
+            if (!exposed.intersects(QRectF(line.p1(), line.p2()).normalized()))
+            {
+                continue;
+            }
+            if (std::abs(line.dx()) < pixel && std::abs(line.dy()) < pixel)
+            {
+                dots.append(line.p1());
+            }
+            else
+            {
+                visible.append(line);
+            }
+        }
+        painter->drawLines(visible.constData(), visible.size());
+        break;
+    }
+
+    case ChunkKind::Arcs:
+        // the arc QGraphicsArcItem paints for its constructor's arguments
+        for (std::uint32_t i = 0; i < chunk.count; ++i)
+        {
+            qreal x = data[4 * i], y = data[4 * i + 1];
+            qreal radius = std::abs(data[4 * i + 2]);
+            QRectF rectangle(x - radius, y - radius, 2 * radius, 2 * radius);
+            if (!exposed.intersects(rectangle))
+            {
+                continue;
+            }
+            if (rectangle.width() < pixel)
+            {
+                dots.append(rectangle.center());
+            }
+            else
+            {
+                painter->drawArc(rectangle, 0, arcSpan(data[4 * i + 3]));
+            }
+        }
+        break;
+
+    case ChunkKind::Polyline:
+    case ChunkKind::Polygon:
+        // converted from the file as they are painted
+        paintPolyline(*painter, chunk.count, chunk.kind == ChunkKind::Polygon, [data](std::size_t i)
+        {
+            return QPointF(data[2 * i], data[2 * i + 1]);
+        });
+        break;
+    }
+    painter->drawPoints(dots.constData(), dots.size());
+}
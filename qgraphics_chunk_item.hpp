@@ -0,0 +1,31 @@
+#ifndef QGRAPHIC_CHUNK_ITEM_HPP
+#define QGRAPHIC_CHUNK_ITEM_HPP
+
+#include <memory>
+
+#include <QGraphicsItem>
+#include <QPen>
+
+#include "scene_file.hpp"
+
+// A QGraphicsChunkItem shows one chunk of a mapped scene file. It reads the
+// primitives in place only when painted, so a chunk that never comes on
+// screen is never read from the file. The item keeps the mapping open.
+class QGraphicsChunkItem: public QGraphicsItem{
+
+public:
+
+  QGraphicsChunkItem(std::shared_ptr<const void> mapping, const SceneChunk &chunk, QGraphicsItem *parent = nullptr);
+
+  QRectF boundingRect() const override;
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+private:
+
+  std::shared_ptr<const void> mapping;
+  SceneChunk chunk;
+  QPen pen;
+};
+
+
+#endif
@@ -0,0 +1,139 @@
+#include "qgraphics_polyline_item.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include <QPainter>
+#include <QPolygonF>
+#include <QStyleOptionGraphicsItem>
+
+#include "qgraphics_batch_item.hpp"
+
+QGraphicsPolylineItem::QGraphicsPolylineItem(std::shared_ptr<const PointBuffer> points, bool closed, QGraphicsItem* parent)
+    : QGraphicsItem(parent), vertices(std::move(points)), closed(closed), pen(Qt::black)
+{
+    // paint() draws only the runs crossing the exposed rectangle
+    setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+
+    // segment i joins vertex i to vertex i + 1, wrapping around if closed
+    std::vector<Box> boxes;
+    for (std::size_t first = 0; first < segments(); first += runLength)
+    {
+        std::size_t last = std::min(first + runLength, segments());
+        QPointF p = vertex(first);
+        Box box{p.x(), p.y(), p.x(), p.y()};
+        for (std::size_t i = first + 1; i <= last; ++i)
+        {
+            p = vertex(i);
+            box.minX = std::min(box.minX, p.x());
+            box.minY = std::min(box.minY, p.y());
+            box.maxX = std::max(box.maxX, p.x());
+            box.maxY = std::max(box.maxY, p.y());
+        }
+        box = Box{box.minX - 0.5, box.minY - 0.5, box.maxX + 0.5, box.maxY + 0.5};
+        bounds |= QRectF(QPointF(box.minX, box.minY), QPointF(box.maxX, box.maxY));
+        boxes.push_back(box);
+    }
+    runs = SpatialIndex(boxes);
+}
+
+std::size_t QGraphicsPolylineItem::segments() const
+{
+    std::size_t n = vertices->size();
+    return n < 2 ? 0 : closed ? n : n - 1;
+}
+
+QPointF QGraphicsPolylineItem::vertex(std::size_t i) const
+{
+    i %= vertices->size();
+    return QPointF(vertices->xs[i], vertices->ys[i]);
+}
+
+QRectF QGraphicsPolylineItem::boundingRect() const
+{
+    return bounds;
+}
+
+// true within half a pen width of a segment, or inside a polygon
+bool QGraphicsPolylineItem::contains(const QPointF& point) const
+{
+    if (!bounds.contains(point))
+    {
+        return false;
+    }
+    bool found = false;
+    runs.query(boxOf(QRectF(point, point)), [&](std::size_t run)
+    {
+        std::size_t last = std::min((run + 1) * runLength, segments());
+        for (std::size_t i = run * runLength; i < last && !found; ++i)
+        {
+            QPointF start = vertex(i);
+            QPointF direction = vertex(i + 1) - start;
+            qreal length2 = QPointF::dotProduct(direction, direction);
+            qreal t = length2 == 0 ? 0 : qBound<qreal>(0, QPointF::dotProduct(point - start, direction) / length2, 1);
+            found = QLineF(start + t * direction, point).length() <= 0.5;
+        }
+    });
+    if (found || !closed)
+    {
+        return found;
+    }
+    QPolygonF polygon;
+    polygon.reserve(static_cast<int>(vertices->size()));
+    for (std::size_t i = 0; i < vertices->size(); ++i)
+    {
+        polygon.append(vertex(i));
+    }
+    return polygon.containsPoint(point, Qt::OddEvenFill);
+}
+
+// Paints the runs crossing the exposed rectangle as polylines, merging
+// consecutive runs, and skips vertices within a pixel of the last vertex
+// drawn, which moves the line by less than a pixel
+void QGraphicsPolylineItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget)
+{
+    Q_UNUSED(widget);
+
+    const qreal pixel = 1 / QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    std::vector<std::size_t> visible;
+    runs.query(boxOf(option->exposedRect), [&](std::size_t run) { visible.push_back(run); });
+    std::sort(visible.begin(), visible.end());
+
+    painter->setPen(pen);
+    painter->setBrush(Qt::NoBrush);
+
+    QPolygonF line;
+    std::size_t end = 0; // segment after the last one in line
+    for (std::size_t run : visible)
+    {
+        std::size_t first = run * runLength;
+        std::size_t last = std::min(first + runLength, segments());
+        if (first != end)
+        {
+            if (line.size() > 1)
+            {
+                painter->drawPolyline(line);
+            }
+            line.clear();
+        }
+        if (line.isEmpty())
+        {
+            line.append(vertex(first));
+        }
+        for (std::size_t i = first + 1; i <= last; ++i)
+        {
+            QPointF p = vertex(i);
+            if (i == last || std::abs(p.x() - line.back().x()) >= pixel || std::abs(p.y() - line.back().y()) >= pixel)
+            {
+                line.append(p);
+            }
+        }
+        end = last;
+    }
+    if (line.size() > 1)
+    {
+        painter->drawPolyline(line);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef QGRAPHIC_POLYLINE_ITEM_HPP
+#define QGRAPHIC_POLYLINE_ITEM_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+#include <QGraphicsItem>
+#include <QPainter>
+#include <QPen>
+
+#include "point_buffer.hpp"
+#include "spatial_index.hpp"
+
+// A QGraphicsPolylineItem draws a polyline or polygon straight from the
+// interpreter's packed vertices, which it shares rather than copies.
+// Painting is bounded by what is visible: an R-tree over runs of vertices
+// picks the runs crossing the exposed rectangle, and vertices within a
+// pixel of the last one drawn are skipped.
+class QGraphicsPolylineItem: public QGraphicsItem{
+
+public:
+
+  QGraphicsPolylineItem(std::shared_ptr<const PointBuffer> points, bool closed,
+                        QGraphicsItem *parent = nullptr);
+
+  QRectF boundingRect() const override;
+  bool contains(const QPointF &point) const override;
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
+
+private:
+
+  // vertices per run, each run sharing its last vertex with the next
+  static const std::size_t runLength = 256;
+
+  std::size_t segments() const;
+  QPointF vertex(std::size_t i) const;
+
+  std::shared_ptr<const PointBuffer> vertices;
+  bool closed;
+  QRectF bounds;
+  QPen pen;
+  SpatialIndex runs;
+};
+
+// Paints the count vertices vertex(i) returns as a polyline, closed back
+// to the first vertex if closed. They are sent to the painter in runs of
+// 1024 sharing their end vertices, so no copy of the whole shape is made.
+template<typename Vertex>
+void paintPolyline(QPainter &painter, std::size_t count, bool closed, Vertex vertex)
+{
+  static const std::size_t run = 1024;
+  QPointF points[run];
+  std::size_t first = 0;
+  while (first + 1 < count)
+  {
+    std::size_t size = std::min(run, count - first);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+      points[i] = vertex(first + i);
+    }
+    painter.drawPolyline(points, static_cast<int>(size));
+    first += size - 1;
+  }
+  if (closed && count > 2)
+  {
+    painter.drawLine(vertex(count - 1), vertex(0));
+  }
+}
+
+#endif
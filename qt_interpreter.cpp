@@ -6,47 +6,137 @@
 #include <cmath>
 #include <fstream>
 #include <iomanip>
+#include <chrono>
+#include <map>
 
 #include <QBrush>
 #include <QDebug>
 
 #include "qgraphics_arc_item.hpp"
+#include "qgraphics_batch_item.hpp"
+#include "qgraphics_polyline_item.hpp"
 
 
 #include "interpreter_semantic_error.hpp"
+#include "sequence.hpp"
+#include "number_vector.hpp"
+#include "point_buffer.hpp"
 #include <QtWidgets>
 
+// true for the entry (clear)
+static bool isClear(const Expression& ast)
+{
+  return ast.head.type == ListType && ast.tail.size() == 1 && ast.tail[0].head.type == SymbolType &&
+         ast.tail[0].head.value.sym_value == "clear";
+}
+
+// A layer is named by the source of its form, as the interpreter prints it
+static std::string layerName(const Expression& form)
+{
+  std::ostringstream out;
+  out << form;
+  return out.str();
+}
+
 QtInterpreter::QtInterpreter(QObject * parent): QObject(parent)
 {
-  // Nothing to be added here.
+  recordGraphics = true;
+
+  // queued even when sent from the interpreter's own thread, so requests wait their turn
+  connect(this, &QtInterpreter::evaluationRequested, this, &QtInterpreter::evaluateRequest, Qt::QueuedConnection);
+}
+
+unsigned long QtInterpreter::submit(QString entry, bool layerPerForm)
+{
+    unsigned long id = ++submitted;
+    cancelThrough(id - 1);
+    emit evaluationRequested(id, entry, layerPerForm);
+    return id;
+}
+
+void QtInterpreter::cancelAll()
+{
+    cancelThrough(submitted);
+}
+
+// The running entry clears the interpreter's cancel flag before checking
+// superseded, so a cancel made at any point either skips it or stops it.
+void QtInterpreter::cancelThrough(unsigned long id)
+{
+    if (id > superseded)
+    {
+        superseded = id;
+    }
+    cancel();
+}
+
+bool QtInterpreter::waitFor(unsigned long id, int msecs)
+{
+    std::unique_lock<std::mutex> lock(progress);
+    return evaluated.wait_for(lock, std::chrono::milliseconds(msecs), [&] { return finished >= id; });
+}
+
+void QtInterpreter::evaluateRequest(unsigned long id, QString entry, bool layerPerForm)
+{
+    clearCancel();
+    if (id > superseded)
+    {
+        parseAndEvaluate(entry, layerPerForm);
+    }
+    {
+        std::lock_guard<std::mutex> lock(progress);
+        finished = id;
+    }
+    evaluated.notify_all();
 }
 
 // Function that parses and evaluates a string stream.
 // Function calls parse and evaluateExpression for interprer
 // side to interpret the string stream and return expressions 
 // to be drawn. drawExpression() function draws the expression returned. 
-void QtInterpreter::parseAndEvaluate(QString entry) 
+void QtInterpreter::parseAndEvaluate(QString entry, bool layerPerForm) 
 {
     try 
     {
         std::istringstream expressionStream(entry.toStdString());
         bool success = parse(expressionStream);
 
-        if (success) 
+        if (success && isClear(ast) && !isSymbolStringDefined("clear"))
+        {
+            emit canvasCleared();
+        }
+        else if (success) 
         {
+            prepare();
+
             // Special handling for 'begin' form
             if (ast.head.type == SymbolType && ast.head.value.sym_value == "begin") {
-                Expression lastExpr;
+                // a form repeated in the script gets a layer per occurrence
+                std::map<std::string, int> occurrences;
+                if (!layerPerForm) {
+                    startLayer(layerName(ast));
+                }
                 for (const auto& e : ast.tail) {
-                    lastExpr = evaluateExpression(e);
-                    drawExpression(lastExpr);
+                    if (layerPerForm) {
+                        std::string name = layerName(e);
+                        int occurrence = occurrences[name]++;
+                        startLayer(occurrence == 0 ? name : name + " #" + std::to_string(occurrence + 1));
+                    }
+                    Expression value = evaluateExpression(e);
+                    drawGraphics();
+                    drawExpression(value);
+                    if (layerPerForm) {
+                        finishLayer(true);
+                    }
                 }
-                // Draw only the last expression
-                drawExpression(lastExpr);
+                finishLayer(true);
             } else {
                 // Handle other forms normally
+                startLayer(layerName(ast));
                 Expression result = evaluateExpression(ast);
+                drawGraphics();
                 drawExpression(result);
+                finishLayer(true);
             }
         }
         else 
@@ -56,14 +146,142 @@ void QtInterpreter::parseAndEvaluate(QString entry)
     }
     catch (const InterpreterSemanticError& e) 
     {
+        finishLayer(false);
         emit error(QString::fromStdString(e.what()));
     }
     catch (const std::exception& e) 
     {
+        finishLayer(false);
         emit error(QString::fromStdString(e.what()));
     }
 }
 
+// Opens the layer the graphics of a form are drawn into
+void QtInterpreter::startLayer(const std::string& name)
+{
+    emit layerStarted(QString::fromStdString(name));
+    layerOpen = true;
+}
+
+// Sends the rest of the layer's graphics and closes it, if one is open
+void QtInterpreter::finishLayer(bool succeeded)
+{
+    flushGraphics();
+    if (layerOpen)
+    {
+        layerOpen = false;
+        emit layerFinished(succeeded);
+    }
+}
+
+// Adds an item to the batch, sending the batch once a frame has passed
+void QtInterpreter::queueGraphic(QGraphicsItem * item)
+{
+    if (pendingGraphics.isEmpty() && primitives == nullptr)
+    {
+        sinceFlush.start();
+    }
+    pendingGraphics.append(item);
+    if (sinceFlush.elapsed() >= flushInterval)
+    {
+        flushGraphics();
+    }
+}
+
+// Adds a point, line or arc to the batch, sending it once a frame has passed
+void QtInterpreter::queuePrimitive(const Atom& atom)
+{
+    addPrimitive(atom);
+    if (sinceFlush.elapsed() >= flushInterval)
+    {
+        flushGraphics();
+    }
+}
+
+// Packs a point, line or arc into the batch, without checking the time,
+// or hands it to the writer if there is one
+void QtInterpreter::addPrimitive(const Atom& atom)
+{
+    if (primitives == nullptr && writer == nullptr)
+    {
+        if (pendingGraphics.isEmpty())
+        {
+            sinceFlush.start();
+        }
+        primitives = new QGraphicsBatchItem;
+    }
+    if (atom.type == PointType)
+    {
+        qreal x = atom.value.point_value.x;
+        qreal y = atom.value.point_value.y;
+        if (writer != nullptr)
+        {
+            writer->point(x, y);
+        }
+        else
+        {
+            primitives->addPoint(x, y);
+        }
+    }
+    else if (atom.type == LineType)
+    {
+        const Line& line = atom.value.line_value;
+        if (writer != nullptr)
+        {
+            writer->line(line.first.x, line.first.y, line.second.x, line.second.y);
+        }
+        else
+        {
+            primitives->addLine(line.first.x, line.first.y, line.second.x, line.second.y);
+        }
+    }
+    else if (atom.type == ArcType)
+    {
+        qreal x = atom.value.arc_value.center.x;
+        qreal y = atom.value.arc_value.center.y;
+        qreal width = 2 * (atom.value.arc_value.start.x - x);
+        qreal height = atom.value.arc_value.span;
+        // Adjusted to center the arc at (x,y)
+        if (writer != nullptr)
+        {
+            writer->arc(x - width / 2, y - height / 2, width, height);
+        }
+        else
+        {
+            primitives->addArc(x - width / 2, y - height / 2, width, height);
+        }
+    }
+}
+
+void QtInterpreter::setWriter(GraphicsWriter * graphicsWriter)
+{
+    writer = graphicsWriter;
+}
+
+// Sends the batch. Primitives are sent as one packed item, or as separate
+// items if there are fewer than batchThreshold of them.
+void QtInterpreter::flushGraphics()
+{
+    if (primitives != nullptr)
+    {
+        if (primitives->count() < batchThreshold)
+        {
+            pendingGraphics.append(primitives->separateItems());
+            delete primitives;
+        }
+        else
+        {
+            pendingGraphics.append(primitives);
+        }
+        primitives = nullptr;
+    }
+    if (!pendingGraphics.isEmpty())
+    {
+        emit drawGraphicBatch(pendingGraphics);
+        pendingGraphics.clear();
+    }
+}
+
 
 /*
   The function takes an Expression object as its input and determines the type of the expression 
@@ -73,9 +291,7 @@ void QtInterpreter::parseAndEvaluate(QString entry)
 void QtInterpreter::drawExpression(const Expression& result) 
 {
     std::string resultStr;
-    QGraphicsEllipseItem* pointItem = nullptr;
-    QGraphicsLineItem* lineItem = nullptr;
-    QGraphicsArcItem* arcItem = nullptr;
+    QGraphicsItem* shapeItem = nullptr;
 
     switch (result.head.type) 
     {
@@ -92,15 +308,42 @@ void QtInterpreter::drawExpression(const Expression& result)
         break;
     
     case PointType:
-        drawPoint(result, resultStr, pointItem);
+        drawPoint(result, resultStr);
         break;
     
     case LineType:
-        drawLine(result, resultStr, lineItem);
+        drawLine(result, resultStr);
         break;
     
     case ArcType:
-        drawArc(result, resultStr, arcItem);
+        drawArc(result, resultStr);
+        break;
+
+    case LambdaType:
+        resultStr = "<lambda>";
+        break;
+
+    case SequenceType:
+        if (result.head.value.sequence()->kind == Sequence::Draw)
+        {
+            drawSequence(result);
+            return; // Elements are drawn as they are generated
+        }
+        resultStr = "<sequence>";
+        break;
+
+    case VectorType:
+        resultStr = "<vector of " + std::to_string(result.head.value.vector()->values.size()) + " numbers>";
+        break;
+
+    case MaskType:
+        resultStr = "<mask of " + std::to_string(result.head.value.mask()->values.size()) + " booleans>";
+        break;
+
+    case PointsType:
+    case PolylineType:
+    case PolygonType:
+        drawShape(result, resultStr, shapeItem);
         break;
     
     case ListType:
@@ -116,18 +359,58 @@ void QtInterpreter::drawExpression(const Expression& result)
     {
         emit info(QString::fromStdString(resultStr));
     }
-    if (lineItem != nullptr)
+    if (shapeItem != nullptr)
     {
-        emit drawGraphic(lineItem);
+        queueGraphic(shapeItem);
     }
-    if (arcItem != nullptr)
+}
+
+// Handles the drawing of a drawn sequence. Each element is drawn as soon as it
+// is generated and not listed as text, so no list of elements is ever built.
+void QtInterpreter::drawSequence(const Expression& result)
+{
+    std::string resultStr;
+    forEach(result, [&](const Expression& element)
     {
-        emit drawGraphic(arcItem);
-    }
-    if (pointItem != nullptr)
+        QGraphicsItem* shapeItem = nullptr;
+        switch (element.head.type)
+        {
+        case PointType:
+        case LineType:
+        case ArcType:
+            queuePrimitive(element.head);
+            break;
+        case PointsType:
+        case PolylineType:
+        case PolygonType:
+            drawShape(element, resultStr, shapeItem);
+            if (shapeItem != nullptr)
+            {
+                queueGraphic(shapeItem);
+            }
+            break;
+        default:
+            break;
+        }
+    });
+}
+
+// Draws what draw produced inside loops during the last evaluation.
+// The loop's own value is reported after, so primitives are queued untitled.
+void QtInterpreter::drawGraphics()
+{
+    for (const Atom& atom : graphics)
     {
-        emit drawGraphic(pointItem);
+        if (atom.type == PointType || atom.type == LineType || atom.type == ArcType)
+        {
+            queuePrimitive(atom);
+        }
+        else
+        {
+            drawExpression(Expression(atom));
+        }
     }
+    graphics.clear();
 }
 
 // Handles Boolean expressions. Converts the boolean value to a string representation.
@@ -150,37 +433,82 @@ void QtInterpreter::drawSymbol(const Expression& result, std::string& resultStr)
     resultStr = result.head.value.sym_value;
 }
 
-// Handles the drawing of Point expressions. Converts point coordinates to a string and creates a graphical point item.
-void QtInterpreter::drawPoint(const Expression& result, std::string& resultStr, QGraphicsEllipseItem*& pointItem) 
+// Handles the drawing of Point expressions. Converts point coordinates to a string and queues the point.
+void QtInterpreter::drawPoint(const Expression& result, std::string& resultStr) 
 {
     resultStr = "(" + std::to_string(result.head.value.point_value.x) + ", " + std::to_string(result.head.value.point_value.y) + ")";
-    pointItem = new QGraphicsEllipseItem(result.head.value.point_value.x, result.head.value.point_value.y, 1, 1);
+    queuePrimitive(result.head);
 }
 
-// Handles the drawing of Line expressions. Converts line coordinates to a string and creates a graphical line item.
-void QtInterpreter::drawLine(const Expression& result, std::string& resultStr, QGraphicsLineItem*& lineItem) 
+// Handles the drawing of Line expressions. Converts line coordinates to a string and queues the line.
+void QtInterpreter::drawLine(const Expression& result, std::string& resultStr) 
 {
     resultStr = "((" + std::to_string(result.head.value.line_value.first.x) + ", " + std::to_string(result.head.value.line_value.first.y) + "), (" + std::to_string(result.head.value.line_value.second.x) + ", " + std::to_string(result.head.value.line_value.second.y) + "))";
-    lineItem = new QGraphicsLineItem(result.head.value.line_value.first.x, result.head.value.line_value.first.y, result.head.value.line_value.second.x, result.head.value.line_value.second.y);
+    queuePrimitive(result.head);
 }
 
-// Handles the drawing of Arc expressions. Converts arc parameters to a string and creates a graphical arc item.
-void QtInterpreter::drawArc(const Expression& result, std::string& resultStr, QGraphicsArcItem*& arcItem) 
+// Handles the drawing of Arc expressions. Converts arc parameters to a string and queues the arc.
+void QtInterpreter::drawArc(const Expression& result, std::string& resultStr) 
 {
     qreal x = result.head.value.arc_value.center.x;
     qreal y = result.head.value.arc_value.center.y;
-    qreal width = 2 * (result.head.value.arc_value.start.x - x);
-    qreal height = result.head.value.arc_value.span;
-    arcItem = new QGraphicsArcItem(x - width / 2, y - height / 2, width, height); // Adjusted to center the arc at (x,y)
+    queuePrimitive(result.head);
     resultStr = "((" + std::to_string(x) + ", " + std::to_string(y) + "), (" + std::to_string(result.head.value.arc_value.start.x) + ", " + std::to_string(result.head.value.arc_value.start.y) + "), " + std::to_string(result.head.value.arc_value.span) + ")";
 }
 
-// Handles the drawing of List expressions. Iterates through each sub-expression in the list and draws them individually.
+// Handles the drawing of point arrays, polylines and polygons. The whole shape
+// becomes a single item however many vertices it has: a batch of points for
+// a point array, else an item drawing the shared vertices as they are.
+void QtInterpreter::drawShape(const Expression& result, std::string& resultStr, QGraphicsItem*& shapeItem)
+{
+    std::ostringstream stream;
+    stream << result;
+    resultStr = stream.str();
+
+    const PointBuffer& vertices = *result.head.value.shape();
+    if (writer != nullptr && result.head.type == PointsType)
+    {
+        for (std::size_t i = 0; i < vertices.size(); ++i)
+        {
+            writer->point(vertices.xs[i], vertices.ys[i]);
+        }
+    }
+    else if (writer != nullptr)
+    {
+        writer->polyline(vertices, result.head.type == PolygonType);
+    }
+    else if (result.head.type == PointsType)
+    {
+        QGraphicsBatchItem* batch = new QGraphicsBatchItem;
+        for (std::size_t i = 0; i < vertices.size(); ++i)
+        {
+            batch->addPoint(vertices.xs[i], vertices.ys[i]);
+        }
+        shapeItem = batch;
+    }
+    else
+    {
+        shapeItem = new QGraphicsPolylineItem(result.head.value.shared<PointBuffer>(), result.head.type == PolygonType);
+    }
+}
+
+// Handles the list draw returns for several graphics. Its primitives are
+// packed into the batch with no message or clock check per element, and
+// the whole list is sent as one batch.
 void QtInterpreter::drawList(const Expression& result) 
 {
-    // Iterate and draw each sub-expression
     for (const auto& subExpr : result.tail) 
     {
-        drawExpression(subExpr);
+        const Atom& atom = subExpr.head;
+        if (atom.type == PointType || atom.type == LineType || atom.type == ArcType)
+        {
+            addPrimitive(atom);
+        }
+        else
+        {
+            drawExpression(subExpr);
+        }
     }
+    flushGraphics();
+    emit info(QString::fromStdString("<list of " + std::to_string(result.tail.size()) + " graphics>"));
 }
@@ -2,14 +2,21 @@
 #define QT_INTERPRETER_HPP
 
 #include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 #include <QObject>
 #include <QString>
 #include <QGraphicsItem>
+#include <QList>
+#include <QElapsedTimer>
 
 #include "interpreter.hpp"
 #include "canvas_widget.hpp"
 #include <qgraphics_arc_item.hpp>
+#include "qgraphics_batch_item.hpp"
+#include "graphics_writer.hpp"
 
 class QtInterpreter: public QObject, private Interpreter{
 Q_OBJECT
@@ -18,26 +25,90 @@ public:
 
   QtInterpreter(QObject * parent = nullptr);
 
+  using Interpreter::setPassOptions;
+  using Interpreter::reportPassTimings;
+
+  // Hands what is drawn to writer as it is drawn, creating no items, or
+  // goes back to drawing items if writer is nullptr
+  void setWriter(GraphicsWriter * writer);
+
+  // Requests for the thread the interpreter lives on, made from any other.
+  // submit queues an entry and cancels the unfinished work submitted before
+  // it, cancelAll cancels all of it, and waitFor waits up to msecs for an
+  // entry to be evaluated. Cancelled entries still queued are skipped.
+  // The graphics of an entry form one layer of the canvas, or one layer per
+  // form of a begin if layerPerForm is set, as for a script.
+  unsigned long submit(QString entry, bool layerPerForm = false);
+  void cancelAll();
+  bool waitFor(unsigned long id, int msecs);
+
   void drawBoolean(const Expression& result, std::string& resultStr);
   void drawNumber(const Expression& result, std::string& resultStr);
   void drawSymbol(const Expression& result, std::string& resultStr);
-  void drawPoint(const Expression& result, std::string& resultStr, QGraphicsEllipseItem*& pointItem);
-  void drawLine(const Expression& result, std::string& resultStr, QGraphicsLineItem*& lineItem);
-  void drawArc(const Expression& result, std::string& resultStr, QGraphicsArcItem*& arcItem);
+  void drawPoint(const Expression& result, std::string& resultStr);
+  void drawLine(const Expression& result, std::string& resultStr);
+  void drawArc(const Expression& result, std::string& resultStr);
+  void drawShape(const Expression& result, std::string& resultStr, QGraphicsItem*& shapeItem);
   void drawList(const Expression& result);
+  void drawGraphics();
+  void drawSequence(const Expression& result);
 
 signals:
 
-  void drawGraphic(QGraphicsItem * item);
+  void evaluationRequested(unsigned long id, QString entry, bool layerPerForm);
+
+  // Items drawn since the last batch, in drawing order
+  void drawGraphicBatch(QList<QGraphicsItem *> items);
 
   void info(QString message);
 
   void error(QString message);
 
+  // The batches sent between layerStarted and layerFinished make up the
+  // layer of that name. It replaces the previous layer of the name if the
+  // form succeeded; if it failed, it is discarded and the previous one kept.
+  void layerStarted(QString name);
+  void layerFinished(bool succeeded);
+
+  // (clear) removes every layer
+  void canvasCleared();
+
 public slots:
 
-  void parseAndEvaluate(QString entry);
+  void parseAndEvaluate(QString entry, bool layerPerForm = false);
   void drawExpression(const Expression& result);
+
+private slots:
+
+  void evaluateRequest(unsigned long id, QString entry, bool layerPerForm);
+
+private:
+
+  void cancelThrough(unsigned long id);
+
+  void startLayer(const std::string& name);
+  void finishLayer(bool succeeded);
+  bool layerOpen = false;
+
+  // Drawn items are sent in batches, one per frame while an evaluation
+  // runs and the rest when it ends, rather than one signal per item.
+  // Points, lines and arcs of a batch are packed into one item.
+  static const int flushInterval = 16; // milliseconds, a frame at 60 fps
+  static const int batchThreshold = 64;
+  void queueGraphic(QGraphicsItem * item);
+  void queuePrimitive(const Atom& atom);
+  void addPrimitive(const Atom& atom);
+  void flushGraphics();
+  QList<QGraphicsItem *> pendingGraphics;
+  QGraphicsBatchItem * primitives = nullptr;
+  QElapsedTimer sinceFlush;
+  GraphicsWriter * writer = nullptr;
+
+  std::atomic<unsigned long> submitted{0};
+  std::atomic<unsigned long> superseded{0}; // entries up to this one are cancelled
+  std::mutex progress;
+  std::condition_variable evaluated;
+  unsigned long finished = 0;               // last entry done, guarded by progress
 };
 
 #endif
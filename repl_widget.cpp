@@ -38,9 +38,14 @@ void REPLWidget::changed()
 }
 
 // Override the keyPressEvent to handle up and down arrow keys for history
+// and escape to cancel the running evaluation
 void REPLWidget::keyPressEvent(QKeyEvent* event) 
 {
-	if (event->key() == Qt::Key_Up) 
+	if (event->key() == Qt::Key_Escape)
+	{
+		emit cancelRequested();
+	}
+	else if (event->key() == Qt::Key_Up) 
 	{
 		if (historyIndex > 0) 
 		{
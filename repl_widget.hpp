@@ -17,6 +17,9 @@ signals:
 
   void lineEntered(QString entry);
 
+  // Escape pressed, to stop the evaluation of the entries so far
+  void cancelRequested();
+
 private slots:
 
   void changed();
@@ -0,0 +1,195 @@
+#include "scene_file.hpp"
+
+// system includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// module includes
+#include "point_buffer.hpp"
+
+// "SLSCENE" and the version, then a value telling the byte order apart
+static const char magic[8] = {'S', 'L', 'S', 'C', 'E', 'N', 'E', '\0'};
+static const std::uint32_t version = 1;
+static const std::uint32_t byteOrder = 0x01020304;
+
+struct FileHeader{
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byteOrder;
+  std::uint32_t chunks;
+  std::uint32_t reserved;
+  Box bounds;
+};
+
+struct ChunkHeader{
+  std::uint32_t kind;
+  std::uint32_t count;
+  Box box;
+};
+
+const std::uint32_t SceneWriter::chunkSize;
+
+static_assert(sizeof(FileHeader) % 8 == 0 && sizeof(ChunkHeader) % 8 == 0, "scene file data must stay 8-byte aligned");
+
+std::size_t chunkStride(ChunkKind kind)
+{
+  return kind == ChunkKind::Lines || kind == ChunkKind::Arcs ? 4 : 2;
+}
+
+// The box of a rectangle, normalized and grown by the half pen width
+static Box penBox(double x1, double y1, double x2, double y2)
+{
+  return Box{std::min(x1, x2) - 0.5, std::min(y1, y2) - 0.5, std::max(x1, x2) + 0.5, std::max(y1, y2) + 0.5};
+}
+
+static Box united(const Box & a, const Box & b)
+{
+  return Box{std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY)};
+}
+
+SceneWriter::SceneWriter(const std::string & filename) : out(filename, std::ios::binary)
+{
+  // completed by finish()
+  FileHeader header = FileHeader();
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+void SceneWriter::add(Pending & pending, std::initializer_list<double> values, const Box & box)
+{
+  pending.box = pending.values.empty() ? box : united(pending.box, box);
+  pending.values.insert(pending.values.end(), values);
+  if (pending.values.size() == chunkSize * chunkStride(pending.kind))
+  {
+    flush(pending);
+  }
+}
+
+void SceneWriter::point(double x, double y)
+{
+  add(points, {x, y}, penBox(x, y, x + 1, y + 1));
+}
+
+void SceneWriter::line(double x1, double y1, double x2, double y2)
+{
+  add(lines, {x1, y1, x2, y2}, penBox(x1, y1, x2, y2));
+}
+
+// bounded by the circle QGraphicsArcItem paints on: center (x, y), radius width
+void SceneWriter::arc(double x, double y, double width, double height)
+{
+  double radius = std::abs(width);
+  add(arcs, {x, y, width, height}, penBox(x - radius, y - radius, x + radius, y + radius));
+}
+
+// A shape is a chunk of its own, its vertices written as they are read
+void SceneWriter::polyline(const PointBuffer & points, bool closed)
+{
+  if (points.size() == 0)
+  {
+    return;
+  }
+  Box box = penBox(points.xs[0], points.ys[0], points.xs[0], points.ys[0]);
+  for (std::size_t i = 1; i < points.size(); ++i)
+  {
+    box = united(box, penBox(points.xs[i], points.ys[i], points.xs[i], points.ys[i]));
+  }
+  ChunkHeader header{static_cast<std::uint32_t>(closed ? ChunkKind::Polygon : ChunkKind::Polyline),
+                     static_cast<std::uint32_t>(points.size()), box};
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  for (std::size_t i = 0; i < points.size(); ++i)
+  {
+    double vertex[2] = {points.xs[i], points.ys[i]};
+    out.write(reinterpret_cast<const char *>(vertex), sizeof(vertex));
+  }
+  ++chunks;
+  bounds = empty ? box : united(bounds, box);
+  empty = false;
+}
+
+void SceneWriter::writeChunk(ChunkKind kind, std::uint32_t count, const Box & box, const double * values, std::size_t size)
+{
+  ChunkHeader header{static_cast<std::uint32_t>(kind), count, box};
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(values), static_cast<std::streamsize>(size * sizeof(double)));
+  ++chunks;
+  bounds = empty ? box : united(bounds, box);
+  empty = false;
+}
+
+void SceneWriter::flush(Pending & pending)
+{
+  if (pending.values.empty())
+  {
+    return;
+  }
+  std::size_t count = pending.values.size() / chunkStride(pending.kind);
+  writeChunk(pending.kind, static_cast<std::uint32_t>(count), pending.box, pending.values.data(), pending.values.size());
+  pending.values.clear();
+}
+
+bool SceneWriter::good() const
+{
+  return out.good();
+}
+
+bool SceneWriter::finish()
+{
+  flush(points);
+  flush(lines);
+  flush(arcs);
+
+  FileHeader header = FileHeader();
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.byteOrder = byteOrder;
+  header.chunks = chunks;
+  header.bounds = bounds;
+  out.seekp(0);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.close();
+  return !out.fail();
+}
+
+bool readScene(const unsigned char * data, std::size_t size, std::vector<SceneChunk> & chunks, Box & bounds)
+{
+  chunks.clear();
+  FileHeader header;
+  if (reinterpret_cast<std::uintptr_t>(data) % alignof(double) != 0 || size < sizeof(header))
+  {
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version || header.byteOrder != byteOrder)
+  {
+    return false;
+  }
+  bounds = header.bounds;
+
+  std::size_t offset = sizeof(header);
+  chunks.reserve(header.chunks);
+  for (std::uint32_t i = 0; i < header.chunks; ++i)
+  {
+    ChunkHeader chunk;
+    if (size - offset < sizeof(chunk))
+    {
+      return false;
+    }
+    std::memcpy(&chunk, data + offset, sizeof(chunk));
+    offset += sizeof(chunk);
+    if (chunk.kind < static_cast<std::uint32_t>(ChunkKind::Points) || chunk.kind > static_cast<std::uint32_t>(ChunkKind::Polygon))
+    {
+      return false;
+    }
+    ChunkKind kind = static_cast<ChunkKind>(chunk.kind);
+    // counts are 32 bits, so this cannot overflow
+    std::uint64_t bytes = static_cast<std::uint64_t>(chunk.count) * chunkStride(kind) * sizeof(double);
+    if (size - offset < bytes)
+    {
+      return false;
+    }
+    chunks.push_back(SceneChunk{kind, chunk.count, chunk.box, reinterpret_cast<const double *>(data + offset)});
+    offset += static_cast<std::size_t>(bytes);
+  }
+  return offset == size;
+}
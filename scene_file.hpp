@@ -0,0 +1,79 @@
+#ifndef SCENE_FILE_HPP
+#define SCENE_FILE_HPP
+
+// system includes
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+// module includes
+#include "graphics_writer.hpp"
+#include "spatial_index.hpp"
+
+// A scene file holds evaluated geometry, to be shown again without
+// evaluating its script. A header is followed by chunks, each a header of
+// its kind, count and bounding box and then an array of doubles:
+//   Points    x y per point
+//   Lines     x1 y1 x2 y2 per line
+//   Arcs      the QGraphicsArcItem arguments x y width height per arc
+//   Polyline, Polygon   x y per vertex, one shape per chunk
+// Everything is 8-byte aligned and in the byte order of the writer, so a
+// mapping of the file is read in place.
+enum class ChunkKind : std::uint32_t { Points = 1, Lines, Arcs, Polyline, Polygon };
+
+// doubles per element of a chunk
+std::size_t chunkStride(ChunkKind kind);
+
+// A chunk of a scene file in memory
+struct SceneChunk{
+  ChunkKind kind;
+  std::uint32_t count;
+  Box box;              // bounds of the chunk with the half pen width around it
+  const double * data;  // count * chunkStride(kind) doubles
+};
+
+// A SceneWriter writes what is drawn to a scene file, points, lines and
+// arcs gathered into chunks of at most chunkSize, so it holds at most one
+// chunk of each. The header is completed by finish().
+class SceneWriter: public GraphicsWriter{
+public:
+  explicit SceneWriter(const std::string & filename);
+
+  void point(double x, double y) override;
+  void line(double x1, double y1, double x2, double y2) override;
+  void arc(double x, double y, double width, double height) override;
+  void polyline(const PointBuffer & points, bool closed) override;
+
+  bool good() const override;
+  bool finish() override;
+
+  static const std::uint32_t chunkSize = 4096;
+
+private:
+  struct Pending{
+    ChunkKind kind;
+    std::vector<double> values;
+    Box box;
+  };
+
+  void add(Pending & pending, std::initializer_list<double> values, const Box & box);
+  void writeChunk(ChunkKind kind, std::uint32_t count, const Box & box, const double * values, std::size_t size);
+  void flush(Pending & pending);
+
+  std::ofstream out;
+  Pending points{ChunkKind::Points, {}, {}};
+  Pending lines{ChunkKind::Lines, {}, {}};
+  Pending arcs{ChunkKind::Arcs, {}, {}};
+  std::uint32_t chunks = 0;
+  Box bounds{0, 0, 0, 0};
+  bool empty = true;
+};
+
+// Checks that size bytes at data, aligned to 8 bytes, are a scene file and
+// lists its chunks, which point into data. Returns false if they are not.
+bool readScene(const unsigned char * data, std::size_t size, std::vector<SceneChunk> & chunks, Box & bounds);
+
+#endif
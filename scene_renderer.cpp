@@ -0,0 +1,95 @@
+#include "scene_renderer.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <QGraphicsItem>
+#include <QGraphicsScene>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QTransform>
+
+#include "thread_pool.hpp"
+
+// Side of the square tiles, in pixels
+static const int tileSize = 256;
+
+// An item to paint, with its placement computed before the painting starts
+struct PlacedItem{
+  QGraphicsItem * item;
+  QRectF bounds;        // in item coordinates
+  QTransform transform; // item to image coordinates
+  QTransform inverse;
+  QRect area;           // pixels the item may paint
+};
+
+QImage renderScene(QGraphicsScene & scene, const QSize & size)
+{
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QRectF source = scene.itemsBoundingRect();
+    if (size.isEmpty() || source.isNull())
+    {
+        return image;
+    }
+
+    // as a QGraphicsView centers a scene, scaled down if it does not fit
+    qreal scale = 1;
+    if (source.width() > size.width() || source.height() > size.height())
+    {
+        scale = std::min(size.width() / source.width(), size.height() / source.height());
+    }
+    QTransform view;
+    view.translate(size.width() / 2.0, size.height() / 2.0);
+    view.scale(scale, scale);
+    view.translate(-source.center().x(), -source.center().y());
+
+    // Everything the painting threads read is computed here, so they only
+    // call paint(), which leaves the items and the scene unchanged
+    std::vector<PlacedItem> placed;
+    for (QGraphicsItem * item : scene.items(Qt::AscendingOrder))
+    {
+        if (item->isVisible())
+        {
+            QRectF bounds = item->boundingRect();
+            QTransform transform = item->sceneTransform() * view;
+            placed.push_back(PlacedItem{item, bounds, transform, transform.inverted(), transform.mapRect(bounds).toAlignedRect()});
+        }
+    }
+
+    int columns = (size.width() + tileSize - 1) / tileSize;
+    int rows = (size.height() + tileSize - 1) / tileSize;
+    std::vector<QImage> tiles(static_cast<std::size_t>(columns) * rows);
+    ThreadPool::instance().run(tiles.size(), [&](std::size_t t)
+    {
+        QRect area(static_cast<int>(t % columns) * tileSize, static_cast<int>(t / columns) * tileSize, tileSize, tileSize);
+        area &= image.rect();
+        QImage tile(area.size(), QImage::Format_ARGB32_Premultiplied);
+        tile.fill(Qt::white);
+
+        QPainter painter(&tile);
+        painter.setRenderHint(QPainter::Antialiasing);
+        QTransform offset = QTransform::fromTranslate(-area.left(), -area.top());
+        for (const PlacedItem & p : placed)
+        {
+            if (!p.area.intersects(area))
+            {
+                continue;
+            }
+            QStyleOptionGraphicsItem option;
+            option.rect = p.bounds.toAlignedRect();
+            option.exposedRect = p.bounds & p.inverse.mapRect(QRectF(area));
+            painter.setWorldTransform(p.transform * offset);
+            p.item->paint(&painter, &option, nullptr);
+        }
+        painter.end();
+        tiles[t] = tile;
+    });
+
+    QPainter painter(&image);
+    for (std::size_t t = 0; t < tiles.size(); ++t)
+    {
+        painter.drawImage(static_cast<int>(t % columns) * tileSize, static_cast<int>(t / columns) * tileSize, tiles[t]);
+    }
+    return image;
+}
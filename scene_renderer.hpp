@@ -0,0 +1,16 @@
+#ifndef SCENE_RENDERER_HPP
+#define SCENE_RENDERER_HPP
+
+#include <QImage>
+#include <QSize>
+
+class QGraphicsScene;
+
+// Rasterises the items of a scene into an image of the given size on a
+// white background, centered on the items and scaled down to fit if they
+// are larger than the image. The image is split into tiles painted in
+// parallel on the thread pool, each tile painting the items it overlaps.
+// Call from the scene's thread, with no other thread using the scene.
+QImage renderScene(QGraphicsScene & scene, const QSize & size);
+
+#endif
@@ -0,0 +1,115 @@
+#include "sequence.hpp"
+
+// system includes
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// module includes
+#include "interpreter_semantic_error.hpp"
+#include "point_buffer.hpp"
+
+bool Sequence::bounded() const
+{
+  switch (kind)
+  {
+  case Range:
+  case Take:
+    return true;
+  case Iterate:
+    return false;
+  default:
+    return source->bounded();
+  }
+}
+
+SequenceCursor::SequenceCursor(const Sequence & s): sequence(s)
+{
+  if (sequence.source)
+  {
+    source.reset(new SequenceCursor(*sequence.source));
+  }
+}
+
+bool SequenceCursor::next(Expression & element, const SequenceApply & apply)
+{
+  switch (sequence.kind)
+  {
+  case Sequence::Range:
+    if (index >= sequence.count)
+    {
+      return false;
+    }
+    // computed from the index so rounding errors do not accumulate,
+    // modulo 2^64 for integers since the element lies between the bounds
+    if (sequence.integer)
+    {
+      element = Expression(static_cast<Integer>(static_cast<std::uint64_t>(static_cast<Integer>(sequence.start)) +
+                                                static_cast<std::uint64_t>(index) * static_cast<std::uint64_t>(static_cast<Integer>(sequence.step))));
+    }
+    else
+    {
+      element = Expression(sequence.start + index * sequence.step);
+    }
+    ++index;
+    return true;
+
+  case Sequence::Map:
+    if (!source->next(current, apply))
+    {
+      return false;
+    }
+    element = apply(sequence.function, current);
+    return true;
+
+  case Sequence::Take:
+    // the source is not pulled past the last element taken
+    if (index >= sequence.count || !source->next(element, apply))
+    {
+      return false;
+    }
+    ++index;
+    return true;
+
+  case Sequence::Iterate:
+    current = index == 0 ? sequence.seed : apply(sequence.function, current);
+    ++index;
+    element = current;
+    return true;
+
+  case Sequence::Draw:
+    if (!source->next(element, apply))
+    {
+      return false;
+    }
+    if (element.head.type != PointType && element.head.type != LineType && element.head.type != ArcType &&
+        !isShape(element.head.type))
+    {
+      throw InterpreterSemanticError("Error: Invalid argument for draw procedure. Expected point, line, arc or shape.");
+    }
+    return true;
+  }
+  return false;
+}
+
+Number integerCount(Integer start, Integer end, Integer step)
+{
+  Integer distance;
+  if (!subtractIntegers(end, start, distance) || distance == std::numeric_limits<Integer>::min())
+  {
+    return std::max(0.0, std::ceil((static_cast<Number>(end) - static_cast<Number>(start)) / static_cast<Number>(step)));
+  }
+  if (distance == 0 || (distance > 0) != (step > 0))
+  {
+    return 0;
+  }
+  return static_cast<Number>(distance / step + (distance % step != 0 ? 1 : 0));
+}
+
+Expression sequenceExpression(const std::shared_ptr<const Sequence> & sequence)
+{
+  Atom atom;
+  atom.type = SequenceType;
+  atom.value.object = sequence;
+  return Expression(atom);
+}
@@ -0,0 +1,61 @@
+#ifndef SEQUENCE_HPP
+#define SEQUENCE_HPP
+
+// system includes
+#include <functional>
+#include <memory>
+
+// module includes
+#include "expression.hpp"
+
+// A Sequence is a lazily generated list of expressions. Its elements are
+// computed one at a time as they are pulled by a SequenceCursor and are
+// never stored together, so sequences of any length take constant memory.
+struct Sequence{
+  enum Kind {
+    Range,   // start, start + step, ... before end; count elements
+    Map,     // function applied to each element of source
+    Take,    // the first count elements of source
+    Iterate, // seed, (function seed), (function (function seed)), ...
+    Draw     // the elements of source, checked to be graphics
+  };
+  Kind kind;
+  Number start = 0;
+  Number step = 1;
+  Number count = 0;
+  bool integer = false; // a Range of integers, start and step are exact
+  Expression function; // a closure, or the symbol of a builtin procedure
+  Expression seed;
+  std::shared_ptr<const Sequence> source;
+
+  // false if the sequence may never end
+  bool bounded() const;
+};
+
+// Applies the function of a map or iterate to one element
+typedef std::function<Expression(const Expression & function, const Expression & argument)> SequenceApply;
+
+// Pulls the elements of a sequence in order
+class SequenceCursor{
+public:
+  explicit SequenceCursor(const Sequence & sequence);
+
+  // Stores the next element in element and returns true, or returns false
+  // at the end. Throws InterpreterSemanticError from Draw on non-graphics.
+  bool next(Expression & element, const SequenceApply & apply);
+
+private:
+  const Sequence & sequence;
+  Number index = 0;
+  Expression current;
+  std::unique_ptr<SequenceCursor> source;
+};
+
+// Number of the integers start, start + step, ... before end, computed
+// without rounding the distance from start to end
+Number integerCount(Integer start, Integer end, Integer step);
+
+// Wraps a sequence in an Expression of SequenceType
+Expression sequenceExpression(const std::shared_ptr<const Sequence> & sequence);
+
+#endif
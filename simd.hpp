@@ -0,0 +1,22 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+// Intrinsics of the SIMD kernels. SLISP_X86_SIMD is defined where they
+// are available; elsewhere only the scalar forms of the kernels exist.
+#if defined(__x86_64__) || defined(_M_X64)
+#define SLISP_X86_SIMD
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// AVX2 kernels are compiled for AVX2 whatever the build flags,
+// and only called once the processor is known to support it
+#if defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+#endif
@@ -1,28 +1,205 @@
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <memory>
 
 #include <QApplication>
 #include <QDebug>
+#include <QGraphicsScene>
+#include <QImage>
 
 #include "main_window.hpp"
+#include "fast_math.hpp"
+#include "scene_renderer.hpp"
+#include "vector_writer.hpp"
+#include "scene_file.hpp"
+
+static bool endsWith(const std::string& text, const std::string& suffix)
+{
+  return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Reads a whole script file into content
+static bool readScript(const std::string& filename, std::string& content)
+{
+  std::ifstream ifs(filename);
+  if(!ifs){
+    std::cerr << "Error: Could not open file for reading." << std::endl;
+    return false;
+  }
+  content.assign((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+  return true;
+}
+
+// Evaluates a script, reporting errors on stderr; returns false on an error
+static bool evaluateScript(QtInterpreter& interp, const std::string& content)
+{
+  bool failed = false;
+  QObject::connect(&interp, &QtInterpreter::error, [&failed](QString message){
+    std::cerr << message.toStdString() << std::endl;
+    failed = true;
+  });
+  interp.parseAndEvaluate(QString::fromStdString(content));
+  return !failed;
+}
+
+// Evaluates a script without showing a window and saves what it draws
+// as an image of the given size
+static int render(const std::string& filename, const std::string& output, QSize size, const PassOptions& options)
+{
+  std::string content;
+  if(!readScript(filename, content)){
+    return EXIT_FAILURE;
+  }
+
+  QtInterpreter interp;
+  interp.setPassOptions(options);
+  QGraphicsScene scene;
+  QObject::connect(&interp, &QtInterpreter::drawGraphicBatch, [&scene](QList<QGraphicsItem*> items){
+    for(QGraphicsItem * item : items){
+      scene.addItem(item);
+    }
+  });
+  if(!evaluateScript(interp, content)){
+    return EXIT_FAILURE;
+  }
+
+  if(!renderScene(scene, size).save(QString::fromStdString(output))){
+    std::cerr << "Error: Could not write " << output << std::endl;
+    return EXIT_FAILURE;
+  }
+  if(options.timePasses){
+    interp.reportPassTimings(std::cerr);
+  }
+  return EXIT_SUCCESS;
+}
+
+// Evaluates a script without showing a window and writes what it draws to
+// an SVG, PDF or scene file as it is drawn, so no scene or items are ever
+// built. A PDF page has the given size in points, centered on the origin.
+// sldraw opens a scene file in its window without evaluating anything.
+static int exportDrawing(const std::string& filename, const std::string& output, QSize size, const PassOptions& options)
+{
+  std::string content;
+  if(!readScript(filename, content)){
+    return EXIT_FAILURE;
+  }
+
+  std::unique_ptr<GraphicsWriter> writer;
+  if(endsWith(output, ".svg")){
+    writer.reset(new SvgWriter(output));
+  }
+  else if(endsWith(output, ".pdf")){
+    writer.reset(new PdfWriter(output, size));
+  }
+  else if(endsWith(output, ".slscene")){
+    writer.reset(new SceneWriter(output));
+  }
+  else{
+    std::cerr << "Error: --export expects a .svg, .pdf or .slscene file" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if(!writer->good()){
+    std::cerr << "Error: Could not write " << output << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  QtInterpreter interp;
+  interp.setPassOptions(options);
+  interp.setWriter(writer.get());
+  if(!evaluateScript(interp, content)){
+    return EXIT_FAILURE;
+  }
+
+  if(!writer->finish()){
+    std::cerr << "Error: Could not write " << output << std::endl;
+    return EXIT_FAILURE;
+  }
+  if(options.timePasses){
+    interp.reportPassTimings(std::cerr);
+  }
+  return EXIT_SUCCESS;
+}
 
 int main(int argc, char *argv[])
 {
+  // rendering needs no display, so unless told otherwise Qt draws offscreen
+  for(int i = 1; i < argc; ++i){
+    bool headless = std::strcmp(argv[i], "--render") == 0 || std::strcmp(argv[i], "--export") == 0;
+    if(headless && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")){
+      qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+  }
+
   QApplication app(argc, argv);
 
   std::string filename;
+  std::string output;
+  std::string exported;
+  QSize size(800, 600);
+  PassOptions options;
 
-  if(argc == 2){
-    filename = argv[1];
+  // QApplication has already removed its own options from argv
+  for(int i = 1; i < argc; ++i){
+    std::string arg(argv[i]);
+    if(parsePassOption(arg, options)){
+      continue;
+    }
+    if(arg == "--fast-math"){
+      setFastMath(true);
+      continue;
+    }
+    if(arg == "--render" && i + 1 < argc){
+      output = argv[++i];
+      continue;
+    }
+    if(arg == "--export" && i + 1 < argc){
+      exported = argv[++i];
+      continue;
+    }
+    if(arg == "--size" && i + 1 < argc){
+      int width = 0, height = 0;
+      char separator = 0;
+      std::istringstream dimensions(argv[++i]);
+      if(!(dimensions >> width >> separator >> height) || separator != 'x' || width <= 0 || height <= 0){
+        std::cerr << "Error: invalid size, expected WIDTHxHEIGHT" << std::endl;
+        return EXIT_FAILURE;
+      }
+      size = QSize(width, height);
+      continue;
+    }
+    if(!filename.empty()){
+      std::cerr << "Error: invalid number of arguments to sldraw" << std::endl;
+      return EXIT_FAILURE;
+    }
+    filename = arg;
   }
-  if(argc > 2){
-    std::cerr << "Error: invalid number of arguments to sldraw" << std::endl;
-    return EXIT_FAILURE;
+
+  if(!output.empty()){
+    if(filename.empty()){
+      std::cerr << "Error: --render needs a script file" << std::endl;
+      return EXIT_FAILURE;
+    }
+    return render(filename, output, size, options);
+  }
+  if(!exported.empty()){
+    if(filename.empty()){
+      std::cerr << "Error: --export needs a script file" << std::endl;
+      return EXIT_FAILURE;
+    }
+    return exportDrawing(filename, exported, size, options);
   }
 
-  MainWindow w(filename);
+  MainWindow w(filename, options);
   w.setMinimumSize(800,600);
   w.show();
 
-  return app.exec();
+  int status = app.exec();
+  if(options.timePasses){
+    w.reportPassTimings(std::cerr);
+  }
+  return status;
 }
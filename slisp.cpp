@@ -3,10 +3,12 @@
 #include <fstream>
 #include <iostream>
 #include <cstdlib>
+#include <vector>
 
 #include "interpreter_semantic_error.hpp"
 #include "interpreter.hpp"
 #include "expression.hpp"
+#include "fast_math.hpp"
 #include "test_config.hpp"
 using namespace std;
 
@@ -106,26 +108,79 @@ int interactive_repl(Interpreter& interp)
 	return EXIT_SUCCESS;
 }
 
+// Function to report what static type inference removed in the last run
+void report_type_stats(const Interpreter& interp)
+{
+	const TypeInferenceStats& stats = interp.typeInferenceStats();
+	cerr << "type inference: " << stats.provenCallSites << " of " << stats.callSites
+	     << " builtin call sites proven, " << stats.removedChecks << " dynamic checks removed" << endl;
+}
+
 int main(int argc, char** argv)
 {
 	Interpreter interp;
 
+	// Options may appear anywhere, the remaining arguments select the mode
+	bool typeStats = false;
+	PassOptions passOptions;
+	vector<string> args;
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg(argv[i]);
+		if (arg == "--type-stats")
+		{
+			typeStats = true;
+		}
+		else if (arg == "--fast-math")
+		{
+			setFastMath(true);
+		}
+		else if (!parsePassOption(arg, passOptions))
+		{
+			args.push_back(arg);
+		}
+	}
+	interp.setPassOptions(passOptions);
+
 	// Case 1: Execute short simple programs with the -e flag
-	if (argc == 3 && std::string(argv[1]) == "-e")
+	if (args.size() == 2 && args[0] == "-e")
 	{
-		return short_program(interp, argv[2]);
+		int status = short_program(interp, args[1]);
+		if (typeStats)
+		{
+			report_type_stats(interp);
+		}
+		if (passOptions.timePasses)
+		{
+			interp.reportPassTimings(cerr);
+		}
+		return status;
 	}
 
 	// Case 2: Execute programs stored in external files
-	if (argc == 2)
+	if (args.size() == 1)
 	{
-		return external_file(interp, argv[1]);
+		int status = external_file(interp, args[0]);
+		if (typeStats)
+		{
+			report_type_stats(interp);
+		}
+		if (passOptions.timePasses)
+		{
+			interp.reportPassTimings(cerr);
+		}
+		return status;
 	}
 
 	// Case 3: Interactive REPL mode
-	if (argc == 1)
+	if (args.empty())
 	{
-		return interactive_repl(interp);
+		int status = interactive_repl(interp);
+		if (passOptions.timePasses)
+		{
+			interp.reportPassTimings(cerr);
+		}
+		return status;
 	}
 
 	cerr << "Error: Invalid arguments." << endl;
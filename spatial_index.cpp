@@ -0,0 +1,71 @@
+#include "spatial_index.hpp"
+
+// system includes
+#include <algorithm>
+#include <cmath>
+
+// Smallest box containing boxes [first, last) of a level
+static Box bounding(const std::vector<Box> & level, std::size_t first, std::size_t last)
+{
+  Box box = level[first];
+  for (std::size_t i = first + 1; i < last; ++i)
+  {
+    box.minX = std::min(box.minX, level[i].minX);
+    box.minY = std::min(box.minY, level[i].minY);
+    box.maxX = std::max(box.maxX, level[i].maxX);
+    box.maxY = std::max(box.maxY, level[i].maxY);
+  }
+  return box;
+}
+
+SpatialIndex::SpatialIndex(const std::vector<Box> & boxes)
+{
+  if (boxes.empty())
+  {
+    return;
+  }
+
+  // Sort by center x into vertical slices of about sqrt(leaves) leaves each,
+  // then each slice by center y, so runs of fanout boxes are close together
+  order.resize(boxes.size());
+  for (std::size_t i = 0; i < boxes.size(); ++i)
+  {
+    order[i] = static_cast<std::uint32_t>(i);
+  }
+  auto centerX = [&boxes](std::uint32_t i) { return boxes[i].minX + boxes[i].maxX; };
+  auto centerY = [&boxes](std::uint32_t i) { return boxes[i].minY + boxes[i].maxY; };
+  std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) { return centerX(a) < centerX(b); });
+
+  std::size_t leaves = (boxes.size() + fanout - 1) / fanout;
+  std::size_t slices = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(leaves))));
+  std::size_t sliceSize = slices * fanout;
+  for (std::size_t first = 0; first < order.size(); first += sliceSize)
+  {
+    std::size_t last = std::min(first + sliceSize, order.size());
+    std::sort(order.begin() + first, order.begin() + last,
+              [&](std::uint32_t a, std::uint32_t b) { return centerY(a) < centerY(b); });
+  }
+
+  levels.emplace_back();
+  levels.back().reserve(order.size());
+  for (std::uint32_t i : order)
+  {
+    levels.back().push_back(boxes[i]);
+  }
+  while (levels.back().size() > fanout)
+  {
+    const std::vector<Box> & below = levels.back();
+    std::vector<Box> level;
+    level.reserve((below.size() + fanout - 1) / fanout);
+    for (std::size_t first = 0; first < below.size(); first += fanout)
+    {
+      level.push_back(bounding(below, first, std::min(first + fanout, below.size())));
+    }
+    levels.push_back(std::move(level));
+  }
+}
+
+std::size_t SpatialIndex::size() const
+{
+  return order.size();
+}
@@ -0,0 +1,79 @@
+#ifndef SPATIAL_INDEX_HPP
+#define SPATIAL_INDEX_HPP
+
+// system includes
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// A Box is an axis-aligned rectangle with minX <= maxX and minY <= maxY
+struct Box{
+  double minX, minY, maxX, maxY;
+
+  bool intersects(const Box & other) const
+  {
+    return minX <= other.maxX && other.minX <= maxX && minY <= other.maxY && other.minY <= maxY;
+  }
+};
+
+// A SpatialIndex is an R-tree over a fixed set of boxes, bulk loaded with
+// Sort-Tile-Recursive packing: the boxes are sorted into tiles of nearby
+// boxes and each level groups fanout consecutive nodes of the level below.
+// The nodes are stored level by level in flat arrays, with no pointers.
+class SpatialIndex{
+public:
+  SpatialIndex() = default;
+  explicit SpatialIndex(const std::vector<Box> & boxes);
+
+  std::size_t size() const;
+
+  // Calls visit(i) for each i such that boxes[i] intersects area, in no
+  // particular order, visiting only the nodes whose box intersects area
+  template <typename Visit>
+  void query(const Box & area, Visit visit) const;
+
+private:
+  static const std::size_t fanout = 16;
+
+  std::vector<std::uint32_t> order;       // the positions of the leaves in boxes
+  std::vector<std::vector<Box>> levels;   // leaves first, the root level last
+};
+
+template <typename Visit>
+void SpatialIndex::query(const Box & area, Visit visit) const
+{
+  if (levels.empty())
+  {
+    return;
+  }
+  // (level, node) pairs still to descend into
+  std::vector<std::pair<std::size_t, std::size_t>> pending;
+  for (std::size_t node = 0; node < levels.back().size(); ++node)
+  {
+    pending.emplace_back(levels.size() - 1, node);
+  }
+  while (!pending.empty())
+  {
+    std::size_t level = pending.back().first;
+    std::size_t node = pending.back().second;
+    pending.pop_back();
+    if (!levels[level][node].intersects(area))
+    {
+      continue;
+    }
+    if (level == 0)
+    {
+      visit(order[node]);
+      continue;
+    }
+    std::size_t end = std::min((node + 1) * fanout, levels[level - 1].size());
+    for (std::size_t child = node * fanout; child < end; ++child)
+    {
+      pending.emplace_back(level - 1, child);
+    }
+  }
+}
+
+#endif
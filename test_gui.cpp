@@ -6,8 +6,24 @@
 #include "main_window.hpp"
 #include "message_widget.hpp"
 #include "repl_widget.hpp"
-
+#include "qgraphics_arc_item.hpp"
+#include "qgraphics_batch_item.hpp"
+#include "qt_interpreter.hpp"
+#include "scene_file.hpp"
+#include "scene_renderer.hpp"
+#include "vector_writer.hpp"
+
+#include <cmath>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <vector>
+
+// The whole text of a written file
+static std::string readFile(const QString &name) {
+  std::ifstream in(name.toStdString());
+  return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
 
 // ADD YOUR TESTS TO THIS CLASS !!!!!!!
 class TestGUI : public QObject {
@@ -53,6 +69,21 @@ private slots:
   void testAlternatingMessages();
   void testClearCanvas();
   void testListExpression();
+  void testEscapeCancelsEvaluation();
+  void testClearRemovesEveryLayer();
+  void testFailedEntryKeepsItsLayer();
+  void testMessageHistoryIsBounded();
+  void testExportedSvg();
+  void testSvgArcSweep();
+  void testSvgFullCircle();
+  void testSvgViewBox();
+  void testExportedSceneReadsBack();
+  void testTiledRenderMatchesScene();
+  void testBatchContainsAgreesWithItems();
+  void testSmallBatchesAreSeparateItems();
+  void testArcItemPaintsItsSpan();
+  void testDrawingIsSentOncePerFrame();
+  void testFailedEntrySendsItsBatchFirst();
 
   
 private:
@@ -104,6 +135,7 @@ void TestGUI::testREPLGood()
   // send a string to the repl widget
   QTest::keyClicks(replEdit, "(define a 1)");
   QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+  QVERIFY(w.waitForResults());
 
   // check message
   QVERIFY2(messageEdit->isReadOnly(), "Expected QLineEdit inside MessageWidget to be read-only.");
@@ -118,6 +150,7 @@ void TestGUI::testREPLBad()
   // send a string to the repl widget
   QTest::keyClicks(replEdit, "(foo)");
   QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+  QVERIFY(w.waitForResults());
 
   // check message
   QVERIFY2(messageEdit->isReadOnly(),
@@ -139,6 +172,7 @@ void TestGUI::testREPLBad2Good() {
   // send a string to the repl widget
   QTest::keyClicks(replEdit, "(foo)");
   QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+  QVERIFY(w.waitForResults());
 
   // check message
   QVERIFY2(messageEdit->isReadOnly(),
@@ -154,6 +188,7 @@ void TestGUI::testREPLBad2Good() {
   // send a string to the repl widget
   QTest::keyClicks(replEdit, "(define value 100)");
   QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+  QVERIFY(w.waitForResults());
 
   // check message
   QVERIFY2(messageEdit->isReadOnly(),
@@ -176,6 +211,7 @@ void TestGUI::testPoint() {
   // send a string to the repl widget
   QTest::keyClicks(replEdit, "(draw (point 0 0))");
   QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+  QVERIFY(w.waitForResults());
 
   // check canvas
   QVERIFY2(scene->itemAt(QPointF(0, 0), QTransform()) != 0,
@@ -190,6 +226,7 @@ void TestGUI::testLine()
   // send a string to the repl widget
   QTest::keyClicks(replEdit, "(draw (line (point 10 0) (point 0 10)))");
   QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+  QVERIFY(w.waitForResults());
   
   // check canvas
   QVERIFY2(scene->itemAt(QPointF(10, 0), QTransform()) != 0,
@@ -206,6 +243,7 @@ void TestGUI::testArc()
   // send a string to the repl widget
   QTest::keyClicks(replEdit, "(draw (arc (point 0 0) (point 100 0) pi))");
   QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+  QVERIFY(w.waitForResults());
 
   // check canvas
   QVERIFY2(scene->itemAt(QPointF(100, 0), QTransform()) != 0,
@@ -229,6 +267,7 @@ void TestGUI::testEnvRestore() {
   // send a string to the repl widget
   QTest::keyClicks(replEdit, "(begin (draw (point -20 0)) (define pi 3))");
   QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+  QVERIFY(w.waitForResults());
 
   // check canvas
   QGraphicsItem * temp = scene->itemAt(QPointF(-20, 0), QTransform());
@@ -262,6 +301,7 @@ void TestGUI::testEmptyREPLInput()
     // Send an empty string to the repl widget
     QTest::keyClicks(replEdit, "   ");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     // Check message - expecting no change or specific handling of empty input
     QCOMPARE(messageEdit->text(), QString("Error: failed to parse the expression."));
@@ -285,6 +325,7 @@ void TestGUI::testMultipleCommandsInSingleInput()
 {
     QTest::keyClicks(replEdit, "(define x 10) (define y 20)");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     QCOMPARE(messageEdit->text(), QString("Error: failed to parse the expression."));
 }
@@ -293,6 +334,7 @@ void TestGUI::testDrawWithNegativeCoordinates()
 {
     QTest::keyClicks(replEdit, "(draw (point -50 -50))");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     QVERIFY2(scene->itemAt(QPointF(-50, -50), QTransform()) != nullptr,
         "Expected a point at negative coordinates in the scene. Not found.");
@@ -303,10 +345,12 @@ void TestGUI::testClearCanvas()
     // Draw something first
     QTest::keyClicks(replEdit, "(draw (point 10 10))");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     // Clear the canvas
     QTest::keyClicks(replEdit, "(clear)");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     QVERIFY2(scene->items().isEmpty(), "Expected the canvas to be cleared.");
 }
@@ -315,6 +359,7 @@ void TestGUI::testREPLInputWithExcessiveWhitespace()
 {
     QTest::keyClicks(replEdit, "     (define    z    30)     ");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     QCOMPARE(messageEdit->text(), QString("Error: failed to parse the expression."));
 }
@@ -326,6 +371,7 @@ void TestGUI::testArcWithZeroRadius()
 
     QTest::keyClicks(replEdit, "(draw (arc (point 0 0) (point 0 0) 0))");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     // Check if nothing is drawn on the canvas
     QVERIFY2(scene->itemAt(QPointF(0, 0), QTransform()) == nullptr,
@@ -339,6 +385,7 @@ void TestGUI::testArcWithNegativeRadius()
 
     QTest::keyClicks(replEdit, "(draw (arc (point 0 0) (point -10 0) -pi))");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     // Check if the arc is handled gracefully
     QVERIFY2(scene->itemAt(QPointF(-10, 0), QTransform()) == nullptr,
@@ -352,6 +399,7 @@ void TestGUI::testFullCircleArc()
 
     QTest::keyClicks(replEdit, "(draw (arc (point 0 0) (point 10 0) 6.283))"); // 2*PI radians
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     // Check if a full circle is drawn
     QVERIFY2(scene->itemAt(QPointF(10, 0), QTransform()) != nullptr,
@@ -365,6 +413,7 @@ void TestGUI::testArcWithTinySpanAngle()
 
     QTest::keyClicks(replEdit, "(draw (arc (point 0 0) (point 10 0) 0.0001))");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     // Check if the arc is drawn correctly
     QVERIFY2(scene->itemAt(QPointF(10, 0), QTransform()) != nullptr,
@@ -376,6 +425,7 @@ void TestGUI::testDrawAndRemoveMultipleItems()
     // Draw multiple items
     QTest::keyClicks(replEdit, "(begin (draw (point 10 10)) (draw (line (point 20 20) (point 30 30))) (draw (arc (point 40 40) (point 50 40) pi)))");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     // Check if items are drawn
     QVERIFY2(!scene->items().isEmpty(), "Expected multiple items in the scene.");
@@ -383,6 +433,7 @@ void TestGUI::testDrawAndRemoveMultipleItems()
     // Clear the canvas
     QTest::keyClicks(replEdit, "(clear)");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     // Check if canvas is cleared
     QVERIFY2(scene->items().isEmpty(), "Expected the canvas to be cleared after removal.");
@@ -392,6 +443,7 @@ void TestGUI::testDrawItemsWithLargeCoordinates()
 {
     QTest::keyClicks(replEdit, "(draw (point 10000 10000))");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     // Check if the item with large coordinates is drawn
     QVERIFY2(scene->itemAt(QPointF(10000, 10000), QTransform()) != nullptr,
@@ -404,6 +456,7 @@ void TestGUI::testContinuousDrawing()
     {
         QTest::keyClicks(replEdit, QString("(draw (point %1 %1))").arg(i * 10));
         QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+        QVERIFY(w.waitForResults());
     }
     // Check if multiple items are drawn
     QVERIFY2(scene->items().count() == 10, "Expected 10 points in the scene.");
@@ -423,6 +476,7 @@ void TestGUI::testLargeExpressionInREPL()
 
     QTest::keyClicks(replEdit, largeExpression);
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     // Check for successful processing or error handling
     QVERIFY2(!messageEdit->text().contains("Error"), "Large expression caused an error.");
@@ -442,6 +496,7 @@ void TestGUI::testDrawingOverlappingItems()
 {
     QTest::keyClicks(replEdit, "(begin (draw (point 50 50)) (draw (point 50 50)))");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     // Check if both points are drawn at the same location
     QList<QGraphicsItem*> itemsAtLocation = scene->items(QPointF(50, 50));
@@ -453,8 +508,10 @@ void TestGUI::testREPLHistoryNavigation()
     // Enter a few commands
     QTest::keyClicks(replEdit, "(define a 10)");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
     QTest::keyClicks(replEdit, "(define b 20)");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     // Navigate back in history
     QTest::keyClick(replEdit, Qt::Key_Up, Qt::NoModifier);
@@ -473,18 +530,22 @@ void TestGUI::testBooleanExpression()
 {
     QTest::keyClicks(replEdit, "(not False)");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
     QCOMPARE(messageEdit->text(), QString("True"));
 
     QTest::keyClicks(replEdit, "(not True)");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
     QCOMPARE(messageEdit->text(), QString("False"));
 
     QTest::keyClicks(replEdit, "(and False True)");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
     QCOMPARE(messageEdit->text(), QString("False"));
 
     QTest::keyClicks(replEdit, "(or False True)");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
     QCOMPARE(messageEdit->text(), QString("True"));
 }
 
@@ -492,8 +553,10 @@ void TestGUI::testMemoryLeakPrevention()
 {
     QTest::keyClicks(replEdit, "(draw (point 10 10))");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
     QTest::keyClicks(replEdit, "(clear)");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
     QCOMPARE(scene->items().count(), 0);
 }
 
@@ -527,10 +590,12 @@ void TestGUI::testConsistentStateAfterError()
 {
     QTest::keyClicks(replEdit, "(foo)");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
     QVERIFY2(messageEdit->text().startsWith("Error"), "Expected error message.");
 
     QTest::keyClicks(replEdit, "(define z 10)");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
     QCOMPARE(messageEdit->text(), QString("(10)"));
 }
 
@@ -538,6 +603,7 @@ void TestGUI::testSyntaxErrors()
 {
     QTest::keyClicks(replEdit, "(define r )"); // Incomplete expression
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
     QVERIFY2(messageEdit->text().contains("Error"), "Expected syntax error message.");
 }
 
@@ -558,9 +624,11 @@ void TestGUI::testListExpression()
 {
     QTest::keyClicks(replEdit, "(clear)");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
 
     QTest::keyClicks(replEdit, "(begin (draw (point 1 1)) (draw (point 2 2)))");
     QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
    
     qDebug() << "ITEMS: " << scene->items().count();
 
@@ -569,6 +637,400 @@ void TestGUI::testListExpression()
 
 
 
+void TestGUI::testEscapeCancelsEvaluation()
+{
+    MainWindow window;
+    REPLWidget* replWidget = window.findChild<REPLWidget*>();
+    QLineEdit* input = replWidget->findChild<QLineEdit*>();
+    QLineEdit* output = window.findChild<MessageWidget*>()->findChild<QLineEdit*>();
+
+    // an endless loop runs until escape cancels it
+    QTest::keyClicks(input, "(begin (define n 0) (while True (set! n (+ n 1))))");
+    QTest::keyClick(input, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(!window.waitForResults(100));
+    QTest::keyClick(replWidget, Qt::Key_Escape, Qt::NoModifier);
+    QVERIFY2(window.waitForResults(), "Expected escape to stop the evaluation.");
+
+    // the worker is free for the next entry
+    QTest::keyClicks(input, "(define m 1)");
+    QTest::keyClick(input, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(window.waitForResults());
+    QCOMPARE(output->text(), QString("(1)"));
+}
+
+void TestGUI::testClearRemovesEveryLayer()
+{
+    MainWindow window;
+    QLineEdit* input = window.findChild<REPLWidget*>()->findChild<QLineEdit*>();
+    QGraphicsScene* drawing = window.findChild<CanvasWidget*>()->findChild<QGraphicsScene*>();
+
+    QTest::keyClicks(input, "(draw (point 10 10))");
+    QTest::keyClick(input, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(window.waitForResults());
+    QTest::keyClicks(input, "(draw (line (point 0 0) (point 20 20)))");
+    QTest::keyClick(input, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(window.waitForResults());
+    int items = drawing->items().count();
+    QVERIFY(items >= 2);
+
+    // an entry evaluated again replaces only its own layer
+    QTest::keyClicks(input, "(draw (point 10 10))");
+    QTest::keyClick(input, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(window.waitForResults());
+    QCOMPARE(drawing->items().count(), items);
+
+    // (clear) removes the layers of every entry, and a later entry starts over
+    QTest::keyClicks(input, "(clear)");
+    QTest::keyClick(input, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(window.waitForResults());
+    QVERIFY(drawing->items().isEmpty());
+    QTest::keyClicks(input, "(draw (point 10 10))");
+    QTest::keyClick(input, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(window.waitForResults());
+    QVERIFY(!drawing->items().isEmpty());
+    QVERIFY(drawing->items().count() < items);
+}
+
+void TestGUI::testFailedEntryKeepsItsLayer()
+{
+    MainWindow window;
+    QLineEdit* input = window.findChild<REPLWidget*>()->findChild<QLineEdit*>();
+    QGraphicsScene* drawing = window.findChild<CanvasWidget*>()->findChild<QGraphicsScene*>();
+    QString entry = "(begin (draw (point 30 30)) (draw (if ok (point 40 40) 1)))";
+
+    QTest::keyClicks(input, "(define ok True)");
+    QTest::keyClick(input, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(window.waitForResults());
+    QTest::keyClicks(input, entry);
+    QTest::keyClick(input, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(window.waitForResults());
+    int items = drawing->items().count();
+    QVERIFY(items >= 1);
+
+    // the same entry fails after drawing part of its layer again
+    QTest::keyClicks(input, "(set! ok False)");
+    QTest::keyClick(input, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(window.waitForResults());
+    QTest::keyClicks(input, entry);
+    QTest::keyClick(input, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(window.waitForResults());
+
+    // a failing re-evaluation keeps the previous layer, and only that
+    QCOMPARE(drawing->items().count(), items);
+}
+
+void TestGUI::testMessageHistoryIsBounded()
+{
+    const int size = MessageWidget::historySize;
+    unsigned long dropped = message->dropped();
+    for (int i = 0; i < size + 10; ++i) {
+        message->info(QString("message %1").arg(i));
+    }
+    QTest::keyClicks(replEdit, "(foo)");
+    QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+    QVERIFY(w.waitForResults());
+
+    // the oldest messages fall out, the newest is the error just shown
+    QList<MessageWidget::Message> history = message->history();
+    QCOMPARE(history.size(), size);
+    QVERIFY(message->dropped() >= dropped + 11);
+    QCOMPARE(history.last().severity, MessageWidget::Error);
+    QCOMPARE(history.last().text, messageEdit->text());
+    QCOMPARE(history[history.size() - 2].text, QString("message %1").arg(size + 9));
+}
+
+void TestGUI::testExportedSvg()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString name = dir.filePath("drawing.svg");
+
+    // what is drawn goes to the writer, as for sldraw --export
+    QtInterpreter exporter;
+    SvgWriter writer(name.toStdString());
+    exporter.setWriter(&writer);
+    exporter.parseAndEvaluate("(begin (draw (point 1 2)) (draw (line (point 0 0) (point 10 10))) (draw (arc (point 0 0) (point 5 0) pi)))");
+    exporter.setWriter(nullptr);
+    QVERIFY(writer.finish());
+
+    std::string text = readFile(name);
+    QVERIFY(text.find("<svg") != std::string::npos);
+    QVERIFY(text.find("<ellipse") != std::string::npos);
+    QVERIFY(text.find("<line") != std::string::npos);
+    QVERIFY(text.find("<path") != std::string::npos);
+    QVERIFY(text.find("</svg>") != std::string::npos);
+}
+
+void TestGUI::testSvgArcSweep()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString name = dir.filePath("arcs.svg");
+    SvgWriter writer(name.toStdString());
+    writer.arc(0, 0, 10, M_PI / 2);
+    writer.arc(0, 0, 10, -M_PI / 2);
+    writer.arc(0, 0, 10, 3 * M_PI / 2);
+    QVERIFY(writer.finish());
+
+    // a positive span turns counterclockwise on screen, where y grows
+    // downwards, so it ends above the center with the negative sweep flag
+    std::string text = readFile(name);
+    QVERIFY(text.find("M 10 0 A 10 10 0 0 0 ") != std::string::npos);
+    QVERIFY(text.find(" -10\"/>") != std::string::npos);
+    QVERIFY(text.find("M 10 0 A 10 10 0 0 1 ") != std::string::npos);
+    QVERIFY(text.find(" 10\"/>") != std::string::npos);
+    // more than half a turn takes the large arc
+    QVERIFY(text.find("M 10 0 A 10 10 0 1 0 ") != std::string::npos);
+}
+
+void TestGUI::testSvgFullCircle()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString name = dir.filePath("circle.svg");
+    SvgWriter writer(name.toStdString());
+    writer.arc(5, 5, 10, 2 * M_PI);
+    writer.arc(5, 5, -10, -2 * M_PI);
+    writer.arc(5, 5, 10, 0);
+    QVERIFY(writer.finish());
+
+    // a whole turn either way is a circle, since a path arc cannot close
+    // on its start point, and an empty span draws nothing
+    std::string text = readFile(name);
+    std::string circle = "<circle cx=\"5\" cy=\"5\" r=\"10\"/>";
+    std::size_t first = text.find(circle);
+    QVERIFY(first != std::string::npos);
+    QVERIFY(text.find(circle, first + 1) != std::string::npos);
+    QVERIFY(text.find("<path") == std::string::npos);
+}
+
+void TestGUI::testSvgViewBox()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QString name = dir.filePath("box.svg");
+    SvgWriter writer(name.toStdString());
+    writer.line(0, 0, 10, 20);
+    QVERIFY(writer.finish());
+
+    // the bounds and half the pen width fill the room left in the header,
+    // and the elements follow it as they were written
+    std::string text = readFile(name);
+    std::size_t start = text.find("<svg ");
+    std::size_t end = text.find(">", start);
+    QVERIFY(start != std::string::npos && end != std::string::npos);
+    std::string header = text.substr(start, end - start);
+    QVERIFY(header.find(" width=\"11\" height=\"21\" viewBox=\"-0.5 -0.5 11 21\"") != std::string::npos);
+    QVERIFY(header.find_last_not_of(' ') < header.size() - 1);
+    QVERIFY(text.compare(end, 2, ">\n") == 0);
+    QVERIFY(text.find("<line x1=\"0\" y1=\"0\" x2=\"10\" y2=\"20\"/>") > end);
+
+    // an empty drawing has an empty view box
+    QString emptyName = dir.filePath("empty.svg");
+    SvgWriter empty(emptyName.toStdString());
+    QVERIFY(empty.finish());
+    QVERIFY(readFile(emptyName).find("viewBox=\"0 0 0 0\"") != std::string::npos);
+}
+
+void TestGUI::testExportedSceneReadsBack()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    std::string sceneName = dir.filePath("drawing.slscene").toStdString();
+
+    // what is drawn goes to the writer, as for sldraw --export
+    QtInterpreter exporter;
+    SceneWriter writer(sceneName);
+    exporter.setWriter(&writer);
+    exporter.parseAndEvaluate("(begin (draw (point 1 2)) (draw (line (point 0 0) (point 10 10))) (draw (arc (point 0 0) (point 5 0) pi)))");
+    exporter.setWriter(nullptr);
+    QVERIFY(writer.finish());
+
+    // a scene file is read in place from memory aligned to 8 bytes
+    std::ifstream sceneFile(sceneName, std::ios::binary | std::ios::ate);
+    QVERIFY(sceneFile.good());
+    std::size_t size = static_cast<std::size_t>(sceneFile.tellg());
+    std::vector<double> buffer((size + 7) / 8);
+    sceneFile.seekg(0);
+    sceneFile.read(reinterpret_cast<char*>(buffer.data()), size);
+    std::vector<SceneChunk> chunks;
+    Box bounds;
+    QVERIFY(readScene(reinterpret_cast<const unsigned char*>(buffer.data()), size, chunks, bounds));
+    QCOMPARE(chunks.size(), std::size_t(3));
+    for (const SceneChunk& chunk : chunks) {
+        QCOMPARE(chunk.count, std::uint32_t(1));
+    }
+    QVERIFY(bounds.minX < 0 && bounds.maxX > 10 && bounds.maxY > 10);
+
+    // the window shows a saved scene without evaluating anything
+    MainWindow window(sceneName);
+    QGraphicsScene* shown = window.findChild<CanvasWidget*>()->findChild<QGraphicsScene*>();
+    QVERIFY(!shown->items().isEmpty());
+}
+
+void TestGUI::testTiledRenderMatchesScene()
+{
+    // the line crosses the tile edge at x = 256 and the circle the edges at
+    // x = 256 and y = 256 of a 600 by 400 image, centered on the origin
+    QGraphicsScene scene;
+    scene.addLine(-200, -100, 200, 100);
+    scene.addEllipse(-60, 40, 60, 60);
+    scene.addRect(-150, -90, 10, 10);
+    QSize size(600, 400);
+    QImage tiled = renderScene(scene, size);
+
+    // the whole image painted at once, at the same place and scale
+    QImage reference(size, QImage::Format_ARGB32_Premultiplied);
+    reference.fill(Qt::white);
+    QRectF source(scene.itemsBoundingRect().center() - QPointF(size.width() / 2.0, size.height() / 2.0), QSizeF(size));
+    QPainter painter(&reference);
+    painter.setRenderHint(QPainter::Antialiasing);
+    scene.render(&painter, QRectF(reference.rect()), source);
+    painter.end();
+
+    QCOMPARE(tiled.size(), reference.size());
+    int differing = 0, painted = 0;
+    for (int y = 0; y < size.height(); ++y) {
+        for (int x = 0; x < size.width(); ++x) {
+            QRgb a = tiled.pixel(x, y), b = reference.pixel(x, y);
+            // antialiased edges may round differently where a tile clips them
+            if (std::abs(qRed(a) - qRed(b)) > 8 || std::abs(qGreen(a) - qGreen(b)) > 8 || std::abs(qBlue(a) - qBlue(b)) > 8) {
+                ++differing;
+            }
+            if (b != qRgb(255, 255, 255)) {
+                ++painted;
+            }
+        }
+    }
+    QVERIFY(painted > 400);
+    QCOMPARE(differing, 0);
+}
+
+void TestGUI::testBatchContainsAgreesWithItems()
+{
+    QGraphicsBatchItem batch;
+    batch.addPoint(10, 10);
+    batch.addLine(0, 0, 40, 0);
+    batch.addArc(60, 60, 10, M_PI);
+    QList<QGraphicsItem *> items = batch.separateItems();
+    QCOMPARE(items.size(), batch.count());
+
+    // probes clear of the pen's edge, where the shapes of the items and
+    // the distances the batch measures may round apart
+    QList<QPointF> inside = {QPointF(10.5, 10.5), QPointF(20, 0.2), QPointF(60, 60), QPointF(60, 65)};
+    QList<QPointF> outside = {QPointF(13, 10.5), QPointF(20, 3), QPointF(60, 75), QPointF(100, 100)};
+    for (const QPointF &probe : inside + outside) {
+        bool inItem = false;
+        for (QGraphicsItem *item : items) {
+            inItem = inItem || item->contains(probe);
+        }
+        QCOMPARE(batch.contains(probe), inItem);
+        QCOMPARE(inItem, inside.contains(probe));
+    }
+    qDeleteAll(items);
+}
+
+void TestGUI::testSmallBatchesAreSeparateItems()
+{
+    QtInterpreter interpreter;
+    QSignalSpy batches(&interpreter, &QtInterpreter::drawGraphicBatch);
+
+    // a few primitives go to the scene one item each
+    interpreter.parseAndEvaluate("(begin (draw (point 1 1)) (draw (line (point 0 0) (point 5 5))) (draw (arc (point 0 0) (point 5 0) pi)))");
+    QCOMPARE(batches.count(), 1);
+    QList<QGraphicsItem *> few = batches.takeFirst().at(0).value<QList<QGraphicsItem *>>();
+    QCOMPARE(few.size(), 3);
+    for (QGraphicsItem *item : few) {
+        QVERIFY(dynamic_cast<QGraphicsBatchItem *>(item) == nullptr);
+    }
+    qDeleteAll(few);
+
+    // many are packed, unless a frame passed while drawing them
+    interpreter.parseAndEvaluate("(draw (map (lambda (t) (point t t)) (range 0 1000 1)))");
+    QVERIFY(batches.count() >= 1);
+    int packed = 0, primitives = 0;
+    while (!batches.isEmpty()) {
+        QList<QGraphicsItem *> items = batches.takeFirst().at(0).value<QList<QGraphicsItem *>>();
+        for (QGraphicsItem *item : items) {
+            QGraphicsBatchItem *batch = dynamic_cast<QGraphicsBatchItem *>(item);
+            packed += batch != nullptr;
+            primitives += batch != nullptr ? batch->count() : 1;
+        }
+        qDeleteAll(items);
+    }
+    QVERIFY(packed >= 1);
+    QCOMPARE(primitives, 1000);
+}
+
+void TestGUI::testArcItemPaintsItsSpan()
+{
+    // painted as the span was once converted to 1/16 degrees on each paint
+    QImage expected(64, 64, QImage::Format_ARGB32_Premultiplied);
+    expected.fill(Qt::white);
+    QPainter reference(&expected);
+    reference.setPen(Qt::black);
+    reference.drawArc(QRectF(12, 12, 40, 40), 0, static_cast<int>(2.5 * (180 / M_PI) * 16));
+    reference.end();
+
+    // the span is converted once, so painting again draws the same arc
+    QGraphicsArcItem arc(32, 32, 20, 2.5);
+    QStyleOptionGraphicsItem option;
+    for (int paints = 0; paints < 2; ++paints) {
+        QImage image(64, 64, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        arc.paint(&painter, &option, nullptr);
+        painter.end();
+        QCOMPARE(image, expected);
+    }
+}
+
+void TestGUI::testDrawingIsSentOncePerFrame()
+{
+    QtInterpreter interpreter;
+    int batches = 0, primitives = 0;
+    connect(&interpreter, &QtInterpreter::drawGraphicBatch, [&](QList<QGraphicsItem *> items) {
+        ++batches;
+        for (QGraphicsItem *item : items) {
+            QGraphicsBatchItem *batch = dynamic_cast<QGraphicsBatchItem *>(item);
+            primitives += batch != nullptr ? batch->count() : 1;
+        }
+        qDeleteAll(items);
+    });
+
+    // a batch per frame of 16 ms the evaluation takes, and one at the end
+    QElapsedTimer timer;
+    timer.start();
+    interpreter.parseAndEvaluate("(draw (map (lambda (t) (point t t)) (range 0 20000 1)))");
+    qint64 elapsed = timer.elapsed();
+    QCOMPARE(primitives, 20000);
+    QVERIFY(batches >= 1);
+    QVERIFY(batches <= elapsed / 16 + 1);
+}
+
+void TestGUI::testFailedEntrySendsItsBatchFirst()
+{
+    QtInterpreter interpreter;
+    interpreter.parseAndEvaluate("(define bad True)");
+
+    QStringList order;
+    int drawn = 0;
+    connect(&interpreter, &QtInterpreter::drawGraphicBatch, [&](QList<QGraphicsItem *> items) {
+        order << "batch";
+        drawn += items.size();
+        qDeleteAll(items);
+    });
+    connect(&interpreter, &QtInterpreter::layerFinished, [&](bool succeeded) {
+        order << (succeeded ? "layer" : "failed layer");
+    });
+    connect(&interpreter, &QtInterpreter::error, [&](QString) { order << "error"; });
+
+    // the last form fails as it runs, after two points are queued
+    interpreter.parseAndEvaluate("(begin (draw (point 1 1)) (draw (point 2 2)) (draw (if bad 1 (point 3 3))))");
+    QCOMPARE(drawn, 2);
+    QCOMPARE(order, QStringList({"batch", "failed layer", "error"}));
+}
+
 void TestGUI::cleanupTestCase() 
 {
 
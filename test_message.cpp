@@ -12,6 +12,7 @@ private slots:
 
   void initTestCase();
   void testConstructor();
+  void testHistory();
   
 private:
 
@@ -38,6 +39,26 @@ void TestMessage::testConstructor() {
   QCOMPARE(messageEdit->text(), QString(""));
 }
 
+void TestMessage::testHistory() {
+
+  // a burst of messages keeps the latest in the history and on display
+  const int size = MessageWidget::historySize;
+  for (int i = 0; i < 300; ++i) {
+    message.info(QString::number(i));
+  }
+  message.flush();
+  QCOMPARE(messageEdit->text(), QString("299"));
+  QCOMPARE(message.history().size(), size);
+  QCOMPARE(message.history().front().text, QString::number(300 - size));
+  QCOMPARE(message.dropped(), 300ul - size);
+  QVERIFY2(message.coalesced() > 0, "Expected a burst of messages to be coalesced.");
+
+  // a change of severity is shown at once
+  message.error("Error: failed");
+  QCOMPARE(messageEdit->text(), QString("Error: failed"));
+  QVERIFY(message.history().back().severity == MessageWidget::Error);
+}
+
 
 QTEST_MAIN(TestMessage)
 #include "test_message.moc"
@@ -0,0 +1,113 @@
+#include "thread_pool.hpp"
+
+ThreadPool & ThreadPool::instance()
+{
+  static ThreadPool pool(std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 0);
+  return pool;
+}
+
+ThreadPool::ThreadPool(std::size_t workers): next(0)
+{
+  for (std::size_t i = 0; i < workers; ++i)
+  {
+    threads.emplace_back(&ThreadPool::work, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto & thread : threads)
+  {
+    thread.join();
+  }
+}
+
+std::size_t ThreadPool::size() const
+{
+  return threads.size() + 1;
+}
+
+void ThreadPool::run(std::size_t n, const Task & f)
+{
+  std::unique_lock<std::mutex> busy(running, std::try_to_lock);
+  if (!busy.owns_lock() || threads.empty() || n < 2)
+  {
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      f(i);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    task = &f;
+    count = n;
+    next = 0;
+    pending = threads.size();
+    error = nullptr;
+    ++generation;
+  }
+  wake.notify_all();
+  drain();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  finished.wait(lock, [this] { return pending == 0; });
+  task = nullptr;
+  if (error)
+  {
+    std::exception_ptr thrown = error;
+    error = nullptr;
+    std::rethrow_exception(thrown);
+  }
+}
+
+// Takes iterations of the current loop until none are left
+void ThreadPool::drain()
+{
+  for (std::size_t i = next++; i < count; i = next++)
+  {
+    try
+    {
+      (*task)(i);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error)
+      {
+        error = std::current_exception();
+      }
+    }
+  }
+}
+
+void ThreadPool::work()
+{
+  unsigned long seen = 0;
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [&] { return stopping || generation != seen; });
+      if (stopping)
+      {
+        return;
+      }
+      seen = generation;
+    }
+    drain();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (--pending == 0)
+      {
+        finished.notify_one();
+      }
+    }
+  }
+}
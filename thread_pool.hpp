@@ -0,0 +1,56 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+// system includes
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads, started on first use, that run the
+// iterations of one parallel loop at a time
+class ThreadPool{
+public:
+  typedef std::function<void(std::size_t)> Task;
+
+  // The pool of the process, with a worker per additional hardware thread
+  static ThreadPool & instance();
+
+  explicit ThreadPool(std::size_t workers);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool & operator=(const ThreadPool &) = delete;
+
+  // Threads a loop runs on, the calling one included
+  std::size_t size() const;
+
+  // Calls task(i) for every i < count on the workers and the calling thread,
+  // in no particular order, and returns once all calls have returned.
+  // The first exception thrown by a call is rethrown. While another loop
+  // is running, the calls are all made on the calling thread.
+  void run(std::size_t count, const Task & task);
+
+private:
+  void work();
+  void drain();
+
+  std::vector<std::thread> threads;
+  std::mutex running; // held by the thread whose loop the workers run
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable finished;
+  const Task * task = nullptr;
+  std::size_t count = 0;
+  std::atomic<std::size_t> next;
+  std::size_t pending = 0;       // workers yet to finish the current loop
+  unsigned long generation = 0;  // loops started so far
+  bool stopping = false;
+  std::exception_ptr error;
+};
+
+#endif
@@ -1,9 +1,144 @@
 #include "tokenize.hpp"
 #include <cctype>
+#include <cstdint>
+#include <cstdlib>
 
 #include <iostream>
 
-TokenSequenceType tokenize(std::istream & seq)
+#include "interpreter_semantic_error.hpp"
+
+bool parseNumber(const char * text, double & number)
+{
+  // powers of ten exactly representable as doubles
+  static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  const char * p = text;
+  bool negative = *p == '-';
+  if (*p == '-' || *p == '+')
+  {
+	  ++p;
+  }
+
+  // the significant digits, 10^exponent times the value
+  std::uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool truncated = false;
+  bool any = false;
+  for (; std::isdigit(static_cast<unsigned char>(*p)); ++p)
+  {
+	  any = true;
+	  if (digits < 19)
+	  {
+		  mantissa = mantissa * 10 + (*p - '0');
+		  digits += mantissa != 0;
+	  }
+	  else
+	  {
+		  ++exponent;
+		  truncated = true;
+	  }
+  }
+  if (*p == '.')
+  {
+	  for (++p; std::isdigit(static_cast<unsigned char>(*p)); ++p)
+	  {
+		  any = true;
+		  if (digits < 19)
+		  {
+			  mantissa = mantissa * 10 + (*p - '0');
+			  digits += mantissa != 0;
+			  --exponent;
+		  }
+		  else
+		  {
+			  truncated = true;
+		  }
+	  }
+  }
+  if (!any)
+  {
+	  return false;
+  }
+  if (*p == 'e' || *p == 'E')
+  {
+	  ++p;
+	  bool negativeExponent = *p == '-';
+	  if (*p == '-' || *p == '+')
+	  {
+		  ++p;
+	  }
+	  if (!std::isdigit(static_cast<unsigned char>(*p)))
+	  {
+		  return false;
+	  }
+	  int e = 0;
+	  for (; std::isdigit(static_cast<unsigned char>(*p)); ++p)
+	  {
+		  e = e < 100000 ? e * 10 + (*p - '0') : e;
+	  }
+	  exponent += negativeExponent ? -e : e;
+  }
+  if (*p != '\0')
+  {
+	  return false;
+  }
+
+  // one correctly rounded operation on exact operands gives the correctly rounded value
+  if (!truncated && mantissa <= (std::uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+  {
+	  double value = static_cast<double>(mantissa);
+	  value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+	  number = negative ? -value : value;
+	  return true;
+  }
+  char * stop = nullptr;
+  number = std::strtod(text, &stop);
+  return *stop == '\0';
+}
+
+// Reads the numbers of a vector literal after its "#(", up to the closing
+// parenthesis, straight from the stream buffer
+static void readVectorLiteral(std::istream & seq, std::vector<double> & values)
+{
+  std::streambuf * buffer = seq.rdbuf();
+  char number[64];
+  std::size_t length = 0;
+  for (int c = buffer->sbumpc(); c != std::char_traits<char>::eof(); c = buffer->sbumpc())
+  {
+	  if (c == CLOSE || std::isspace(c))
+	  {
+		  if (length != 0)
+		  {
+			  number[length] = '\0';
+			  double value;
+			  if (!parseNumber(number, value))
+			  {
+				  throw InterpreterSemanticError("Error: invalid number in vector literal.");
+			  }
+			  values.push_back(value);
+			  length = 0;
+		  }
+		  if (c == CLOSE)
+		  {
+			  return;
+		  }
+	  }
+	  else if (length + 1 < sizeof(number))
+	  {
+		  number[length++] = static_cast<char>(c);
+	  }
+	  else
+	  {
+		  throw InterpreterSemanticError("Error: invalid number in vector literal.");
+	  }
+  }
+  seq.setstate(std::ios::eofbit);
+  throw InterpreterSemanticError("Error: expected closing parenthesis of vector literal.");
+}
+
+static TokenSequenceType tokenize(std::istream & seq, VectorLiterals * literals)
 {
   TokenSequenceType tokens;
 
@@ -26,6 +161,13 @@ TokenSequenceType tokenize(std::istream & seq)
 	  {
 		  inComment = true;
 	  }
+	  else if (c == '#' && literals != nullptr && token.empty() && seq.peek() == OPEN)
+	  {
+		  seq.get(c);
+		  literals->emplace_back();
+		  readVectorLiteral(seq, literals->back());
+		  tokens.push_back("#(" + std::to_string(literals->size() - 1));
+	  }
 	  else if (c == OPEN || c == CLOSE)
 	  {
 		  // Handle parentheses as individual tokens
@@ -57,3 +199,13 @@ TokenSequenceType tokenize(std::istream & seq)
 	
   return tokens;
 }
+
+TokenSequenceType tokenize(std::istream & seq)
+{
+  return tokenize(seq, nullptr);
+}
+
+TokenSequenceType tokenize(std::istream & seq, VectorLiterals & literals)
+{
+  return tokenize(seq, &literals);
+}
@@ -3,9 +3,14 @@
 
 #include <istream>
 #include <deque>
+#include <string>
+#include <vector>
 
 typedef std::deque<std::string> TokenSequenceType;
 
+// The numbers of the vector literals found by tokenize, in order
+typedef std::vector<std::vector<double>> VectorLiterals;
+
 const char OPEN = '(';
 const char CLOSE = ')';
 const char COMMENT = ';';
@@ -15,4 +20,15 @@ const char COMMENT = ';';
 // ignores any whitespace and from any ";" to end-of-line
 TokenSequenceType tokenize(std::istream & seq);
 
+// as above, but a vector literal such as #(1 2.5 -3e2) is parsed straight
+// into literals, with no token per number. It appears in the tokens as
+// "#(" followed by its index in literals.
+// Throws InterpreterSemanticError on a malformed vector literal.
+TokenSequenceType tokenize(std::istream & seq, VectorLiterals & literals);
+
+// parse the decimal number in the nul-terminated text, returning false if
+// it is not one. Numbers of up to 19 significant digits with exponents of
+// at most 22 are converted exactly without calling the C library.
+bool parseNumber(const char * text, double & number);
+
 #endif
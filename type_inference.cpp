@@ -0,0 +1,468 @@
+#include "type_inference.hpp"
+
+// system includes
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+
+// module includes
+#include "interpreter_semantic_error.hpp"
+#include "closure.hpp"
+#include "point_buffer.hpp"
+
+// Signatures of the builtins registered in Environment::Environment()
+static const Signature signatures[] = {
+  {"not", notProcedure, notUnchecked, 1, 1, {BooleanType, BooleanType, BooleanType}, BooleanType},
+  {"and", andProcedure, andUnchecked, 2, SIZE_MAX, {BooleanType, BooleanType, BooleanType}, BooleanType},
+  {"or", orProcedure, orUnchecked, 2, SIZE_MAX, {BooleanType, BooleanType, BooleanType}, BooleanType},
+  {"<", lessThanProcedure, lessThanUnchecked, 2, 2, {NumberType, NumberType, NumberType}, BooleanType},
+  {"<=", lessThanOrEqualProcedure, lessThanOrEqualUnchecked, 2, 2, {NumberType, NumberType, NumberType}, BooleanType},
+  {">", greaterThanProcedure, greaterThanUnchecked, 2, 2, {NumberType, NumberType, NumberType}, BooleanType},
+  {">=", greaterThanOrEqualProcedure, greaterThanOrEqualUnchecked, 2, 2, {NumberType, NumberType, NumberType}, BooleanType},
+  {"=", equalProcedure, equalUnchecked, 2, 2, {NumberType, NumberType, NumberType}, BooleanType},
+  {"+", ADDProcedure, ADDUnchecked, 2, SIZE_MAX, {NumberType, NumberType, NumberType}, NumberType},
+  {"-", subtractProcedure, subtractUnchecked, 1, 2, {NumberType, NumberType, NumberType}, NumberType},
+  {"*", multiplyProcedure, multiplyUnchecked, 2, SIZE_MAX, {NumberType, NumberType, NumberType}, NumberType},
+  {"/", divideProcedure, divideUnchecked, 2, 2, {NumberType, NumberType, NumberType}, NumberType},
+  {"log10", log10Procedure, log10Unchecked, 1, 1, {NumberType, NumberType, NumberType}, NumberType},
+  {"pow", powProcedure, powUnchecked, 2, 2, {NumberType, NumberType, NumberType}, NumberType},
+  {"point", pointProcedure, pointUnchecked, 2, 2, {NumberType, NumberType, NumberType}, PointType},
+  {"line", lineProcedure, lineUnchecked, 2, 2, {PointType, PointType, PointType}, LineType},
+  {"arc", arcProcedure, arcUnchecked, 3, 3, {PointType, PointType, NumberType}, ArcType},
+  {"sin", sinProcedure, sinUnchecked, 1, 1, {NumberType, NumberType, NumberType}, NumberType},
+  {"cos", cosProcedure, cosUnchecked, 1, 1, {NumberType, NumberType, NumberType}, NumberType},
+  {"arctan", arctanProcedure, arctanUnchecked, 2, 2, {NumberType, NumberType, NumberType}, NumberType},
+};
+
+const Signature * findSignature(Procedure procedure)
+{
+  for (const Signature& signature : signatures)
+  {
+    if (signature.checked == procedure)
+    {
+      return &signature;
+    }
+  }
+  return nullptr;
+}
+
+// Names used in error messages
+static std::string typeName(Type type)
+{
+  switch (type)
+  {
+  case BooleanType: return "Boolean";
+  case NumberType: return "Number";
+  case SymbolType: return "Symbol";
+  case ListType: return "List";
+  case PointType: return "Point";
+  case LineType: return "Line";
+  case ArcType: return "Arc";
+  case LambdaType: return "Procedure";
+  case SequenceType: return "Sequence";
+  case VectorType: return "Vector";
+  case MaskType: return "Mask";
+  case PointsType: return "Points";
+  case PolylineType: return "Polyline";
+  case PolygonType: return "Polygon";
+  default: return "None";
+  }
+}
+
+// true for the builtins that apply elementwise to vectors and masks
+static bool broadcasts(const Signature& signature)
+{
+  return signature.result != PointType && signature.result != LineType && signature.result != ArcType;
+}
+
+static bool isGraphic(Type type)
+{
+  return type == PointType || type == LineType || type == ArcType || isShape(type);
+}
+
+// Within the pass NoneType stands for "not known statically".
+// Types of symbols defined by the program shadow those of the environment.
+typedef std::map<Symbol, Type> Scope;
+
+class TypeInference
+{
+public:
+  TypeInference(const Environment& environment, bool annotateCalls): env(environment), annotate(annotateCalls) {}
+
+  Type infer(const Expression& expr, Scope& scope);
+
+  TypeInferenceStats collectStats() const;
+
+private:
+  Type inferSymbol(const Symbol& symbol, const Scope& scope);
+  Type inferCall(const Expression& expr, Scope& scope);
+
+  const Environment& env;
+  bool annotate;
+
+  // A subtree shared by hash consing is visited once per occurrence.
+  // Its call sites keep a signature only if it was proven at every one.
+  std::set<const Expression*> visited;
+  std::vector<const Expression*> provenSites;
+  std::size_t callSites = 0;
+};
+
+Type TypeInference::inferSymbol(const Symbol& symbol, const Scope& scope)
+{
+  auto it = scope.find(symbol);
+  if (it != scope.end())
+  {
+    return it->second;
+  }
+  const Expression * value = env.lookupExpression(symbol);
+  if (value != nullptr && value->tail.empty())
+  {
+    return value->head.type;
+  }
+  return NoneType;
+}
+
+Type TypeInference::infer(const Expression& expr, Scope& scope)
+{
+  if (expr.tail.empty())
+  {
+    if (expr.head.type == SymbolType)
+    {
+      return inferSymbol(expr.head.value.sym_value, scope);
+    }
+    return expr.head.type;
+  }
+  if (expr.head.type == ListType)
+  {
+    // (f) is the value of f unless f is a closure, which it calls
+    Type function = infer(expr.tail[0], scope);
+    for (std::size_t i = 1; i < expr.tail.size(); ++i)
+    {
+      infer(expr.tail[i], scope);
+    }
+    return expr.tail.size() == 1 && function != LambdaType ? function : NoneType;
+  }
+  if (expr.head.type != SymbolType)
+  {
+    return NoneType;
+  }
+
+  const Symbol& symbol = expr.head.value.sym_value;
+  if (symbol == "if")
+  {
+    if (expr.tail.size() != 3)
+    {
+      return NoneType;
+    }
+    Type condition = infer(expr.tail[0], scope);
+    if (condition != NoneType && condition != BooleanType)
+    {
+      throw InterpreterSemanticError("Error: Conditional in 'if' is not a boolean.");
+    }
+
+    // Definitions made in only one branch keep their type, conflicting ones are unknown
+    Scope consequentScope = scope;
+    Scope alternativeScope = scope;
+    Type consequent = infer(expr.tail[1], consequentScope);
+    Type alternative = infer(expr.tail[2], alternativeScope);
+    for (const auto& binding : consequentScope)
+    {
+      scope[binding.first] = binding.second;
+    }
+    for (const auto& binding : alternativeScope)
+    {
+      auto it = scope.find(binding.first);
+      if (it != scope.end() && it->second != binding.second)
+      {
+        it->second = NoneType;
+      }
+      else
+      {
+        scope[binding.first] = binding.second;
+      }
+    }
+    return consequent == alternative ? consequent : NoneType;
+  }
+  if (symbol == "lambda")
+  {
+    // parameters are unknown; definitions in the body happen only if it is called
+    std::vector<Symbol> params;
+    if (!boundNames(expr, params))
+    {
+      return NoneType;
+    }
+    Scope body = scope;
+    for (const auto& param : params)
+    {
+      body[param] = NoneType;
+    }
+    infer(expr.tail[1], body);
+    return LambdaType;
+  }
+  if (symbol == "let")
+  {
+    std::vector<Symbol> names;
+    if (!boundNames(expr, names))
+    {
+      return NoneType;
+    }
+    // let bound variables are never reassigned, so keep the type of their value
+    std::vector<Type> values;
+    for (const auto& binding : expr.tail[0].tail)
+    {
+      values.push_back(infer(binding.tail[0], scope));
+    }
+    Scope body = scope;
+    for (std::size_t i = 0; i < names.size(); ++i)
+    {
+      body[names[i]] = values[i];
+    }
+    return infer(expr.tail[1], body);
+  }
+  if (symbol == "while")
+  {
+    if (expr.tail.size() != 2)
+    {
+      return NoneType;
+    }
+    Type condition = infer(expr.tail[0], scope);
+    if (condition != NoneType && condition != BooleanType)
+    {
+      throw InterpreterSemanticError("Error: Condition in 'while' is not a boolean.");
+    }
+    Scope body = scope;
+    infer(expr.tail[1], body);
+    return NoneType;
+  }
+  if (symbol == "dotimes" || symbol == "for" || symbol == "repeat")
+  {
+    std::vector<Symbol> names;
+    if (!boundNames(expr, names))
+    {
+      return NoneType;
+    }
+    std::vector<Type> bounds;
+    for (const auto& bound : expr.tail[0].tail)
+    {
+      bounds.push_back(infer(bound, scope));
+    }
+    Scope body = scope;
+    if (symbol != "repeat")
+    {
+      body[names[0]] = NumberType;
+      infer(expr.tail[1], body);
+      return NoneType;
+    }
+
+    // the accumulator keeps the type of its initial value if the body preserves it
+    infer(expr.tail[1], scope);
+    Type initial = bounds[0];
+    body[names[0]] = initial;
+    if (initial != NoneType && infer(expr.tail[2], body) == initial)
+    {
+      return initial;
+    }
+    body = scope;
+    body[names[0]] = NoneType;
+    infer(expr.tail[2], body);
+    return NoneType;
+  }
+  if (symbol == "map" || symbol == "iterate")
+  {
+    // the function operand may name a builtin, which is not a variable
+    for (std::size_t i = 1; i < expr.tail.size(); ++i)
+    {
+      infer(expr.tail[i], scope);
+    }
+    if (!expr.tail.empty() && !expr.tail[0].tail.empty())
+    {
+      infer(expr.tail[0], scope);
+    }
+    return SequenceType;
+  }
+  if (symbol == "set!")
+  {
+    // set! keeps the type of the variable, checked at run time
+    return expr.tail.size() == 2 ? infer(expr.tail[1], scope) : NoneType;
+  }
+  if (symbol == "begin")
+  {
+    Type last = NoneType;
+    for (const auto& e : expr.tail)
+    {
+      last = infer(e, scope);
+    }
+    return last;
+  }
+  if (symbol == "define")
+  {
+    if (expr.tail.size() != 2 || expr.tail[0].head.type != SymbolType)
+    {
+      return NoneType;
+    }
+    Type value = infer(expr.tail[1], scope);
+    const Symbol& variable = expr.tail[0].head.value.sym_value;
+    if (env.lookupExpression(variable) == nullptr)
+    {
+      scope[variable] = value;
+    }
+    return value;
+  }
+  return inferCall(expr, scope);
+}
+
+Type TypeInference::inferCall(const Expression& expr, Scope& scope)
+{
+  const Symbol& symbol = expr.head.value.sym_value;
+
+  std::vector<Type> argTypes;
+  argTypes.reserve(expr.tail.size());
+  for (const auto& e : expr.tail)
+  {
+    argTypes.push_back(infer(e, scope));
+  }
+
+  bool firstVisit = visited.insert(&expr).second;
+  if (firstVisit && annotate)
+  {
+    expr.signature = nullptr;
+  }
+
+  // A name rebound by the program, or unknown to the environment, stays dynamic
+  Procedure procedure = scope.count(symbol) != 0 ? nullptr : env.lookupProcedure(symbol);
+  if (procedure == nullptr)
+  {
+    if (annotate)
+    {
+      expr.signature = nullptr;
+    }
+    return NoneType;
+  }
+
+  if (procedure == drawProcedure)
+  {
+    for (std::size_t i = 0; i < argTypes.size(); ++i)
+    {
+      if (argTypes[i] != NoneType && argTypes[i] != SequenceType && argTypes[i] != ListType && !isGraphic(argTypes[i]))
+      {
+        throw InterpreterSemanticError("Error: Static type error in call to 'draw': argument " + std::to_string(i + 1) +
+                                       " is " + typeName(argTypes[i]) + ", expected Point, Line, Arc, shape, Sequence or List.");
+      }
+    }
+    // a list may hold one graphic or several
+    if (argTypes.size() == 1)
+    {
+      return argTypes[0] == ListType ? NoneType : argTypes[0];
+    }
+    return argTypes.empty() ? NoneType : ListType;
+  }
+  if (procedure == rangeProcedure || procedure == takeProcedure)
+  {
+    return SequenceType;
+  }
+  if (procedure == vectorProcedure || procedure == linspaceProcedure)
+  {
+    return VectorType;
+  }
+  if (procedure == pointsProcedure)
+  {
+    return PointsType;
+  }
+  if (procedure == polylineProcedure)
+  {
+    return PolylineType;
+  }
+  if (procedure == polygonProcedure)
+  {
+    return PolygonType;
+  }
+  if (procedure == sumProcedure || procedure == minProcedure || procedure == maxProcedure ||
+      procedure == meanProcedure || procedure == dotProcedure)
+  {
+    return NumberType;
+  }
+
+  const Signature * signature = findSignature(procedure);
+  if (signature == nullptr)
+  {
+    return NoneType;
+  }
+  ++callSites;
+
+  if (argTypes.size() < signature->minArgs || argTypes.size() > signature->maxArgs)
+  {
+    throw InterpreterSemanticError("Error: Static type error in call to '" + symbol + "': wrong number of arguments (" +
+                                   std::to_string(argTypes.size()) + ").");
+  }
+
+  // Numbers and booleans broadcast over vectors and masks (see number_vector.hpp),
+  // so with an unknown argument the result may be packed and is unknown too
+  bool proven = true;
+  bool packed = false;
+  for (std::size_t i = 0; i < argTypes.size(); ++i)
+  {
+    Type expected = signature->params[i < 2 ? i : 2];
+    if (argTypes[i] == NoneType)
+    {
+      proven = false;
+    }
+    else if (broadcasts(*signature) && ((argTypes[i] == VectorType && expected == NumberType) ||
+                                        (argTypes[i] == MaskType && expected == BooleanType)))
+    {
+      proven = false;
+      packed = true;
+    }
+    else if (argTypes[i] != expected)
+    {
+      throw InterpreterSemanticError("Error: Static type error in call to '" + symbol + "': argument " + std::to_string(i + 1) +
+                                     " is " + typeName(argTypes[i]) + ", expected " + typeName(expected) + ".");
+    }
+  }
+
+  Type result = signature->result;
+  if (broadcasts(*signature) && !proven)
+  {
+    result = !packed ? NoneType : result == NumberType ? VectorType : MaskType;
+  }
+  if (!annotate)
+  {
+    return result;
+  }
+  if (!proven)
+  {
+    expr.signature = nullptr;
+  }
+  else if (firstVisit)
+  {
+    expr.signature = signature;
+  }
+  if (proven)
+  {
+    provenSites.push_back(&expr);
+  }
+  return result;
+}
+
+TypeInferenceStats TypeInference::collectStats() const
+{
+  TypeInferenceStats stats;
+  stats.callSites = callSites;
+  for (const Expression * site : provenSites)
+  {
+    if (site->signature != nullptr)
+    {
+      ++stats.provenCallSites;
+      stats.removedChecks += site->tail.size() + 1;
+    }
+  }
+  return stats;
+}
+
+TypeInferenceStats inferTypes(const Expression& ast, const Environment& env, bool annotate)
+{
+  TypeInference inference(env, annotate);
+  Scope scope;
+  inference.infer(ast, scope);
+  return inference.collectStats();
+}
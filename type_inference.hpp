@@ -0,0 +1,40 @@
+#ifndef TYPE_INFERENCE_HPP
+#define TYPE_INFERENCE_HPP
+
+// system includes
+#include <cstddef>
+
+// module includes
+#include "expression.hpp"
+#include "environment.hpp"
+
+// The static signature of a builtin procedure.
+// Parameter i has type params[i], the last entry repeats for variadic builtins.
+struct Signature{
+  const char * name;
+  Procedure checked;    // the builtin as registered by Environment
+  Procedure unchecked;  // variant called once the arguments are proven
+  std::size_t minArgs;
+  std::size_t maxArgs;
+  Type params[3];
+  Type result;
+};
+
+// Counts gathered by one run of type inference
+struct TypeInferenceStats{
+  std::size_t callSites = 0;       // builtin call sites visited
+  std::size_t provenCallSites = 0; // call sites switched to unchecked variants
+  std::size_t removedChecks = 0;   // arity and argument type checks removed
+};
+
+// Returns the signature of a builtin procedure, or nullptr
+const Signature * findSignature(Procedure procedure);
+
+// Infers the type of every node of ast, using the builtin signatures and the
+// bindings of env together with those made by define inside ast.
+// If annotate is true, call sites whose arguments are proven are annotated
+// with their Signature so the evaluator calls the unchecked variant.
+// Throws InterpreterSemanticError if the program is statically ill-typed.
+TypeInferenceStats inferTypes(const Expression& ast, const Environment& env, bool annotate = true);
+
+#endif
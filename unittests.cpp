@@ -7,8 +7,22 @@
 #include "tokenize.hpp"
 #include "interpreter.hpp"
 #include "interpreter_semantic_error.hpp"
-
+#include "constant_folding.hpp"
+#include "hash_consing.hpp"
+#include "number_vector.hpp"
+#include "thread_pool.hpp"
+#include "fast_math.hpp"
+#include "point_buffer.hpp"
+#include "spatial_index.hpp"
+#include "scene_file.hpp"
+
+#include <cmath>
+#include <random>
 #include <sstream>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 using namespace std;
 
 static Expression run(const std::string& program)
@@ -811,3 +825,915 @@ TEST_CASE("test arc", "[interpreter]")
 }
 
 
+
+TEST_CASE("Inline caches follow environment changes", "[interpreter]")
+{
+    Interpreter interp;
+
+    {
+        std::istringstream iss("(define a 2)");
+        REQUIRE(interp.parse(iss));
+        REQUIRE(interp.eval() == Expression(2.));
+    }
+
+    std::istringstream iss("(+ a (* a 3))");
+    REQUIRE(interp.parse(iss));
+
+    // repeated evaluation of the same AST hits the cached bindings
+    REQUIRE(interp.eval() == Expression(8.));
+    REQUIRE(interp.eval() == Expression(8.));
+
+    // a reset drops the definition of a, so the cached slot must not be used
+    interp.resetEnvironment();
+    REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+}
+
+TEST_CASE("Environment version changes on every binding", "[environment]")
+{
+    Environment env;
+    unsigned long initial = env.getVersion();
+
+    env.addSymbol("x", Expression(1.));
+    REQUIRE(env.getVersion() != initial);
+
+    Environment copy(env);
+    REQUIRE(copy.getVersion() != env.getVersion());
+    REQUIRE(copy.lookupExpression("x") != env.lookupExpression("x"));
+    REQUIRE(env.lookupProcedure("x") == nullptr);
+    REQUIRE(env.lookupProcedure("+") != nullptr);
+}
+
+TEST_CASE("Type inference proves builtin call sites", "[types]")
+{
+    Interpreter interp;
+
+    std::istringstream iss("(begin (define a 2) (point a (+ a (* a 3))))");
+    REQUIRE(interp.parse(iss));
+    REQUIRE(interp.eval() == Expression(std::make_tuple(2., 8.)));
+
+    const TypeInferenceStats& stats = interp.typeInferenceStats();
+    REQUIRE(stats.callSites == 3);
+    REQUIRE(stats.provenCallSites == 3);
+    REQUIRE(stats.removedChecks == 9);
+}
+
+TEST_CASE("Type inference rejects ill-typed programs before evaluation", "[types]")
+{
+    Interpreter interp;
+
+    // never reached at run time, but statically ill-typed
+    std::istringstream iss("(begin (define b 1) (if True b (+ True 1)))");
+    REQUIRE(interp.parse(iss));
+    REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+    REQUIRE_FALSE(interp.isSymbolStringDefined("b"));
+
+    std::istringstream iss2("(line (point 0 0) 1)");
+    REQUIRE(interp.parse(iss2));
+    REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+}
+
+TEST_CASE("Unchecked builtins keep value checks", "[types]")
+{
+    REQUIRE_THROWS_AS(run("(/ 1 (- 1 1))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(log10 (- 0 1))"), InterpreterSemanticError);
+
+    // a procedure name rebound to a value is left to the dynamic checks
+    REQUIRE_THROWS_AS(run("(begin (define sin 2) (sin 1))"), InterpreterSemanticError);
+}
+
+static Expression parseOnly(const std::string& program)
+{
+    std::istringstream iss(program);
+    TokenSequenceType tokens = tokenize(iss);
+    auto token = tokens.begin();
+    Interpreter interp;
+    return interp.parseExpression(token, tokens.end());
+}
+
+TEST_CASE("Constant folding of closed subexpressions", "[folding]")
+{
+    Environment env;
+
+    Expression ast = parseOnly("(begin (define r 2) (* r (* 2 pi)) (if (< 1 2) (cos 0) r))");
+    REQUIRE(foldConstants(ast, env) == 5);
+
+    REQUIRE(ast.tail.size() == 3);
+    REQUIRE(ast.tail[1].tail[1] == Expression(2 * atan2(0, -1)));
+    REQUIRE(ast.tail[2] == Expression(1.));
+
+    // within let bindings and the arguments of a lambda called in place,
+    // but not the calls that name a variable the let binds
+    Expression let = parseOnly("(let ((a (+ 1 2)) (cos (cos 0))) (+ a (cos 0)))");
+    REQUIRE(foldConstants(let, env) == 1);
+    REQUIRE(let.tail[0].tail[0].tail[0] == Expression(3.));
+    Expression call = parseOnly("((lambda (x) (* x 2)) (- 5 1))");
+    REQUIRE(foldConstants(call, env) == 1);
+    REQUIRE(call.tail[1] == Expression(4.));
+    REQUIRE(run("(let ((a (+ 1 2)) (cos (cos 0))) (+ a cos))") == Expression(4.));
+    REQUIRE(run("((lambda (x) (* x 2)) (- 5 1))") == Expression(8.));
+}
+
+TEST_CASE("Constant folding preserves run time errors", "[folding]")
+{
+    Environment env;
+
+    Expression division = parseOnly("(+ 1 (/ 1 0))");
+    REQUIRE(foldConstants(division, env) == 0);
+    REQUIRE_THROWS_AS(run("(+ 1 (/ 1 0))"), InterpreterSemanticError);
+
+    // a builtin the program rebinds is not folded
+    Expression shadowed = parseOnly("(begin (define cos 1) (cos 0))");
+    REQUIRE(foldConstants(shadowed, env) == 0);
+    REQUIRE_THROWS_AS(run("(begin (define cos 1) (cos 0))"), InterpreterSemanticError);
+
+    REQUIRE(run("(if (> 1 2) (/ 1 0) (point 1 pi))") == Expression(std::make_tuple(1., atan2(0, -1))));
+}
+
+TEST_CASE("Hash consing shares identical subtrees", "[hashcons]")
+{
+    Expression ast = parseOnly("(begin (line (point 1 2) (point 3 4)) (line (point 1 2) (point 3 4)) (point 1 2))");
+
+    REQUIRE(ast.tail[0].tail.storage() == ast.tail[1].tail.storage());
+    REQUIRE(ast.tail[0].tail[0].tail.storage() == ast.tail[2].tail.storage());
+    REQUIRE(ast.tail[0].hash() == ast.tail[1].hash());
+    REQUIRE(ast.tail[0].hash() != ast.tail[2].hash());
+
+    // writing through one occurrence leaves the others untouched
+    Expression copy = ast;
+    copy.tail[0].tail[0] = Expression(5.);
+    REQUIRE(copy.tail[0].tail.storage() != ast.tail[0].tail.storage());
+    REQUIRE(ast.tail[0].tail[0].head.type == SymbolType);
+    REQUIRE(ast.tail[1].tail[0].head.type == SymbolType);
+}
+
+TEST_CASE("Common subexpressions are evaluated once per evaluation", "[hashcons]")
+{
+    Environment env;
+    Expression ast = parseOnly("(begin (define a 2) (+ (* a (cos a)) (* a (cos a))))");
+    REQUIRE(eliminateCommonSubexpressions(ast, env) == 2);
+
+    REQUIRE(run("(begin (define a 2) (+ (* a (cos a)) (* a (cos a))))") == Expression(4 * std::cos(2.)));
+
+    // a define between two occurrences invalidates the memoized value
+    REQUIRE(run("(begin (define a 2) (define b (sin a)) (define c (sin a)) (+ b c))") == Expression(2 * std::sin(2.)));
+}
+
+TEST_CASE("Pass options select the optimisation level", "[passes]")
+{
+    PassOptions options;
+    REQUIRE(options.level == 2);
+    REQUIRE(parsePassOption("-O0", options));
+    REQUIRE(options.level == 0);
+    REQUIRE(parsePassOption("--time-passes", options));
+    REQUIRE(options.timePasses);
+    REQUIRE_FALSE(parsePassOption("-O3", options));
+    REQUIRE_FALSE(parsePassOption("program.slp", options));
+
+    // -O0 keeps every runtime check but still rejects ill-typed programs
+    Interpreter interp;
+    interp.setPassOptions(options);
+    std::istringstream iss("(begin (define a 2) (point a (+ a (* 2 3))))");
+    REQUIRE(interp.parse(iss));
+    REQUIRE(interp.eval() == Expression(std::make_tuple(2., 8.)));
+    REQUIRE(interp.typeInferenceStats().provenCallSites == 0);
+
+    std::ostringstream report;
+    interp.reportPassTimings(report);
+    REQUIRE(report.str().find("type-check (1 run)") != std::string::npos);
+    REQUIRE(report.str().find("constant-folding") == std::string::npos);
+
+    std::istringstream iss2("(if True 1 (+ True 1))");
+    REQUIRE(interp.parse(iss2));
+    REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+}
+
+static std::vector<std::string> passLog;
+static void firstPass(Expression&, const Environment&, PassResults&) { passLog.push_back("first"); }
+static void secondPass(Expression&, const Environment&, PassResults&) { passLog.push_back("second"); }
+static void thirdPass(Expression&, const Environment&, PassResults&) { passLog.push_back("third"); }
+
+TEST_CASE("Pass manager orders passes by their dependencies", "[passes]")
+{
+    Environment env;
+    Expression ast = parseOnly("(+ 1 2)");
+
+    PassManager manager;
+    manager.registerPass(Pass{"third", thirdPass, 2, {"second"}, false});
+    manager.registerPass(Pass{"second", secondPass, 1, {"first"}, true});
+    manager.registerPass(Pass{"first", firstPass, 0, {}, false});
+
+    passLog.clear();
+    manager.run(ast, env);
+    REQUIRE((passLog == std::vector<std::string>{"first", "second", "third"}));
+
+    passLog.clear();
+    manager.rerun(ast, env);
+    REQUIRE((passLog == std::vector<std::string>{"second"}));
+
+    PassOptions options;
+    options.level = 1;
+    manager.setOptions(options);
+    passLog.clear();
+    manager.run(ast, env);
+    REQUIRE((passLog == std::vector<std::string>{"first", "second"}));
+
+    PassManager unknown;
+    unknown.registerPass(Pass{"first", firstPass, 0, {"missing"}, false});
+    REQUIRE_THROWS_AS(unknown.run(ast, env), std::logic_error);
+
+    PassManager cycle;
+    cycle.registerPass(Pass{"first", firstPass, 0, {"second"}, false});
+    cycle.registerPass(Pass{"second", secondPass, 0, {"first"}, false});
+    REQUIRE_THROWS_AS(cycle.run(ast, env), std::logic_error);
+}
+
+TEST_CASE("AST verifier rejects malformed trees", "[passes]")
+{
+    PassResults results;
+    REQUIRE_NOTHROW(verifyAST(parseOnly("(begin (define a 1) (+ a 2))"), results, "test"));
+
+    Expression bad(1.);
+    bad.tail.push_back(Expression(2.));
+    REQUIRE_THROWS_AS(verifyAST(bad, results, "test"), std::logic_error);
+
+    Expression slot = parseOnly("(+ 1 2)");
+    slot.cseSlot = 0;
+    REQUIRE_THROWS_AS(verifyAST(slot, results, "test"), std::logic_error);
+}
+
+TEST_CASE("Lambda creates closures called like builtins", "[lambda]")
+{
+    REQUIRE(run("(begin (define sq (lambda (x) (* x x))) (sq 3))") == Expression(9.));
+    REQUIRE(run("(begin (define fact (lambda (n) (if (< n 2) 1 (* n (fact (- n 1)))))) (fact 5))") == Expression(120.));
+    REQUIRE(run("(begin (define mid (lambda (a b) (point (/ (+ a b) 2) b))) (mid 1 3))") == Expression(std::make_tuple(2., 3.)));
+
+    // free variables are captured by value, through every enclosing lambda
+    REQUIRE(run("(begin (define adder (lambda (a) (lambda (b) (+ a b)))) (define add3 (adder 3)) (add3 4))") == Expression(7.));
+    REQUIRE(run("(begin (define k (lambda (a) (lambda (b) (lambda (c) (+ a (+ b c)))))) (define k1 (k 1)) (define k2 (k1 10)) (k2 100))") == Expression(111.));
+    REQUIRE(run("(begin (define twice (lambda (f x) (f (f x)))) (define inc (lambda (x) (+ x 1))) (twice inc 0))") == Expression(2.));
+
+    // parameters shadow builtins and globals
+    REQUIRE(run("(begin (define a 2) (define g (lambda (a) (+ (sin a) (sin a)))) (+ (sin a) (g 0)))") == Expression(std::sin(2.)));
+    REQUIRE(run("(begin (define d (lambda (pi) (* pi 2))) (d 1))") == Expression(2.));
+
+    REQUIRE_THROWS_AS(run("(begin (define f (lambda (x) x)) (f 1 2))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(lambda (x x) x)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(lambda (if) 1)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(lambda (x) (define x 1))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(+ (lambda (x) x) 1)"), InterpreterSemanticError);
+}
+
+TEST_CASE("Lambda takes no parameters and is called at the head of a list", "[lambda]")
+{
+    // () is an empty parameter list, and (f) calls a closure with no arguments
+    REQUIRE(run("(begin (define five (lambda () 5)) (five))") == Expression(5.));
+    REQUIRE(run("(begin (define k (lambda (n) (lambda () n))) ((k 4)))") == Expression(4.));
+    REQUIRE(run("(let () 3)") == Expression(3.));
+    REQUIRE_THROWS_AS(run("(begin (define five (lambda () 5)) (five 1))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(begin (define f (lambda (x) x)) (f))"), InterpreterSemanticError);
+
+    // (f) of any other value is still that value
+    REQUIRE(run("(begin (define answer 42) (answer))") == Expression(42.));
+    REQUIRE(run("(let ((x 2)) (x))") == Expression(2.));
+
+    // the parameters are a list, never a bare symbol
+    REQUIRE(run("((lambda (x) x) 1)") == Expression(1.));
+    REQUIRE_THROWS_AS(run("(lambda x x)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(lambda (x 1) x)"), InterpreterSemanticError);
+
+    // a lambda expression, or any call returning a closure, heads a call
+    REQUIRE(run("((lambda (x y) (+ x y)) 1 2)") == Expression(3.));
+    REQUIRE(run("((lambda () 7))") == Expression(7.));
+    REQUIRE(run("(begin (define adder (lambda (a) (lambda (b) (+ a b)))) ((adder 3) 4))") == Expression(7.));
+    REQUIRE(run("(let ((a 10)) ((lambda (b) (+ a b)) 1))") == Expression(11.));
+    REQUIRE(run("((lambda (n) (begin (define loop (lambda (k) (if (= k 0) 0 (loop (- k 1))))) (loop n))) 100000)") == Expression(0.));
+    REQUIRE_THROWS_AS(run("((lambda (x) x))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("((+ 1 2) 3)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(+ () 1)"), InterpreterSemanticError);
+}
+
+TEST_CASE("Let binds variables in frame slots", "[lambda]")
+{
+    REQUIRE(run("(let ((x 1) (y 2)) (+ x y))") == Expression(3.));
+    REQUIRE(run("(let ((cos 1)) (+ cos 1))") == Expression(2.));
+
+    // values are computed in the enclosing scope
+    REQUIRE(run("(let ((k 1)) (let ((k 2) (j k)) (+ k j)))") == Expression(3.));
+    REQUIRE(run("(begin (define g (let ((y 4)) (lambda (x) (+ x y)))) (g 1))") == Expression(5.));
+    REQUIRE(run("(begin (define f (lambda (n) (let ((m (* n 2))) (+ m 1)))) (+ (f 1) (f 2)))") == Expression(8.));
+
+    REQUIRE_THROWS_AS(run("(let ((f 1)) (f 2))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(let (x 1) x)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(let ((x 1)) (define x 2))"), InterpreterSemanticError);
+}
+
+TEST_CASE("Closures outlive the program that created them", "[lambda]")
+{
+    Interpreter interp;
+
+    std::istringstream iss("(define scale (let ((k 3)) (lambda (x) (* k x))))");
+    REQUIRE(interp.parse(iss));
+    REQUIRE(interp.eval().head.type == LambdaType);
+
+    std::istringstream iss2("(scale 2)");
+    REQUIRE(interp.parse(iss2));
+    REQUIRE(interp.eval() == Expression(6.));
+}
+
+TEST_CASE("Tail calls run in constant stack", "[tailcall]")
+{
+    REQUIRE(run("(begin (define loop (lambda (n acc) (if (= n 0) acc (loop (- n 1) (+ acc 1))))) (loop 200000 0))") == Expression(200000.));
+    REQUIRE(run("(begin (define even (lambda (n) (if (= n 0) True (odd (- n 1))))) "
+                "(define odd (lambda (n) (if (= n 0) False (even (- n 1))))) (even 100001))") == Expression(false));
+    REQUIRE(run("(begin (define count (lambda (n) (let ((m (- n 1))) (begin (if (< m 0) n (count m)))))) (count 100000))") == Expression(0.));
+}
+
+TEST_CASE("Deep non-tail recursion is an error, not a crash", "[tailcall]")
+{
+    Interpreter interp;
+
+    std::istringstream iss("(begin (define f (lambda (n) (if (= n 0) 0 (+ 1 (f (- n 1)))))) (f 1000000))");
+    REQUIRE(interp.parse(iss));
+    REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+
+    std::istringstream iss2("(f 100)");
+    REQUIRE(interp.parse(iss2));
+    REQUIRE(interp.eval() == Expression(100.));
+}
+
+
+TEST_CASE("Loops iterate without recursion", "[loops]")
+{
+    REQUIRE(run("(begin (define n 0) (while (< n 10) (set! n (+ n 1))) n)") == Expression(10.));
+    REQUIRE(run("(while False 1)") == Expression(false));
+    REQUIRE(run("(begin (define s 0) (dotimes (i 5) (set! s (+ s i))) s)") == Expression(10.));
+    REQUIRE(run("(begin (define s 0) (for (i 1 2 0.25) (set! s (+ s i))) s)") == Expression(5.5));
+    REQUIRE(run("(begin (define s 0) (for (i 3 0 -1) (set! s (+ s i))) s)") == Expression(6.));
+    REQUIRE(run("(dotimes (i 1000000) (draw (line (point 0 0) (point i i))))") == Expression(std::make_tuple(0., 0.), std::make_tuple(999999., 999999.)));
+    REQUIRE(run("(repeat (acc 1) 10 (* acc 2))") == Expression(1024.));
+    REQUIRE(run("(repeat (p (point 0 0)) 0 (point 1 1))") == Expression(std::make_tuple(0., 0.)));
+    // a fractional count rounds up, as counting while below it does, and NaN runs no iteration
+    REQUIRE(run("(repeat (acc 1) 2.5 (* acc 2))") == Expression(8.));
+    REQUIRE(run("(repeat (acc 1) (- (pow 10 400) (pow 10 400)) (* acc 2))") == Expression(1.));
+
+    REQUIRE_THROWS_AS(run("(while 1 2)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(dotimes (i True) 1)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(for (i 0 1 0) 1)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(repeat (acc 1) -1 acc)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(begin (dotimes (i 2) 1) i)"), InterpreterSemanticError);
+}
+
+TEST_CASE("Set! assigns without changing the type", "[loops]")
+{
+    REQUIRE(run("(let ((x 1)) (begin (set! x 5) x))") == Expression(5.));
+    REQUIRE(run("(begin (define f (lambda (x) (begin (set! x (* x 2)) x))) (f 4))") == Expression(8.));
+
+    // common subexpressions must not span an assignment
+    REQUIRE(run("(begin (define a 2) (define b (+ a 1)) (set! a 5) (+ (+ a 1) (+ a 1)))") == Expression(12.));
+
+    REQUIRE_THROWS_AS(run("(begin (define a 1) (set! a True))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(set! pi 3)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(set! undefined 3)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(let ((x 1)) (lambda (y) (set! x y)))"), InterpreterSemanticError);
+}
+
+// Evaluates a program producing a sequence and returns its elements
+static std::vector<Expression> elements(const std::string & program)
+{
+    Interpreter interp;
+    std::istringstream iss(program);
+    REQUIRE(interp.parse(iss));
+    Expression sequence = interp.eval();
+    REQUIRE(sequence.head.type == SequenceType);
+    std::vector<Expression> result;
+    interp.forEach(sequence, [&](const Expression & e) { result.push_back(e); });
+    return result;
+}
+
+TEST_CASE("Sequences generate their elements lazily", "[sequence]")
+{
+    REQUIRE((elements("(range 3)") == std::vector<Expression>{Expression(0.), Expression(1.), Expression(2.)}));
+    REQUIRE((elements("(range 1 2 0.5)") == std::vector<Expression>{Expression(1.), Expression(1.5)}));
+    REQUIRE((elements("(range 2 0 -1)") == std::vector<Expression>{Expression(2.), Expression(1.)}));
+    REQUIRE(elements("(range 5 1)").empty());
+    REQUIRE((elements("(map - (range 2))") == std::vector<Expression>{Expression(0.), Expression(-1.)}));
+    REQUIRE((elements("(let ((k 3)) (map (lambda (x) (* k x)) (take 2 (range 10))))") == std::vector<Expression>{Expression(0.), Expression(3.)}));
+    REQUIRE((elements("(take 3 (iterate (lambda (x) (* x 2)) 1))") == std::vector<Expression>{Expression(1.), Expression(2.), Expression(4.)}));
+    REQUIRE(run("(range 3)").head.type == SequenceType);
+
+    REQUIRE_THROWS_AS(run("(range 0 1 0)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(take -1 (range 3))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(map sin 1)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(map 1 (range 3))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(define map 1)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(elements("(map (lambda (x) (+ x True)) (range 3))"), InterpreterSemanticError);
+}
+
+TEST_CASE("Drawing a sequence pulls its elements on demand", "[sequence]")
+{
+    Interpreter interp;
+    std::istringstream iss("(draw (map (lambda (i) (point i (sin i))) (range 1000000)))");
+    REQUIRE(interp.parse(iss));
+    Expression drawn = interp.eval();
+
+    std::size_t count = 0;
+    Expression last;
+    interp.forEach(drawn, [&](const Expression & e) { ++count; last = e; });
+    REQUIRE(count == 1000000);
+    REQUIRE(last == Expression(std::make_tuple(999999., std::sin(999999.))));
+
+    // an infinite source is fine once it is cut short
+    REQUIRE(elements("(draw (take 2 (map (lambda (x) (point x x)) (iterate (lambda (x) (+ x 1)) 5))))").size() == 2);
+
+    REQUIRE_THROWS_AS(run("(draw (iterate (lambda (x) x) 1))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(elements("(draw (range 3))"), InterpreterSemanticError);
+}
+
+TEST_CASE("Numeric builtins broadcast over vectors", "[vector]")
+{
+    REQUIRE(run("(+ (vector 1 2 3) 1 (vector 10 20 30))") == run("(vector 12 23 34)"));
+    REQUIRE(run("(- (vector 1 2))") == run("(vector -1 -2)"));
+    REQUIRE(run("(- 1 (vector 1 2))") == run("(vector 0 -1)"));
+    REQUIRE(run("(* 2 (linspace 0 1 3))") == run("(vector 0 1 2)"));
+    REQUIRE(run("(/ (vector 1 2) 2)") == run("(vector 0.5 1)"));
+    REQUIRE(run("(pow (vector 2 3) 2)") == run("(vector 4 9)"));
+    REQUIRE(run("(cos (vector 0 0))") == run("(vector 1 1)"));
+
+    // numbers the program computes from unknown arguments may be vectors
+    REQUIRE(run("(begin (define f (lambda (x) (+ (+ x 1) 2))) (f (vector 1 2)))") == run("(vector 4 5)"));
+
+    REQUIRE_THROWS_AS(run("(+ (vector 1 2) (vector 1 2 3))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(/ (vector 1 2) (vector 1 0))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(log10 (vector 1 0))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(point (vector 1) 2)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(linspace 0 1 -1)"), InterpreterSemanticError);
+
+    // counts too large to allocate are rejected before allocating
+    REQUIRE_THROWS_AS(run("(linspace 0 1 1e12)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(linspace 0 1 1e300)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(linspace 0 1 (pow 10 400))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(linspace 0 1 (- (pow 10 400) (pow 10 400)))"), InterpreterSemanticError);
+}
+
+TEST_CASE("Comparisons of vectors produce masks", "[vector]")
+{
+    REQUIRE(run("(< (vector 1 2 3 4 5) 3)") == run("(and (< (vector 1 2 3 4 5) 3) True)"));
+    REQUIRE(run("(not (>= (vector 1 2 3) 2))") == run("(< (vector 1 2 3) 2)"));
+    REQUIRE(run("(or (= (vector 1 2 3) 1) (> (vector 1 2 3) 2))") == run("(not (= (vector 1 2 3) 2))"));
+
+    std::ostringstream out;
+    out << run("(<= (vector 1 2 3) (vector 3 2 1))");
+    REQUIRE(out.str() == "#(True True False)");
+
+    REQUIRE_THROWS_AS(run("(if (< (vector 1) 2) 1 2)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(and (< (vector 1) 2) (< (vector 1 2) 2))"), InterpreterSemanticError);
+}
+
+TEST_CASE("Vector kernels agree at every SIMD level", "[vector]")
+{
+    std::vector<std::string> masks;
+    std::vector<Expression> results;
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2})
+    {
+        // 1003 elements leave a remainder after the last full register
+        setSimdLevel(level);
+        results.push_back(run("(begin (define v (linspace -3 4 1003)) (+ (* v 3) (- 1 v) (/ v 7)))"));
+        std::ostringstream out;
+        out << run("(begin (define v (linspace -3 4 1003)) (and (< v 0.5) (not (= v 4))))");
+        masks.push_back(out.str());
+    }
+    setSimdLevel(detectSimdLevel());
+
+    REQUIRE(results[0] == results[1]);
+    REQUIRE(results[0] == results[2]);
+    REQUIRE(masks[0] == masks[1]);
+    REQUIRE(masks[0] == masks[2]);
+}
+
+TEST_CASE("Vector literals are parsed into packed storage", "[vector]")
+{
+    std::istringstream input("(+ #(1 2.5\n -3e2) x)");
+    VectorLiterals literals;
+    TokenSequenceType tokens = tokenize(input, literals);
+    REQUIRE((tokens == TokenSequenceType{"(", "+", "#(0", "x", ")"}));
+    REQUIRE((literals == VectorLiterals{{1, 2.5, -300}}));
+
+    REQUIRE(run("(+ #(1 2.5 -3e2 .5) 1)") == run("(vector 2 3.5 -299 1.5)"));
+    REQUIRE(run("(#(1 2))") == run("(vector 1 2)"));
+    REQUIRE(run("(begin (define v #()) (* v 2))") == run("(linspace 0 1 0)"));
+
+    std::string program = "(+ #(";
+    for (int i = 0; i < 100000; ++i)
+    {
+        program += std::to_string(i) + ".25 ";
+    }
+    program += ") 0)";
+    Expression vector = run(program);
+    REQUIRE(vector.head.type == VectorType);
+    REQUIRE(vector.head.value.vector()->values.size() == 100000);
+    REQUIRE(vector.head.value.vector()->values.back() == 99999.25);
+
+    Interpreter interp;
+    std::istringstream bad1("(+ #(1 x) 1)");
+    REQUIRE_FALSE(interp.parse(bad1));
+    std::istringstream bad2("(+ #(1 2) 1");
+    REQUIRE_FALSE(interp.parse(bad2));
+    std::istringstream bad3("(+ #(1 2 1)");
+    REQUIRE_FALSE(interp.parse(bad3));
+}
+
+TEST_CASE("The number parser rounds like strtod", "[vector]")
+{
+    for (const char * text : {"0.1", "0.3", "-2.5e-3", "123456789012345678901234", "9007199254740993",
+                              "1e22", "1e23", "1.7976931348623157e308", "4.9e-324", "1.", "+.5"})
+    {
+        double number = 0;
+        REQUIRE(parseNumber(text, number));
+        REQUIRE(number == std::strtod(text, nullptr));
+    }
+    double number;
+    for (const char * text : {"", "-", ".", "e5", "1e", "1x", "--1", "1.2.3"})
+    {
+        REQUIRE_FALSE(parseNumber(text, number));
+    }
+}
+
+TEST_CASE("Reductions over numbers and vectors", "[reduce]")
+{
+    REQUIRE(run("(sum 1 2 3)") == Expression(6.));
+    REQUIRE(run("(sum (vector 1 2) 3 (vector 4))") == Expression(10.));
+    REQUIRE(run("(min (vector 3 -1 2) 0)") == Expression(-1.));
+    REQUIRE(run("(max (vector 3 -1 2))") == Expression(3.));
+    REQUIRE(run("(mean (vector 1 2 3 4))") == Expression(2.5));
+    REQUIRE(run("(dot (vector 1 2 3) (vector 4 5 6))") == Expression(32.));
+    REQUIRE(run("(sum #())") == Expression(0.));
+    REQUIRE(run("(+ (sum 1 2) 1)") == Expression(4.));
+
+    REQUIRE_THROWS_AS(run("(min #())"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(mean True)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(dot (vector 1 2) (vector 1))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(dot (vector 1 2) 2)"), InterpreterSemanticError);
+}
+
+TEST_CASE("Large reductions do not depend on threads or SIMD level", "[reduce]")
+{
+    Interpreter interp;
+    std::istringstream define("(define v (sin (linspace 0 1000 1000003)))");
+    REQUIRE(interp.parse(define));
+    interp.eval();
+
+    std::vector<Expression> results;
+    for (bool parallel : {false, true})
+    {
+        for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2})
+        {
+            setParallelReductions(parallel);
+            setSimdLevel(level);
+            std::istringstream iss("(vector (sum v) (dot v v) (min v) (max v) (mean v))");
+            REQUIRE(interp.parse(iss));
+            results.push_back(interp.eval());
+        }
+    }
+    setParallelReductions(true);
+    setSimdLevel(detectSimdLevel());
+
+    // compared exactly, not with the tolerance of Expression equality
+    for (const auto& result : results)
+    {
+        REQUIRE(result.head.value.vector()->values == results[0].head.value.vector()->values);
+    }
+
+    Expression v = run("(sin (linspace 0 1000 1000003))");
+    long double reference = 0;
+    for (Number x : v.head.value.vector()->values)
+    {
+        reference += static_cast<long double>(x) * x;
+    }
+    REQUIRE(std::abs(results[0].head.value.vector()->values[1] - static_cast<double>(reference)) < 1e-6);
+}
+
+TEST_CASE("The thread pool runs every iteration once", "[reduce]")
+{
+    ThreadPool pool(3);
+    std::vector<std::atomic<int>> calls(1000);
+    pool.run(calls.size(), [&](std::size_t i) { ++calls[i]; });
+    for (const auto& count : calls)
+    {
+        REQUIRE(count == 1);
+    }
+
+    REQUIRE_THROWS_AS(pool.run(100, [](std::size_t i) {
+        if (i == 42)
+        {
+            throw InterpreterSemanticError("Error: failed.");
+        }
+    }), InterpreterSemanticError);
+
+    std::atomic<int> total(0);
+    pool.run(10, [&](std::size_t i) { total += static_cast<int>(i); });
+    REQUIRE(total == 45);
+}
+
+// Distance from the exact value in units in the last place of the result
+static double ulpError(double value, long double exact)
+{
+    double rounded = static_cast<double>(exact);
+    double ulp = std::nextafter(std::fabs(rounded), std::numeric_limits<double>::infinity()) - std::fabs(rounded);
+    return static_cast<double>(std::fabs(value - exact) / ulp);
+}
+
+TEST_CASE("Fast math stays within 2 ULP at every SIMD level", "[fastmath]")
+{
+    std::mt19937_64 random(7);
+    std::vector<Number> x, y;
+    for (double range : {1e-3, 1.0, 100.0, 524288.0})
+    {
+        std::uniform_real_distribution<double> uniform(-range, range);
+        for (int i = 0; i < 20000; ++i)
+        {
+            x.push_back(uniform(random));
+            y.push_back(uniform(random) * (i % 2 ? 1 : 1e-3));
+        }
+    }
+    // near multiples of pi/2, where the reduction cancels most bits
+    for (long long k = 1; k < 400000; k += 997)
+    {
+        x.push_back(static_cast<double>(k * 1.57079632679489661923132169163975144L));
+        y.push_back(0);
+    }
+
+    for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2})
+    {
+        setSimdLevel(level);
+        std::vector<Number> sines(x.size()), cosines(x.size()), angles(x.size());
+        fastSin(x.data(), sines.data(), x.size());
+        fastCos(x.data(), cosines.data(), x.size());
+        fastAtan2(y.data(), x.data(), angles.data(), x.size());
+        double worst = 0;
+        std::size_t differences = 0;
+        for (std::size_t i = 0; i < x.size(); ++i)
+        {
+            worst = std::max(worst, ulpError(sines[i], std::sin(static_cast<long double>(x[i]))));
+            worst = std::max(worst, ulpError(cosines[i], std::cos(static_cast<long double>(x[i]))));
+            worst = std::max(worst, ulpError(angles[i], std::atan2(static_cast<long double>(y[i]), static_cast<long double>(x[i]))));
+            differences += sines[i] != fastSin(x[i]) || angles[i] != fastAtan2(y[i], x[i]);
+        }
+        REQUIRE(worst <= 2);
+        REQUIRE(differences == 0);
+    }
+    setSimdLevel(detectSimdLevel());
+
+    // libm beyond the reduction range, and for the special values of atan2
+    REQUIRE(fastSin(1e6) == std::sin(1e6));
+    REQUIRE(std::isnan(fastCos(std::nan(""))));
+    REQUIRE(std::signbit(fastSin(-0.0)));
+    const double inf = std::numeric_limits<double>::infinity();
+    for (double a : {0.0, -0.0, 1.0, -1.0, inf, -inf})
+    {
+        for (double b : {0.0, -0.0, 1.0, -1.0, inf, -inf})
+        {
+            REQUIRE(fastAtan2(a, b) == std::atan2(a, b));
+            REQUIRE(std::signbit(fastAtan2(a, b)) == std::signbit(std::atan2(a, b)));
+        }
+    }
+}
+
+TEST_CASE("Fast math applies to the builtins only when enabled", "[fastmath]")
+{
+    REQUIRE_FALSE(fastMath());
+    REQUIRE(run("(sin 0.7)").head.value.num_value == std::sin(0.7));
+    REQUIRE(run("(arctan 1 3)").head.value.num_value == std::atan2(1.0, 3.0));
+
+    setFastMath(true);
+    REQUIRE(run("(sin 0.7)").head.value.num_value == fastSin(0.7));
+    REQUIRE(run("(cos 0.7)").head.value.num_value == fastCos(0.7));
+    REQUIRE(run("(arctan 1 3)").head.value.num_value == fastAtan2(1, 3));
+    Expression sines = run("(sin (linspace 0 10 101))");
+    Expression angles = run("(arctan 1 (linspace 1 10 10))");
+    setFastMath(false);
+
+    REQUIRE(sines.head.value.vector()->values[37] == fastSin(3.7));
+    REQUIRE(angles.head.value.vector()->values[2] == fastAtan2(1, 3));
+}
+
+TEST_CASE("Integer literals stay integers through + - *", "[integer]")
+{
+    Expression sum = run("(- (* (+ 1 2) 4) 5)");
+    REQUIRE(sum.head.type == NumberType);
+    REQUIRE(sum.head.value.is_integer);
+    REQUIRE(sum.head.value.int_value == 7);
+    REQUIRE_FALSE(run("(+ 1 2.0)").head.value.is_integer);
+    REQUIRE_FALSE(run("(+ 1e3 2)").head.value.is_integer);
+    REQUIRE_FALSE(run("(/ 4 2)").head.value.is_integer);
+
+    // overflow promotes to double
+    Expression big = run("(+ 9223372036854775807 1)");
+    REQUIRE_FALSE(big.head.value.is_integer);
+    REQUIRE(big.head.value.num_value == 9223372036854775808.0);
+    REQUIRE_FALSE(run("(* 3037000500 3037000500)").head.value.is_integer);
+    REQUIRE(run("(- -9223372036854775807 1)").head.value.int_value == std::numeric_limits<Integer>::min());
+    REQUIRE_FALSE(run("(- (- -9223372036854775807 1))").head.value.is_integer);
+    REQUIRE_FALSE(run("(+ 99999999999999999999 1)").head.value.is_integer);
+
+    std::ostringstream out;
+    out << run("(+ 1234567890123 1)");
+    REQUIRE(out.str() == "1234567890124");
+}
+
+TEST_CASE("Integers compare exactly", "[integer]")
+{
+    REQUIRE(run("(= 9007199254740993 9007199254740992)") == Expression(false));
+    REQUIRE(run("(< 9007199254740992 9007199254740993)") == Expression(true));
+    REQUIRE(run("(>= 9007199254740992 9007199254740993)") == Expression(false));
+    REQUIRE(run("(= 3 3.0)") == Expression(true));
+
+    REQUIRE_FALSE(run("(+ 9007199254740992 1)") == run("(+ 9007199254740992 0)"));
+    REQUIRE(run("(+ 1 2)") == Expression(3.));
+
+    Atom one, real;
+    REQUIRE(token_to_atom("1", one));
+    REQUIRE(token_to_atom("1.0", real));
+    REQUIRE_FALSE(sameAtom(one, real));
+}
+
+TEST_CASE("Loop counters and ranges of integers are integers", "[integer]")
+{
+    Expression last = run("(dotimes (i 4) i)");
+    REQUIRE(last.head.value.is_integer);
+    REQUIRE(last.head.value.int_value == 3);
+    REQUIRE(run("(for (i 9007199254740993 9007199254740996 1) i)").head.value.int_value == 9007199254740995);
+    REQUIRE(run("(for (i 9223372036854775800 9223372036854775807 3) i)").head.value.int_value == 9223372036854775806);
+    REQUIRE_FALSE(run("(for (i 0 1 0.5) i)").head.value.is_integer);
+
+    std::vector<Expression> range = elements("(range 9007199254740990 9007199254740995 2)");
+    REQUIRE(range.size() == 3);
+    REQUIRE(range.back().head.value.is_integer);
+    REQUIRE(range.back().head.value.int_value == 9007199254740994);
+    REQUIRE_FALSE(elements("(range 0 1 0.5)").back().head.value.is_integer);
+}
+TEST_CASE("Shapes pack their vertices from points, vectors and sequences", "[geometry]")
+{
+    Expression line = run("(polyline (point 0 0) (point 1 2) (point 3 4))");
+    REQUIRE(line.head.type == PolylineType);
+    REQUIRE(line.head.value.shape()->xs == std::vector<Number>({0, 1, 3}));
+    REQUIRE(line.head.value.shape()->ys == std::vector<Number>({0, 2, 4}));
+    REQUIRE(line == run("(polyline (vector 0 1 3) (vector 0 2 4))"));
+    REQUIRE_FALSE(line == run("(polygon (vector 0 1 3) (vector 0 2 4))"));
+
+    Expression circle = run("(polygon (map (lambda (t) (point (cos t) (sin t))) (range 0 100000 1)))");
+    REQUIRE(circle.head.type == PolygonType);
+    REQUIRE(circle.head.value.shape()->size() == 100000);
+    REQUIRE(circle.head.value.shape()->xs[7] == std::cos(7.));
+    REQUIRE(run("(points (points (point 1 1)) (point 2 2))").head.value.shape()->size() == 2);
+    REQUIRE(run("(draw (polygon (point 0 0) (point 1 0) (point 0 1)))").head.type == PolygonType);
+
+    std::ostringstream out;
+    out << circle;
+    REQUIRE(out.str() == "<polygon of 100000 points>");
+}
+
+TEST_CASE("Shapes reject invalid vertices", "[geometry]")
+{
+    REQUIRE_THROWS_AS(run("(polygon (point 0 0) (point 1 1))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(polyline (vector 0 1) (vector 0 1 2))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(points (point 0 0) 1)"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(polyline (range 0 3 1))"), InterpreterSemanticError);
+    REQUIRE_THROWS_AS(run("(polyline (point 0 0) (point 1 1) True)"), InterpreterSemanticError);
+}
+TEST_CASE("Cancel stops an evaluation running on another thread", "[cancel]")
+{
+    Interpreter interp;
+    std::istringstream loop("(begin (define n 0) (while True (set! n (+ n 1))))");
+    REQUIRE(interp.parse(loop));
+
+    bool stopped = false;
+    std::thread evaluation([&] {
+        try
+        {
+            interp.eval();
+        }
+        catch (const InterpreterSemanticError&)
+        {
+            stopped = true;
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    interp.cancel();
+    evaluation.join();
+    REQUIRE(stopped);
+
+    // evaluations keep failing until the cancel is cleared
+    std::istringstream sum("(+ n 1)");
+    REQUIRE(interp.parse(sum));
+    REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+    interp.clearCancel();
+    REQUIRE(interp.eval().head.value.num_value > 1);
+}
+TEST_CASE("Spatial index queries match a linear scan", "[spatial]")
+{
+    std::mt19937 random(44);
+    std::uniform_real_distribution<double> position(-1000, 1000);
+    std::uniform_real_distribution<double> extent(0, 20);
+    std::vector<Box> boxes;
+    for (int i = 0; i < 5000; ++i)
+    {
+        double x = position(random);
+        double y = position(random);
+        boxes.push_back(Box{x, y, x + extent(random), y + extent(random)});
+    }
+    SpatialIndex index(boxes);
+    REQUIRE(index.size() == boxes.size());
+
+    std::size_t mismatches = 0;
+    for (int q = 0; q < 200; ++q)
+    {
+        double x = position(random);
+        double y = position(random);
+        Box area{x, y, x + 10 * extent(random), y + 10 * extent(random)};
+        std::vector<std::size_t> found;
+        index.query(area, [&](std::size_t i) { found.push_back(i); });
+        std::sort(found.begin(), found.end());
+        std::vector<std::size_t> expected;
+        for (std::size_t i = 0; i < boxes.size(); ++i)
+        {
+            if (boxes[i].intersects(area))
+            {
+                expected.push_back(i);
+            }
+        }
+        mismatches += found != expected;
+    }
+    REQUIRE(mismatches == 0);
+
+    std::size_t visits = 0;
+    SpatialIndex().query(Box{0, 0, 1, 1}, [&](std::size_t) { ++visits; });
+    index.query(Box{5000, 5000, 6000, 6000}, [&](std::size_t) { ++visits; });
+    REQUIRE(visits == 0);
+}
+TEST_CASE("Draw takes any number of graphics and returns their list", "[interpreter]")
+{
+    Expression drawn = run("(draw (point 0 0) (line (point 0 0) (point 1 1)) (arc (point 0 0) (point 1 0) pi))");
+    REQUIRE(drawn.head.type == ListType);
+    REQUIRE(drawn.tail.size() == 3);
+    REQUIRE(drawn.tail[0] == Expression(std::make_tuple(0., 0.)));
+    REQUIRE(drawn.tail[1] == Expression(std::make_tuple(0., 0.), std::make_tuple(1., 1.)));
+    REQUIRE(drawn.tail[2].head.type == ArcType);
+
+    // a list argument stands for its elements
+    Expression nested = run("(begin (define drawn (draw (point 0 0) (point 1 1))) (draw drawn (point 2 2)))");
+    REQUIRE(nested.head.type == ListType);
+    REQUIRE(nested.tail.size() == 3);
+    REQUIRE(nested.tail[2] == Expression(std::make_tuple(2., 2.)));
+
+    REQUIRE_THROWS_AS(run("(draw (point 0 0) (point 1 1) True)"), InterpreterSemanticError);
+}
+TEST_CASE("Scene files keep drawn geometry in bounded chunks", "[scene]")
+{
+    const std::string filename = "unittests_scene.slscene";
+    {
+        SceneWriter writer(filename);
+        REQUIRE(writer.good());
+        for (std::uint32_t i = 0; i < SceneWriter::chunkSize + 10; ++i)
+        {
+            writer.point(i, -static_cast<double>(i));
+        }
+        writer.line(0, 0, 10, 20);
+        writer.arc(5, 5, 3, 1.5);
+        PointBuffer triangle;
+        triangle.xs = {0, 4, 0};
+        triangle.ys = {0, 0, 3};
+        writer.polyline(triangle, true);
+        REQUIRE(writer.finish());
+    }
+
+    // read into doubles, which are aligned as a mapping would be
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    std::size_t size = static_cast<std::size_t>(in.tellg());
+    std::vector<double> storage((size + sizeof(double) - 1) / sizeof(double));
+    in.seekg(0);
+    in.read(reinterpret_cast<char *>(storage.data()), static_cast<std::streamsize>(size));
+    in.close();
+    std::remove(filename.c_str());
+    const unsigned char * data = reinterpret_cast<const unsigned char *>(storage.data());
+
+    std::vector<SceneChunk> chunks;
+    Box bounds;
+    REQUIRE(readScene(data, size, chunks, bounds));
+    REQUIRE(chunks.size() == 5);
+    REQUIRE(chunks[0].kind == ChunkKind::Points);
+    REQUIRE(chunks[0].count == SceneWriter::chunkSize);
+    REQUIRE(chunks[0].data[2 * 7 + 1] == -7);
+    REQUIRE(chunks[1].kind == ChunkKind::Polygon);
+    REQUIRE(chunks[1].count == 3);
+    REQUIRE(chunks[2].kind == ChunkKind::Points);
+    REQUIRE(chunks[2].count == 10);
+    REQUIRE(chunks[3].kind == ChunkKind::Lines);
+    REQUIRE(chunks[4].kind == ChunkKind::Arcs);
+    REQUIRE(chunks[4].box.minX == 1.5);
+    REQUIRE(bounds.minX == -0.5);
+    REQUIRE(bounds.minY == -(static_cast<double>(SceneWriter::chunkSize) + 9) - 0.5);
+
+    // a truncated file is rejected
+    REQUIRE_FALSE(readScene(data, size - 8, chunks, bounds));
+}
+
@@ -0,0 +1,155 @@
+#include "vector_writer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include <QMarginsF>
+#include <QPageSize>
+#include <QPen>
+#include <QPointF>
+#include <QRectF>
+#include <qmath.h>
+
+#include "point_buffer.hpp"
+#include "qgraphics_arc_item.hpp"
+#include "qgraphics_polyline_item.hpp"
+
+SvgWriter::SvgWriter(const std::string& filename) : out(filename)
+{
+    out.precision(9);
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\"";
+    header = out.tellp();
+    out << std::string(headerRoom, ' ') << ">\n"
+        << "<g fill=\"none\" stroke=\"black\" stroke-width=\"1\">\n";
+}
+
+bool SvgWriter::good() const
+{
+    return out.good();
+}
+
+void SvgWriter::include(double x1, double y1, double x2, double y2)
+{
+    double left = std::min(x1, x2) - 0.5, right = std::max(x1, x2) + 0.5;
+    double top = std::min(y1, y2) - 0.5, bottom = std::max(y1, y2) + 0.5;
+    minX = empty ? left : std::min(minX, left);
+    minY = empty ? top : std::min(minY, top);
+    maxX = empty ? right : std::max(maxX, right);
+    maxY = empty ? bottom : std::max(maxY, bottom);
+    empty = false;
+}
+
+void SvgWriter::point(double x, double y)
+{
+    out << "<ellipse cx=\"" << x + 0.5 << "\" cy=\"" << y + 0.5 << "\" rx=\"0.5\" ry=\"0.5\"/>\n";
+    include(x, y, x + 1, y + 1);
+}
+
+void SvgWriter::line(double x1, double y1, double x2, double y2)
+{
+    out << "<line x1=\"" << x1 << "\" y1=\"" << y1 << "\" x2=\"" << x2 << "\" y2=\"" << y2 << "\"/>\n";
+    include(x1, y1, x2, y2);
+}
+
+// Centered at (x, y) with radius width, from angle 0 counterclockwise on
+// screen for a positive span, as QPainter::drawArc draws it
+void SvgWriter::arc(double x, double y, double width, double height)
+{
+    double radius = std::abs(width);
+    int span = arcSpan(height);
+    if (radius == 0 || span == 0)
+    {
+        return;
+    }
+    include(x - radius, y - radius, x + radius, y + radius);
+    double degrees = span / 16.0;
+    if (std::abs(degrees) >= 360)
+    {
+        out << "<circle cx=\"" << x << "\" cy=\"" << y << "\" r=\"" << radius << "\"/>\n";
+        return;
+    }
+    // y grows downwards, so counterclockwise is the negative sweep
+    double angle = qDegreesToRadians(degrees);
+    out << "<path d=\"M " << x + radius << " " << y
+        << " A " << radius << " " << radius << " 0 " << (std::abs(degrees) > 180 ? 1 : 0) << " " << (degrees < 0 ? 1 : 0)
+        << " " << x + radius * std::cos(angle) << " " << y - radius * std::sin(angle) << "\"/>\n";
+}
+
+void SvgWriter::polyline(const PointBuffer& points, bool closed)
+{
+    out << (closed ? "<polygon points=\"" : "<polyline points=\"");
+    for (std::size_t i = 0; i < points.size(); ++i)
+    {
+        out << (i == 0 ? "" : " ") << points.xs[i] << "," << points.ys[i];
+        include(points.xs[i], points.ys[i], points.xs[i], points.ys[i]);
+    }
+    out << "\"/>\n";
+}
+
+bool SvgWriter::finish()
+{
+    out << "</g>\n</svg>\n";
+
+    std::ostringstream box;
+    box.precision(9);
+    double width = empty ? 0 : maxX - minX;
+    double height = empty ? 0 : maxY - minY;
+    box << " width=\"" << width << "\" height=\"" << height << "\" viewBox=\""
+        << (empty ? 0 : minX) << " " << (empty ? 0 : minY) << " " << width << " " << height << "\"";
+    std::string attributes = box.str();
+    if (attributes.size() > static_cast<std::size_t>(headerRoom))
+    {
+        return false;
+    }
+    out.seekp(header);
+    out << attributes;
+    out.close();
+    return !out.fail();
+}
+
+PdfWriter::PdfWriter(const std::string& filename, const QSize& size) : writer(QString::fromStdString(filename))
+{
+    writer.setPageSize(QPageSize(QSizeF(size), QPageSize::Point, QString(), QPageSize::ExactMatch));
+    writer.setPageMargins(QMarginsF(0, 0, 0, 0));
+    writer.setResolution(72); // a unit of the drawing is a point
+    if (painter.begin(&writer))
+    {
+        painter.setRenderHint(QPainter::Antialiasing);
+        painter.setPen(QPen(Qt::black));
+        painter.setBrush(Qt::NoBrush);
+        painter.translate(size.width() / 2.0, size.height() / 2.0);
+    }
+}
+
+bool PdfWriter::good() const
+{
+    return painter.isActive();
+}
+
+bool PdfWriter::finish()
+{
+    return painter.end();
+}
+
+void PdfWriter::point(double x, double y)
+{
+    painter.drawEllipse(QRectF(x, y, 1, 1));
+}
+
+void PdfWriter::line(double x1, double y1, double x2, double y2)
+{
+    painter.drawLine(QPointF(x1, y1), QPointF(x2, y2));
+}
+
+void PdfWriter::arc(double x, double y, double width, double height)
+{
+    double radius = std::abs(width);
+    painter.drawArc(QRectF(x - radius, y - radius, 2 * radius, 2 * radius), 0, arcSpan(height));
+}
+
+void PdfWriter::polyline(const PointBuffer& points, bool closed)
+{
+    paintPolyline(painter, points.size(), closed, [&](std::size_t i) { return QPointF(points.xs[i], points.ys[i]); });
+}
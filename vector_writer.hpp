@@ -0,0 +1,59 @@
+#ifndef VECTOR_WRITER_HPP
+#define VECTOR_WRITER_HPP
+
+#include <fstream>
+#include <string>
+
+#include <QPainter>
+#include <QPdfWriter>
+#include <QSize>
+
+#include "graphics_writer.hpp"
+
+// An SvgWriter writes each graphic to the file as an SVG element when it is
+// drawn, keeping only the bounds of the drawing. The bounds become the
+// view box, written at the end into room left for it in the header.
+class SvgWriter: public GraphicsWriter{
+public:
+  explicit SvgWriter(const std::string &filename);
+
+  bool good() const override;
+  bool finish() override;
+
+  void point(double x, double y) override;
+  void line(double x1, double y1, double x2, double y2) override;
+  void arc(double x, double y, double width, double height) override;
+  void polyline(const PointBuffer &points, bool closed) override;
+
+private:
+  // grows the bounds by a rectangle and the half pen width around it
+  void include(double x1, double y1, double x2, double y2);
+
+  static const int headerRoom = 160; // characters left for the view box
+  std::ofstream out;
+  std::streampos header;
+  bool empty = true;
+  double minX = 0, minY = 0, maxX = 0, maxY = 0;
+};
+
+// A PdfWriter paints each graphic on a page of the given size in points,
+// centered on the origin, when it is drawn. Qt keeps the page's content
+// stream until the page is finished, but no scene or items are built.
+class PdfWriter: public GraphicsWriter{
+public:
+  PdfWriter(const std::string &filename, const QSize &size);
+
+  bool good() const override;
+  bool finish() override;
+
+  void point(double x, double y) override;
+  void line(double x1, double y1, double x2, double y2) override;
+  void arc(double x, double y, double width, double height) override;
+  void polyline(const PointBuffer &points, bool closed) override;
+
+private:
+  QPdfWriter writer;
+  QPainter painter;
+};
+
+#endif